@@ -0,0 +1,268 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Event checksums, document generators and timing shared by the benchmarks
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* -----------------------------------------------------------------------------------------------
+ * Event checksum
+ */
+
+void bench_LogInitialize(tEventLog *log)
+{
+    log->hash = 2166136261u;
+    log->events = 0;
+}
+
+void bench_LogEvent(tEventLog *log, const char event, const char *data, size_t length)
+{
+    uint32_t hash = log->hash;
+    size_t i;
+
+    hash = (hash ^ (uint8_t) event) * 16777619u;
+    for(i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t) data[i]) * 16777619u;
+    log->hash = (hash ^ 0xff) * 16777619u;
+    ++(log->events);
+}
+
+void bench_LogTag(void *cookie, const char *s) { bench_LogEvent((tEventLog *) cookie, 't', s, strlen(s)); }
+void bench_LogTagEnd(void *cookie, const char *s) { bench_LogEvent((tEventLog *) cookie, 'e', s, strlen(s)); }
+void bench_LogContent(void *cookie, const char *s) { bench_LogEvent((tEventLog *) cookie, 'c', s, strlen(s)); }
+void bench_LogAttribute(void *cookie, const char *s) { bench_LogEvent((tEventLog *) cookie, 'a', s, strlen(s)); }
+static void LogTagSpan(void *cookie, const char *s, size_t l) { bench_LogEvent((tEventLog *) cookie, 't', s, l); }
+static void LogTagEndSpan(void *cookie, const char *s, size_t l) { bench_LogEvent((tEventLog *) cookie, 'e', s, l); }
+static void LogContentSpan(void *cookie, const char *s, size_t l) { bench_LogEvent((tEventLog *) cookie, 'c', s, l); }
+static void LogAttributeSpan(void *cookie, const char *s, size_t l) { bench_LogEvent((tEventLog *) cookie, 'a', s, l); }
+
+const tSaxmlSpanContext g_bench_spanHandlers =
+    { LogTagSpan, LogTagEndSpan, LogContentSpan, LogAttributeSpan };
+
+/* -----------------------------------------------------------------------------------------------
+ * Document generators
+ */
+
+static uint32_t g_random;
+
+void bench_Seed(uint32_t seed)
+{
+    g_random = seed;
+}
+
+uint32_t bench_Random(uint32_t range)
+{
+    g_random = g_random * 1103515245u + 12345u;
+    return ((g_random >> 8) % range);
+}
+
+static const char *g_fragments[] =
+{
+    "<", ">", "/", "/>", "\"", " ", "  ", "\t", "\r\n", "\n", "=", "name", "a", "item",
+    "value", "text with several words", "0123456789abcdefghijklmnopqrstuvwxyz0123456789",
+    "attr=\"quoted value\"", "<tag>", "</tag>", "<empty/>", "<empty attr=\"x\"/>", "</ tag >",
+    "&", "&amp;", "&#x3c;", "&lt;tag&gt;",
+    /* markup other than elements */
+    "<!-- a <b> -- c -->", "<![CDATA[ <x> ]] ]]>", "<?pi <x> ?>",
+    "<!DOCTYPE d [ <!ENTITY e \"]>\"> ]>", "<!", "<?", "-->", "]]>", "?>"
+};
+#define FRAGMENT_COUNT (sizeof(g_fragments) / sizeof(g_fragments[0]))
+#define FRAGMENT_COUNT_ELEMENTS 27 /* fragments before those for other markup */
+
+size_t bench_GenerateRandom(char *buffer, size_t size, int bMarkup)
+{
+    size_t length = 0, fragment;
+    while(length < size)
+    {
+        const char *f = g_fragments[bench_Random(bMarkup ? FRAGMENT_COUNT : FRAGMENT_COUNT_ELEMENTS)];
+        fragment = strlen(f);
+        if(fragment > size - length)
+            fragment = size - length;
+        memcpy(&buffer[length], f, fragment);
+        length += fragment;
+    }
+    return length;
+}
+
+size_t bench_GenerateDocument(char *buffer, size_t size)
+{
+    static const char *element = "<record id=\"%u\" type=\"entry\"><name>Item %u</name>"
+        "<description>The quick brown fox jumps over the lazy dog, %u times</description>"
+        "<flag enabled=\"yes\"/><empty/>\n</record>\n";
+    char record[256];
+    size_t length = 0, recordLength;
+    uint32_t index = 0;
+
+    while(length < size)
+    {
+        recordLength = (size_t) sprintf(record, element, index, index, index);
+        if(recordLength > size - length)
+            recordLength = size - length;
+        memcpy(&buffer[length], record, recordLength);
+        length += recordLength;
+        ++index;
+    }
+    return length;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Shaped documents
+ */
+
+#define SHAPE_MAX_UNIT 65536 /* largest top-level element generated */
+
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t length;
+} tWriter;
+
+static const char *g_words[] =
+{
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do",
+    "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "x"
+};
+#define WORD_COUNT (sizeof(g_words) / sizeof(g_words[0]))
+
+static void Write(tWriter *writer, const char *s)
+{
+    size_t length = strlen(s);
+    if(length > writer->size - writer->length)
+        length = writer->size - writer->length;
+    memcpy(&writer->data[writer->length], s, length);
+    writer->length += length;
+}
+
+static void WriteNumber(tWriter *writer, uint32_t value)
+{
+    char number[16];
+    sprintf(number, "%lu", (unsigned long) value);
+    Write(writer, number);
+}
+
+/* Words separated by spaces, up to length characters */
+static void WriteWords(tWriter *writer, size_t length)
+{
+    size_t end = writer->length + length;
+    if(end > writer->size)
+        end = writer->size;
+    while(writer->length < end)
+    {
+        Write(writer, g_words[bench_Random(WORD_COUNT)]);
+        if(writer->length < end)
+            Write(writer, " ");
+    }
+}
+
+static void GenerateDeep(tWriter *unit)
+{
+    uint32_t depth = 32 + bench_Random(96), i;
+
+    for(i = 0; i < depth; ++i)
+    {
+        Write(unit, "<level depth=\"");
+        WriteNumber(unit, i);
+        Write(unit, "\">");
+        if(0 == bench_Random(4))
+            WriteWords(unit, 4 + bench_Random(16));
+    }
+    for(i = 0; i < depth; ++i)
+        Write(unit, "</level>");
+    Write(unit, "\n");
+}
+
+static void GenerateAttributes(tWriter *unit)
+{
+    uint32_t count = 8 + bench_Random(24), i;
+
+    Write(unit, "<record");
+    for(i = 0; i < count; ++i)
+    {
+        Write(unit, " attribute");
+        WriteNumber(unit, i);
+        Write(unit, "=\"");
+        WriteWords(unit, 1 + bench_Random(12));
+        Write(unit, "\"");
+    }
+    Write(unit, "/>\n");
+}
+
+static void GenerateText(tWriter *unit)
+{
+    Write(unit, "<paragraph>");
+    WriteWords(unit, 1024 + bench_Random(31 * 1024));
+    Write(unit, "</paragraph>\n");
+}
+
+static void GenerateSmall(tWriter *unit)
+{
+    uint32_t count = 16 + bench_Random(16), i;
+
+    Write(unit, "<list>");
+    for(i = 0; i < count; ++i)
+    {
+        switch(bench_Random(3))
+        {
+            case 0: Write(unit, "<e>"); WriteNumber(unit, i); Write(unit, "</e>"); break;
+            case 1: Write(unit, "<f/>"); break;
+            default: Write(unit, "<g k=\"v\"/>"); break;
+        }
+    }
+    Write(unit, "</list>\n");
+}
+
+static void GenerateQuoted(tWriter *unit)
+{
+    Write(unit, "<value data=\"");
+    WriteWords(unit, 256 + bench_Random(4096));
+    Write(unit, "\">\"");
+    WriteWords(unit, 256 + bench_Random(4096));
+    Write(unit, "\"</value>\n");
+}
+
+const char *bench_ShapeName(const eShape shape)
+{
+    static const char *names[SHAPE_COUNT] = { "deep", "attributes", "text", "small", "quoted" };
+    return (shape < SHAPE_COUNT) ? names[shape] : "unknown";
+}
+
+size_t bench_GenerateShape(const eShape shape, char *buffer, size_t size)
+{
+    static void (* const generators[SHAPE_COUNT])(tWriter *) =
+        { GenerateDeep, GenerateAttributes, GenerateText, GenerateSmall, GenerateQuoted };
+    static char scratch[SHAPE_MAX_UNIT];
+    tWriter unit;
+    size_t length = 0;
+
+    if(shape >= SHAPE_COUNT)
+        return 0;
+
+    bench_Seed(1 + (uint32_t) shape);
+    unit.data = scratch;
+    unit.size = sizeof(scratch);
+    for(;;)
+    {
+        unit.length = 0;
+        generators[shape](&unit);
+        if(unit.length > size - length)
+            break;
+        memcpy(&buffer[length], scratch, unit.length);
+        length += unit.length;
+    }
+    return length;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Timing
+ */
+
+double bench_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,57 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Event checksums, document generators and timing shared by the benchmarks
+ */
+#ifndef SAXML_BENCH_COMMON_H
+#define SAXML_BENCH_COMMON_H
+
+#include "saxml/saxml.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Checksum of a sequence of parsing events; use as the cookie for the handlers below */
+typedef struct
+{
+    uint32_t hash;
+    uint32_t events;
+} tEventLog;
+
+void bench_LogInitialize(tEventLog *log);
+void bench_LogEvent(tEventLog *log, const char event, const char *data, size_t length);
+
+void bench_LogTag(void *cookie, const char *s);
+void bench_LogTagEnd(void *cookie, const char *s);
+void bench_LogContent(void *cookie, const char *s);
+void bench_LogAttribute(void *cookie, const char *s);
+extern const tSaxmlSpanContext g_bench_spanHandlers;
+
+/* Deterministic pseudo-random numbers in [0, range) */
+void bench_Seed(uint32_t seed);
+uint32_t bench_Random(uint32_t range);
+
+/* Random concatenation of fragments, to exercise unusual sequences; with bMarkup, these include
+ *  comments, CDATA sections, processing instructions and declarations */
+size_t bench_GenerateRandom(char *buffer, size_t size, int bMarkup);
+/* Mostly well-formed document of nested elements with attributes and text */
+size_t bench_GenerateDocument(char *buffer, size_t size);
+
+/* Well-formed documents of a particular shape, for throughput measurements */
+typedef enum
+{
+    SHAPE_DEEP,       /* deeply nested elements */
+    SHAPE_ATTRIBUTES, /* elements with many attributes */
+    SHAPE_TEXT,       /* large blocks of text */
+    SHAPE_SMALL,      /* many small elements */
+    SHAPE_QUOTED,     /* long quoted attribute values and text */
+    SHAPE_COUNT
+} eShape;
+
+const char *bench_ShapeName(const eShape shape);
+/* Returns the length of the document, which is at most size; only whole elements at the top
+   level are generated */
+size_t bench_GenerateShape(const eShape shape, char *buffer, size_t size);
+
+/* Monotonic time, in seconds */
+double bench_Now(void);
+
+#endif /* SAXML_BENCH_COMMON_H */
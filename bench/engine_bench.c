@@ -0,0 +1,211 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Compare the table-driven parsing engine against the reference function-pointer engine
+ */
+#include "saxml/saxml.h"
+#include "reference.h"
+#include "common.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void)x;
+
+typedef struct
+{
+    tSaxmlParser (*initialize)(tSaxmlContext *context, const uint32_t maxStringSize);
+    void (*deinitialize)(tSaxmlParser parser);
+    int (*handleCharacter)(tSaxmlParser parser, const char character);
+    int (*handleBuffer)(tSaxmlParser parser, const char *buffer, const size_t length, size_t *offset);
+    void (*setSpanHandlers)(tSaxmlParser parser, const tSaxmlSpanContext *handlers);
+    void (*allowTruncatedStrings)(tSaxmlParser parser, const int allow);
+    const char *name;
+} tEngine;
+
+static const tEngine g_engines[] =
+{
+    { reference_Initialize, reference_Deinitialize, reference_HandleCharacter,
+      reference_HandleBuffer, reference_SetSpanHandlers, reference_AllowTruncatedStrings,
+      "function-pointer" },
+    { saxml_Initialize, saxml_Deinitialize, saxml_HandleCharacter,
+      saxml_HandleBuffer, saxml_SetSpanHandlers, saxml_AllowTruncatedStrings,
+      "table-driven" }
+};
+#define ENGINE_COUNT (sizeof(g_engines) / sizeof(g_engines[0]))
+
+/* -----------------------------------------------------------------------------------------------
+ * Verification
+ */
+
+typedef struct
+{
+    tEventLog log;
+    int result;
+    size_t offset;
+} tRunResult;
+
+static void RunEngine(const tEngine *engine, const char *document, size_t length,
+    uint32_t maxStringSize, int allowTruncated, int useSpans, size_t chunkSize, tRunResult *run)
+{
+    tSaxmlContext context;
+    tSaxmlParser parser;
+    size_t position = 0, chunk, offset;
+
+    context.cookie = &run->log;
+    context.tagHandler = bench_LogTag;
+    context.tagEndHandler = bench_LogTagEnd;
+    context.parameterHandler = NULL;
+    context.contentHandler = bench_LogContent;
+    context.attributeHandler = bench_LogAttribute;
+    bench_LogInitialize(&run->log);
+    run->result = 0;
+    run->offset = length;
+
+    parser = engine->initialize(&context, maxStringSize);
+    engine->allowTruncatedStrings(parser, allowTruncated);
+    if(useSpans)
+        engine->setSpanHandlers(parser, &g_bench_spanHandlers);
+
+    for(position = 0; position < length && 0 == run->result; position += chunk)
+    {
+        chunk = (0 == chunkSize || length - position < chunkSize) ? length - position : chunkSize;
+        if(1 == chunkSize)
+        {
+            run->result = engine->handleCharacter(parser, document[position]);
+            offset = 0;
+        }
+        else
+            run->result = engine->handleBuffer(parser, &document[position], chunk, &offset);
+        if(0 != run->result)
+            run->offset = position + offset;
+    }
+
+    engine->deinitialize(parser);
+}
+
+static int Verify(uint32_t iterations)
+{
+    static const size_t chunkSizes[] = { 1, 2, 3, 7, 64, 0 };
+    char document[4096];
+    size_t length, chunk;
+    uint32_t i, maxStringSize;
+    int allowTruncated, useSpans;
+    tRunResult expected, actual;
+
+    for(i = 0; i < iterations; ++i)
+    {
+        bench_Seed(i);
+        length = 1 + bench_Random(sizeof(document) - 1);
+        length = (i & 1) ? bench_GenerateRandom(document, length, 0 /* not supported by the reference engine */)
+                         : bench_GenerateDocument(document, length);
+        /* With the minimum string size of 2, no characters at all fit in the buffer; the engines
+           differ in which discarded characters count as leading whitespace, so start at 3 */
+        maxStringSize = 3 + bench_Random(64);
+        allowTruncated = (int) bench_Random(2);
+        useSpans = (int) bench_Random(2);
+        for(chunk = 0; chunk < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++chunk)
+        {
+            RunEngine(&g_engines[0], document, length, maxStringSize, allowTruncated, useSpans,
+                chunkSizes[chunk], &expected);
+            RunEngine(&g_engines[1], document, length, maxStringSize, allowTruncated, useSpans,
+                chunkSizes[chunk], &actual);
+            if(expected.log.hash != actual.log.hash || expected.log.events != actual.log.events
+               || expected.result != actual.result || expected.offset != actual.offset)
+            {
+                fprintf(stderr, "Mismatch: iteration %lu, chunk size %lu, max string %lu, "
+                    "truncate %d, spans %d: events %lu/%lu, result %d/%d, offset %lu/%lu\n",
+                    (unsigned long) i, (unsigned long) chunkSizes[chunk],
+                    (unsigned long) maxStringSize, allowTruncated, useSpans,
+                    (unsigned long) expected.log.events, (unsigned long) actual.log.events,
+                    expected.result, actual.result,
+                    (unsigned long) expected.offset, (unsigned long) actual.offset);
+                return -1;
+            }
+        }
+    }
+
+    printf("Verified %lu documents\n", (unsigned long) iterations);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Benchmark
+ */
+
+static void Benchmark(const char *document, size_t length, uint32_t repeat)
+{
+    static const size_t chunkSizes[] = { 1, 65536 };
+    const tEngine *engine;
+    tRunResult run;
+    size_t e, c;
+    uint32_t r;
+    double start, elapsed;
+
+    for(e = 0; e < ENGINE_COUNT; ++e)
+    {
+        engine = &g_engines[e];
+        for(c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c)
+        {
+            start = bench_Now();
+            for(r = 0; r < repeat; ++r)
+                RunEngine(engine, document, length, 256, 1, 0, chunkSizes[c], &run);
+            elapsed = bench_Now() - start;
+            printf("%-18s %-20s %8.1f MB/s  %6.2f ns/byte  (%lu events)\n", engine->name,
+                (1 == chunkSizes[c]) ? "HandleCharacter" : "HandleBuffer",
+                ((double) length * repeat) / elapsed / 1e6,
+                elapsed * 1e9 / ((double) length * repeat), (unsigned long) run.log.events);
+        }
+    }
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * main
+ */
+
+#define PROGRAM_OPTIONS "m:r:v:?"
+
+static void DisplayHelp(const char *prog)
+{
+    fprintf(stderr, "%s <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   m [megabytes]      Size of the generated benchmark document (default: 16)\n");
+    fprintf(stderr, "   r [count]          Number of times to parse the document (default: 4)\n");
+    fprintf(stderr, "   v [count]          Only verify that the engines agree, on this many documents\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = 16;
+    uint32_t repeat = 4, verify = 0;
+    char *document;
+    int arg;
+
+    while((arg = getopt(argc, argv, PROGRAM_OPTIONS)) != -1)
+    {
+        switch(arg)
+        {
+            case 'm': size = strtoul(optarg, NULL, 10); break;
+            case 'r': repeat = strtoul(optarg, NULL, 10); break;
+            case 'v': verify = strtoul(optarg, NULL, 10); break;
+            default: DisplayHelp(argv[0]); return -1;
+        }
+    }
+
+    if(verify > 0)
+        return Verify(verify);
+
+    size *= 1024 * 1024;
+    document = (char *) malloc(size);
+    if(NULL == document || 0 == size || 0 == repeat)
+    {
+        DisplayHelp(argv[0]);
+        return -1;
+    }
+    bench_Seed(1);
+    bench_GenerateDocument(document, size);
+    Benchmark(document, size, repeat);
+    free(document);
+
+    return 0;
+}
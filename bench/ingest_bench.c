@@ -0,0 +1,262 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parse a document written to a pipe by another thread, with each of the ways
+ *         saxml_ParseDescriptor can read it, for throughput and equivalence
+ */
+#include "saxml/saxml.h"
+#include "common.h"
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_DOCUMENT_SIZE (64 * 1024 * 1024)
+#define DEFAULT_WRITE_SIZE    (64 * 1024)
+
+static const struct
+{
+    int mode;
+    const char *name;
+} g_modes[] =
+{
+    { SAXML_INGEST_SERIAL, "serial" },
+    { SAXML_INGEST_THREAD, "thread" },
+    { SAXML_INGEST_IO_URING, "io_uring" },
+    { SAXML_INGEST_AUTO, "auto" }
+};
+#define MODE_COUNT (sizeof(g_modes) / sizeof(g_modes[0]))
+
+typedef struct
+{
+    int fd;
+    const char *data;
+    size_t length;
+    size_t writeSize;
+    long latency;              /* microseconds between writes, as a slow producer */
+} tWriter;
+
+typedef struct
+{
+    tEventLog log;
+    size_t offset;
+    int result;
+    double seconds;
+} tRun;
+
+static void *Writer(void *argument)
+{
+    tWriter *writer = (tWriter *) argument;
+    struct timespec delay;
+    size_t position = 0, length;
+    ssize_t written;
+
+    delay.tv_sec = writer->latency / 1000000;
+    delay.tv_nsec = (writer->latency % 1000000) * 1000;
+    while(position < writer->length)
+    {
+        length = writer->length - position;
+        if(length > writer->writeSize)
+            length = writer->writeSize;
+        written = write(writer->fd, writer->data + position, length);
+        if(written < 0)
+        {
+            if(EINTR == errno)
+                continue;
+            break; /* the parser stopped reading, after an error */
+        }
+        position += (size_t) written;
+        if(writer->latency > 0)
+            nanosleep(&delay, NULL);
+    }
+    close(writer->fd);
+    return NULL;
+}
+
+/* Parse data written to a pipe. Returns 0 if the run took place (whatever the parsing result),
+ *  1 if the mode isn't available, or -1 on failure. */
+static int Run(const int mode, const char *data, const size_t length, const size_t writeSize,
+    const long latency, const int bValidate, tRun *run)
+{
+    tSaxmlContext context;
+    tSaxmlParser parser;
+    tWriter writer;
+    pthread_t thread;
+    int fds[2], error;
+    double start;
+
+    if(0 != pipe(fds))
+        return -1;
+    writer.fd = fds[1];
+    writer.data = data;
+    writer.length = length;
+    writer.writeSize = writeSize;
+    writer.latency = latency;
+
+    context.cookie = &run->log;
+    context.tagHandler = bench_LogTag;
+    context.tagEndHandler = bench_LogTagEnd;
+    context.parameterHandler = NULL;
+    context.contentHandler = bench_LogContent;
+    context.attributeHandler = bench_LogAttribute;
+    bench_LogInitialize(&run->log);
+    parser = saxml_Initialize(&context, 256);
+    if(NULL == parser)
+        return -1;
+    saxml_SetSpanHandlers(parser, &g_bench_spanHandlers);
+    saxml_EnableUtf8Validation(parser, bValidate);
+
+    if(0 != pthread_create(&thread, NULL, Writer, &writer))
+    {
+        saxml_Deinitialize(parser);
+        return -1;
+    }
+    start = bench_Now();
+    run->result = saxml_ParseDescriptor(parser, fds[0], mode, &run->offset);
+    error = errno;
+    run->seconds = bench_Now() - start;
+    close(fds[0]); /* a writer still writing gets EPIPE */
+    pthread_join(thread, NULL);
+    saxml_Deinitialize(parser);
+
+    if(SAXML_ERROR_FILE == run->result && ENOSYS == error)
+        return 1;
+    if(SAXML_ERROR_FILE == run->result)
+        return -1;
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * main
+ */
+
+#define PROGRAM_OPTIONS "l:r:s:vw:?"
+
+static void DisplayHelp(const char *prog)
+{
+    fprintf(stderr, "%s <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   l [microseconds]   Writer's delay after each write, as a slow producer (default: 0)\n");
+    fprintf(stderr, "   r [count]          Runs of each mode, reporting the fastest (default: 3)\n");
+    fprintf(stderr, "   s [bytes]          Document size (default: 64MB)\n");
+    fprintf(stderr, "   v                  Fail unless every available mode delivers the same events, and\n");
+    fprintf(stderr, "                      reports an error in a malformed document at the same offset\n");
+    fprintf(stderr, "   w [bytes]          Size of each write to the pipe (default: 64KB)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    char *document, original;
+    size_t documentSize = DEFAULT_DOCUMENT_SIZE, writeSize = DEFAULT_WRITE_SIZE, length;
+    tRun reference, malformed, run;
+    double best;
+    long latency = 0;
+    uint32_t runs = 3, i, j;
+    int verify = 0;
+    int arg, status;
+
+    while((arg = getopt(argc, argv, PROGRAM_OPTIONS)) != -1)
+    {
+        switch(arg)
+        {
+            case 'l': latency = strtol(optarg, NULL, 10); break;
+            case 'r': runs = strtoul(optarg, NULL, 10); break;
+            case 's': documentSize = strtoul(optarg, NULL, 10); break;
+            case 'v': verify = 1; break;
+            case 'w': writeSize = strtoul(optarg, NULL, 10); break;
+            default: DisplayHelp(argv[0]); return -1;
+        }
+    }
+    if(0 == runs || 0 == writeSize || latency < 0 || documentSize < 16)
+    {
+        DisplayHelp(argv[0]);
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    document = (char *) malloc(documentSize);
+    if(NULL == document)
+        return -1;
+    bench_Seed(1);
+    length = bench_GenerateShape(SHAPE_SMALL, document, documentSize);
+
+    if(verify)
+    {
+        if(0 != Run(SAXML_INGEST_SERIAL, document, length, writeSize, latency, 1, &reference)
+           || 0 != reference.result)
+        {
+            fprintf(stderr, "Serial parse failed\n");
+            return -1;
+        }
+        original = document[length / 2];
+        document[length / 2] = (char) 0xFF; /* never valid in UTF-8 */
+        if(0 != Run(SAXML_INGEST_SERIAL, document, length, writeSize, latency, 1, &malformed)
+           || SAXML_ERROR_ENCODING != malformed.result)
+        {
+            fprintf(stderr, "Serial parse of the malformed document didn't fail\n");
+            return -1;
+        }
+
+        for(i = 1; i < MODE_COUNT; ++i)
+        {
+            document[length / 2] = original;
+            status = Run(g_modes[i].mode, document, length, writeSize, latency, 1, &run);
+            if(1 == status)
+            {
+                printf("%-10s not available\n", g_modes[i].name);
+                continue;
+            }
+            if(0 != status || 0 != run.result || run.log.hash != reference.log.hash
+               || run.log.events != reference.log.events)
+            {
+                fprintf(stderr, "%s: events don't match\n", g_modes[i].name);
+                return -1;
+            }
+            document[length / 2] = (char) 0xFF;
+            status = Run(g_modes[i].mode, document, length, writeSize, latency, 1, &run);
+            if(0 != status || run.result != malformed.result || run.offset != malformed.offset)
+            {
+                fprintf(stderr, "%s: error %d at offset %lu, rather than %d at %lu\n",
+                    g_modes[i].name, run.result, (unsigned long) run.offset, malformed.result,
+                    (unsigned long) malformed.offset);
+                return -1;
+            }
+            printf("%-10s events match (%lu events, error at offset %lu)\n", g_modes[i].name,
+                (unsigned long) run.log.events, (unsigned long) run.offset);
+        }
+        free(document);
+        return 0;
+    }
+
+    printf("%lu bytes, written %lu at a time", (unsigned long) length, (unsigned long) writeSize);
+    if(latency > 0)
+        printf(", %ld us apart", latency);
+    printf("\n%-10s %10s\n", "mode", "MB/s");
+    for(i = 0; i < MODE_COUNT; ++i)
+    {
+        best = 0.0;
+        for(j = 0; j < runs; ++j)
+        {
+            status = Run(g_modes[i].mode, document, length, writeSize, latency, 0, &run);
+            if(0 != status || 0 != run.result)
+                break;
+            if(0 == j || run.seconds < best)
+                best = run.seconds;
+        }
+        if(1 == status)
+            printf("%-10s %10s\n", g_modes[i].name, "n/a");
+        else if(0 != status || 0 != run.result)
+        {
+            fprintf(stderr, "%s: parsing failed (%d)\n", g_modes[i].name, run.result);
+            return -1;
+        }
+        else
+            printf("%-10s %10.1f\n", g_modes[i].name, (double) length / best / 1e6);
+    }
+    free(document);
+    return 0;
+}
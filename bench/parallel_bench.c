@@ -0,0 +1,362 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Compare saxml_ParseParallel and saxml_ParseRecords against serial parsing, and
+ *         measure how saxml_ParseParallel scales
+ */
+#include "saxml/saxml.h"
+#include "common.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+    tEventLog log;
+    int result;
+    size_t offset;
+} tRunResult;
+
+typedef struct
+{
+    uint32_t maxStringSize;
+    int allowTruncated;
+    int useSpans;
+    int decodeReferences;
+    int useFragments;
+} tRunOptions;
+
+/* Fragments are logged as they're delivered, so the fragmentation must match too */
+static void LogContentFragment(void *cookie, const char *s, size_t l, int more)
+    { bench_LogEvent((tEventLog *) cookie, more ? 'C' : 'c', s, l); }
+static void LogAttributeFragment(void *cookie, const char *s, size_t l, int more)
+    { bench_LogEvent((tEventLog *) cookie, more ? 'A' : 'a', s, l); }
+
+static const tSaxmlFragmentContext g_fragmentHandlers =
+    { LogContentFragment, LogAttributeFragment };
+
+/* Parse the whole document with saxml_ParseParallel; threadCount 0 uses saxml_HandleBuffer */
+static int Run(const char *document, size_t length, const tRunOptions *options,
+    uint32_t threadCount, size_t chunkSize, tRunResult *run)
+{
+    tSaxmlContext context;
+    tSaxmlParser parser;
+
+    context.cookie = &run->log;
+    context.tagHandler = bench_LogTag;
+    context.tagEndHandler = bench_LogTagEnd;
+    context.parameterHandler = NULL;
+    context.contentHandler = bench_LogContent;
+    context.attributeHandler = bench_LogAttribute;
+    bench_LogInitialize(&run->log);
+
+    parser = saxml_Initialize(&context, options->maxStringSize);
+    if(NULL == parser)
+        return -1;
+    saxml_AllowTruncatedStrings(parser, options->allowTruncated);
+    saxml_EnableReferenceDecoding(parser, options->decodeReferences);
+    if(options->useSpans)
+        saxml_SetSpanHandlers(parser, &g_bench_spanHandlers);
+    if(options->useFragments)
+        saxml_SetFragmentHandlers(parser, &g_fragmentHandlers);
+
+    if(0 == threadCount)
+        run->result = saxml_HandleBuffer(parser, document, length, &run->offset);
+    else
+        run->result = saxml_ParseParallel(parser, document, length, threadCount, chunkSize,
+            &run->offset);
+
+    saxml_Deinitialize(parser);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Verification
+ */
+
+static int Verify(uint32_t iterations)
+{
+    static const size_t chunkSizes[] = { 1, 3, 17, 256 };
+    static const uint32_t threadCounts[] = { 2, 3, 8 };
+    char document[16384];
+    size_t length, c, t;
+    uint32_t i;
+    tRunOptions options;
+    tRunResult expected, actual;
+
+    for(i = 0; i < iterations; ++i)
+    {
+        bench_Seed(i);
+        length = 1 + bench_Random(sizeof(document) - 1);
+        length = (i & 1) ? bench_GenerateRandom(document, length, 1)
+                         : bench_GenerateDocument(document, length);
+        options.maxStringSize = 3 + bench_Random(64);
+        options.allowTruncated = (int) bench_Random(2);
+        options.useSpans = (int) bench_Random(2);
+        options.decodeReferences = (int) bench_Random(2);
+        options.useFragments = (int) bench_Random(2);
+        if(0 != Run(document, length, &options, 0, 0, &expected))
+            return -1;
+
+        for(c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c)
+        {
+            for(t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+            {
+                if(0 != Run(document, length, &options, threadCounts[t], chunkSizes[c], &actual))
+                    return -1;
+                if(expected.log.hash != actual.log.hash || expected.log.events != actual.log.events
+                   || expected.result != actual.result || expected.offset != actual.offset)
+                {
+                    fprintf(stderr, "Mismatch: iteration %lu, threads %lu, chunk size %lu, "
+                        "max string %lu, truncate %d, spans %d, references %d, fragments %d: "
+                        "events %lu/%lu, result %d/%d, offset %lu/%lu\n",
+                        (unsigned long) i, (unsigned long) threadCounts[t],
+                        (unsigned long) chunkSizes[c], (unsigned long) options.maxStringSize,
+                        options.allowTruncated, options.useSpans, options.decodeReferences,
+                        options.useFragments,
+                        (unsigned long) expected.log.events, (unsigned long) actual.log.events,
+                        expected.result, actual.result,
+                        (unsigned long) expected.offset, (unsigned long) actual.offset);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Verified %lu documents\n", (unsigned long) iterations);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Records
+ */
+
+#define MAX_RECORDS 256
+
+typedef struct
+{
+    tEventLog logs[MAX_RECORDS]; /* each record's events */
+    tEventLog order;             /* the order in which records started and ended */
+    int bOrdered;
+    int result;
+    size_t offset;
+} tRecordsRun;
+
+/* With unordered delivery, each worker thread logs the events of the record it's parsing */
+static __thread tEventLog *t_recordLog;
+
+static void LogRecordTag(void *cookie, const char *s) { bench_LogTag(t_recordLog, s); (void) cookie; }
+static void LogRecordTagEnd(void *cookie, const char *s) { bench_LogTagEnd(t_recordLog, s); (void) cookie; }
+static void LogRecordContent(void *cookie, const char *s) { bench_LogContent(t_recordLog, s); (void) cookie; }
+static void LogRecordAttribute(void *cookie, const char *s) { bench_LogAttribute(t_recordLog, s); (void) cookie; }
+
+static void LogDocument(tRecordsRun *run, const char event, uint32_t index)
+{
+    if(run->bOrdered)
+        bench_LogEvent(&run->order, event, (const char *) &index, sizeof(index));
+}
+
+static void LogDocumentStart(void *cookie, uint32_t index)
+{
+    tRecordsRun *run = (tRecordsRun *) cookie;
+    t_recordLog = &run->logs[index % MAX_RECORDS];
+    LogDocument(run, 'D', index);
+}
+
+static void LogDocumentEnd(void *cookie, uint32_t index)
+{
+    tRecordsRun *run = (tRecordsRun *) cookie;
+    bench_LogEvent(t_recordLog, 'E', "", 0);
+    LogDocument(run, 'E', index);
+}
+
+static const tSaxmlDocumentContext g_documentHandlers = { LogDocumentStart, LogDocumentEnd };
+
+/* Parse the concatenated documents with saxml_ParseRecords */
+static int RunRecords(const char *document, size_t length, const tRunOptions *options,
+    uint32_t threadCount, int delivery, tRecordsRun *run)
+{
+    tSaxmlContext context;
+    tSaxmlParser parser;
+    uint32_t i;
+
+    context.cookie = run;
+    context.tagHandler = LogRecordTag;
+    context.tagEndHandler = LogRecordTagEnd;
+    context.parameterHandler = NULL;
+    context.contentHandler = LogRecordContent;
+    context.attributeHandler = LogRecordAttribute;
+    for(i = 0; i < MAX_RECORDS; ++i)
+        bench_LogInitialize(&run->logs[i]);
+    bench_LogInitialize(&run->order);
+    run->bOrdered = (SAXML_RECORDS_ORDERED == delivery);
+
+    parser = saxml_Initialize(&context, options->maxStringSize);
+    if(NULL == parser)
+        return -1;
+    saxml_AllowTruncatedStrings(parser, options->allowTruncated);
+    saxml_EnableReferenceDecoding(parser, options->decodeReferences);
+    saxml_SetDocumentHandlers(parser, &g_documentHandlers);
+    run->result = saxml_ParseRecords(parser, document, length, threadCount, delivery,
+        &run->offset);
+    saxml_Deinitialize(parser);
+    return 0;
+}
+
+static int VerifyRecords(uint32_t iterations)
+{
+    static const uint32_t threadCounts[] = { 2, 3, 8 };
+    static const int deliveries[] = { SAXML_RECORDS_ORDERED, SAXML_RECORDS_UNORDERED };
+    static tRecordsRun expected, actual;
+    char document[16384];
+    size_t length, t, d;
+    uint32_t i, r;
+    tRunOptions options;
+    int bMatch;
+
+    for(i = 0; i < iterations; ++i)
+    {
+        bench_Seed(i);
+        length = bench_GenerateDocument(document, 1 + bench_Random(sizeof(document) - 1));
+        options.maxStringSize = 8 + bench_Random(64);
+        options.allowTruncated = (int) bench_Random(2);
+        options.decodeReferences = (int) bench_Random(2);
+        if(0 != RunRecords(document, length, &options, 1, SAXML_RECORDS_ORDERED, &expected))
+            return -1;
+
+        for(t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+        {
+            for(d = 0; d < sizeof(deliveries) / sizeof(deliveries[0]); ++d)
+            {
+                if(0 != RunRecords(document, length, &options, threadCounts[t], deliveries[d],
+                    &actual))
+                {
+                    return -1;
+                }
+
+                /* Unordered, records after one which failed may have been delivered too */
+                bMatch = (expected.result == actual.result && expected.offset == actual.offset);
+                for(r = 0; bMatch && (0 == expected.result || actual.bOrdered)
+                    && r < MAX_RECORDS; ++r)
+                {
+                    bMatch = (expected.logs[r].hash == actual.logs[r].hash
+                        && expected.logs[r].events == actual.logs[r].events);
+                }
+                if(bMatch && actual.bOrdered)
+                    bMatch = (expected.order.hash == actual.order.hash);
+                if(!bMatch)
+                {
+                    fprintf(stderr, "Records mismatch: iteration %lu, threads %lu, %s, "
+                        "max string %lu, truncate %d, references %d: result %d/%d, "
+                        "offset %lu/%lu\n", (unsigned long) i, (unsigned long) threadCounts[t],
+                        actual.bOrdered ? "ordered" : "unordered",
+                        (unsigned long) options.maxStringSize, options.allowTruncated,
+                        options.decodeReferences, expected.result, actual.result,
+                        (unsigned long) expected.offset, (unsigned long) actual.offset);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Verified records of %lu documents\n", (unsigned long) iterations);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * Benchmark
+ */
+
+static int Benchmark(const char *document, size_t length, uint32_t repeat, uint32_t maxThreads,
+    size_t chunkSize)
+{
+    tRunOptions options = { 256, 1, 1, 0, 0 };
+    tRunResult serial, run;
+    uint32_t threads, r;
+    double start, elapsed, baseline = 0.0;
+
+    Run(document, length, &options, 0, 0, &serial);
+    for(threads = 1; threads <= maxThreads; ++threads)
+    {
+        start = bench_Now();
+        for(r = 0; r < repeat; ++r)
+            Run(document, length, &options, (1 == threads) ? 0 : threads, chunkSize, &run);
+        elapsed = bench_Now() - start;
+        if(1 == threads)
+            baseline = elapsed;
+
+        if(run.log.hash != serial.log.hash || run.log.events != serial.log.events)
+        {
+            fprintf(stderr, "Event mismatch with %lu threads\n", (unsigned long) threads);
+            return -1;
+        }
+        printf("%2lu thread%s %8.1f MB/s  %6.2f ns/byte  %5.2fx  (%lu events)\n",
+            (unsigned long) threads, (1 == threads) ? " " : "s",
+            ((double) length * repeat) / elapsed / 1e6, elapsed * 1e9 / ((double) length * repeat),
+            baseline / elapsed, (unsigned long) run.log.events);
+    }
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * main
+ */
+
+#define PROGRAM_OPTIONS "c:m:r:t:v:?"
+
+static void DisplayHelp(const char *prog)
+{
+    fprintf(stderr, "%s <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   c [kilobytes]      Chunk size (default: saxml_ParseParallel's default)\n");
+    fprintf(stderr, "   m [megabytes]      Size of the generated benchmark document (default: 64)\n");
+    fprintf(stderr, "   r [count]          Number of times to parse the document (default: 4)\n");
+    fprintf(stderr, "   t [threads]        Maximum number of threads (default: number of cores)\n");
+    fprintf(stderr, "   v [count]          Only verify that the events match serial parsing (including of records), on this many documents\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = 64, chunkSize = 0;
+    uint32_t repeat = 4, verify = 0, maxThreads = 0;
+    long cores;
+    char *document;
+    int arg, result;
+
+    while((arg = getopt(argc, argv, PROGRAM_OPTIONS)) != -1)
+    {
+        switch(arg)
+        {
+            case 'c': chunkSize = strtoul(optarg, NULL, 10) * 1024; break;
+            case 'm': size = strtoul(optarg, NULL, 10); break;
+            case 'r': repeat = strtoul(optarg, NULL, 10); break;
+            case 't': maxThreads = strtoul(optarg, NULL, 10); break;
+            case 'v': verify = strtoul(optarg, NULL, 10); break;
+            default: DisplayHelp(argv[0]); return -1;
+        }
+    }
+
+    if(verify > 0)
+        return (0 == Verify(verify)) ? VerifyRecords(verify) : -1;
+
+    if(0 == maxThreads)
+    {
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = (cores > 0) ? (uint32_t) cores : 1;
+    }
+
+    size *= 1024 * 1024;
+    document = (char *) malloc(size);
+    if(NULL == document || 0 == size || 0 == repeat)
+    {
+        DisplayHelp(argv[0]);
+        return -1;
+    }
+    bench_Seed(1);
+    bench_GenerateDocument(document, size);
+    result = Benchmark(document, size, repeat, maxThreads, chunkSize);
+    free(document);
+
+    return result;
+}
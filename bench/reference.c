@@ -0,0 +1,675 @@
+/*! \copyright 2017-2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Reference function-pointer parsing engine, as it was prior to the table-driven engine.
+ *         Used by benchmarks for comparison, and to verify the current engine produces the same
+ *         sequence of events. The only change is that tokens are discarded once delivered, as
+ *         the table-driven engine does, rather than being copied at the end of the buffer.
+ */
+#include "reference.h"
+#include "helpers.h"
+#include "scan.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* memchr, memcpy */
+#include <stdlib.h> /* malloc and free */
+
+#define SAXML_MIN_STRING_SIZE   2
+
+typedef int (*pfnParserStateHandler)(void *context, const char character);
+
+typedef struct
+{
+    tSaxmlContext *user;
+    const tSaxmlSpanContext *spans; /* optional (pointer, length) handlers */
+
+    pfnParserStateHandler pfnHandler;
+
+    int bInitialize; /* true for first call into a state */
+    int bInQuotedText; /* true if we're within quotes */
+    int bAllowTruncatedStrings; /* true if truncated parsing results are acceptable */
+
+    pfnScanHandler pfnScan; /* delimiter scanning kernel for runs of uninteresting characters */
+
+    char *buffer;
+    uint32_t maxStringSize;
+    uint32_t length;
+
+    /* When span handlers are registered, a token which is contiguous in the caller's input
+       is tracked here rather than being copied into buffer. At most one of length and
+       spanLength is nonzero. */
+    const char *position; /* current character, if it's within a caller-provided buffer */
+    const char *spanStart;
+    size_t spanLength;
+} tParserContext;
+
+static int state_Begin(void *context, const char character);
+static int state_StartTag(void *context, const char character);
+static int state_TagName(void *context, const char character);
+static int state_TagContents(void *context, const char character);
+static int state_EndTag(void *context, const char character);
+static int state_EmptyTag(void *context, const char character);
+static int state_Attribute(void *context, const char character);
+
+/* Characters which end a run within tag contents (after any leading whitespace) */
+static const tScanSet g_scanContents = { 2, { '<', '"' },
+    { 0, 0, 0, 0, 0x04, 0, 0, 0x10 } };
+/* Characters which end a run within an attribute */
+static const tScanSet g_scanAttribute = { 7, { ' ', '\t', '\r', '\n', '/', '>', '"' },
+    { 0, 0x26, 0, 0, 0x05, 0x80, 0, 0x40 } };
+/* Characters which end a run of quoted text, within either tag contents or an attribute */
+static const tScanSet g_scanQuoted = { 1, { '"' },
+    { 0, 0, 0, 0, 0x04 } };
+
+#define ChangeState(ctxt, state) \
+    (ctxt)->pfnHandler = state;  \
+    (ctxt)->bInitialize = 1;
+
+#define ContextBufferClear(ctxt) \
+    (ctxt)->length = 0;          \
+    (ctxt)->spanLength = 0;
+
+#define ContextTokenLength(ctxt) ((ctxt)->length + (ctxt)->spanLength)
+
+/* Copy a run of characters to the buffer. Returns the number of characters consumed, which
+ *  is less than length only if the buffer overflowed and truncation isn't allowed. */
+static size_t ContextBufferCopy(tParserContext *ctxt, const char *run, const size_t length)
+{
+    size_t copied = 0;
+
+    if(ctxt->length < ctxt->maxStringSize - 2)
+        copied = ctxt->maxStringSize - 2 - ctxt->length;
+    if(copied > length)
+        copied = length;
+
+    memcpy(&ctxt->buffer[ctxt->length], run, copied);
+    ctxt->length += (uint32_t) copied;
+
+    /* string truncated */
+    if(copied < length && ctxt->bAllowTruncatedStrings)
+        return length;
+    return copied;
+}
+
+/* Move a token being tracked in the caller's input into the buffer. Returns the number of
+ *  characters of the span consumed, which is less than the span length on overflow. */
+static size_t ContextBufferMaterialize(tParserContext *ctxt)
+{
+    size_t length = ctxt->spanLength;
+    ctxt->spanLength = 0;
+    return ContextBufferCopy(ctxt, ctxt->spanStart, length);
+}
+
+/* Add a run of characters from the caller's input to the token, with the same result as
+ *  calling ContextBufferAddChar for each. Returns the number of characters consumed, which
+ *  is less than length only if the buffer overflowed. */
+static size_t ContextBufferAddRun(tParserContext *ctxt, const char *run, const size_t length)
+{
+    size_t spanLength = ctxt->spanLength;
+
+    if(NULL != ctxt->spans)
+    {
+        if(ctxt->spanLength > 0)
+        {
+            if(run == ctxt->spanStart + ctxt->spanLength)
+            {
+                ctxt->spanLength += length;
+                return length;
+            }
+            if(ContextBufferMaterialize(ctxt) < spanLength)
+                return 0;
+        }
+        else if(0 == ctxt->length)
+        {
+            ctxt->spanStart = run;
+            ctxt->spanLength = length;
+            return length;
+        }
+    }
+
+    return ContextBufferCopy(ctxt, run, length);
+}
+
+static __inline int ContextBufferAddChar(tParserContext *ctxt, const char character)
+{
+    size_t spanLength = ctxt->spanLength;
+
+    if(NULL != ctxt->spans)
+    {
+        /* Track the character in place, unless it's a placeholder rather than the input */
+        if(NULL != ctxt->position && *ctxt->position == character)
+            return (ContextBufferAddRun(ctxt, ctxt->position, 1) == 1) ? 0 : SAXML_ERROR_BUFFER_OVERFLOW;
+        if(spanLength > 0 && ContextBufferMaterialize(ctxt) < spanLength)
+            return SAXML_ERROR_BUFFER_OVERFLOW;
+    }
+
+    if((ctxt)->length < ((ctxt)->maxStringSize) - 2)
+    {
+        (ctxt)->buffer[(ctxt)->length] = character;
+        ++((ctxt)->length);
+        return 0;
+    }
+
+    /* string truncated */
+    if(ctxt->bAllowTruncatedStrings)
+        return 0;
+    else
+        return SAXML_ERROR_BUFFER_OVERFLOW;
+}
+
+/* Deliver the current token to the span handler for an event if there is one, or to the
+ *  string handler otherwise */
+static int ContextEmit(tParserContext *ctxt, pfnStringHandler stringHandler,
+    pfnSpanHandler spanHandler)
+{
+    if(NULL != spanHandler)
+    {
+        if(ctxt->spanLength > 0)
+            spanHandler(ctxt->user->cookie, ctxt->spanStart, ctxt->spanLength);
+        else if(ctxt->length > 0)
+            spanHandler(ctxt->user->cookie, ctxt->buffer, ctxt->length);
+    }
+    else if(NULL != stringHandler && ContextTokenLength(ctxt) > 0)
+    {
+        if(ctxt->spanLength > 0)
+        {
+            size_t length = ctxt->spanLength;
+            if(ContextBufferMaterialize(ctxt) < length)
+                return SAXML_ERROR_BUFFER_OVERFLOW;
+        }
+        ctxt->buffer[ctxt->length] = '\0';
+        stringHandler(ctxt->user->cookie, ctxt->buffer);
+    }
+
+    return 0;
+}
+
+#define CallHandler(ctxt, handlerName)                                              \
+    if(ContextEmit((ctxt), (ctxt)->user->handlerName,                               \
+        (NULL != (ctxt)->spans) ? (ctxt)->spans->handlerName : NULL) != 0)          \
+        return SAXML_ERROR_BUFFER_OVERFLOW;
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+tSaxmlParser reference_Initialize(tSaxmlContext *context, const uint32_t maxStringSize)
+{
+    tParserContext *ctxt;
+
+    if(maxStringSize < SAXML_MIN_STRING_SIZE)
+        return NULL;
+    if(NULL == context)
+        return NULL;
+
+    ctxt = (tParserContext *) malloc(sizeof(*ctxt));
+    if(NULL == ctxt)
+        return NULL;
+
+    ctxt->buffer = (char *) malloc(maxStringSize);
+    if(NULL == ctxt->buffer)
+    {
+        free(ctxt);
+        return NULL;
+    }
+
+    ctxt->user = context;
+    ctxt->spans = NULL;
+    ctxt->length = 0;
+    ctxt->position = NULL;
+    ctxt->spanLength = 0;
+    ctxt->maxStringSize = maxStringSize;
+    ctxt->bAllowTruncatedStrings = 0;
+    ctxt->pfnScan = scan_SelectHandler();
+    ChangeState(ctxt, state_Begin);
+
+    return (tSaxmlParser) ctxt;
+}
+
+void reference_Deinitialize(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    if(NULL != ctxt)
+    {
+        if(NULL != ctxt->buffer)
+            free(ctxt->buffer);
+        free(ctxt);
+    }
+}
+
+int reference_HandleCharacter(tSaxmlParser parser, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    return ctxt->pfnHandler(ctxt, character);
+}
+
+int reference_HandleBuffer(tSaxmlParser parser, const char *buffer, const size_t length, size_t *offset)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *position = buffer;
+    const char *end = buffer + length;
+    const char *found;
+    const tScanSet *set;
+    size_t spanLength;
+    int result = 0;
+
+    while(position < end)
+    {
+        if(!ctxt->bInitialize)
+        {
+            set = NULL;
+            if(ctxt->pfnHandler == state_Begin)
+            {
+                /* Nothing but a tag start character is of interest here */
+                found = (const char *) memchr(position, '<', (size_t) (end - position));
+                if(NULL == found)
+                {
+                    position = end;
+                    break;
+                }
+                position = found;
+            }
+            else if(ctxt->pfnHandler == state_TagContents)
+            {
+                if(ctxt->bInQuotedText)
+                    set = &g_scanQuoted;
+                else if(ContextTokenLength(ctxt) > 0)
+                    set = &g_scanContents; /* leading whitespace is handled per-character */
+            }
+            else if(ctxt->pfnHandler == state_Attribute)
+                set = (ctxt->bInQuotedText) ? &g_scanQuoted : &g_scanAttribute;
+
+            if(NULL != set)
+            {
+                /* Every character up to the next delimiter is simply added to the buffer */
+                found = ctxt->pfnScan(position, end, set);
+                if(found != position)
+                {
+                    position += ContextBufferAddRun(ctxt, position, (size_t) (found - position));
+                    if(position != found)
+                    {
+                        result = SAXML_ERROR_BUFFER_OVERFLOW;
+                        break;
+                    }
+                    continue;
+                }
+            }
+        }
+
+        ctxt->position = position;
+        result = ctxt->pfnHandler(ctxt, *position);
+        if(0 != result)
+            break;
+        ++position;
+    }
+    ctxt->position = NULL;
+
+    /* A token tracked in place must be copied before the caller's buffer goes away */
+    if(ctxt->spanLength > 0)
+    {
+        spanLength = ctxt->spanLength;
+        found = ctxt->spanStart + ContextBufferMaterialize(ctxt);
+        if(0 == result && found < ctxt->spanStart + spanLength)
+        {
+            position = found;
+            result = SAXML_ERROR_BUFFER_OVERFLOW;
+        }
+    }
+
+    if(NULL != offset)
+        *offset = (size_t) (position - buffer);
+    return result;
+}
+
+void reference_Reset(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ChangeState(ctxt, state_Begin);
+}
+
+void reference_SetSpanHandlers(tSaxmlParser parser, const tSaxmlSpanContext *handlers)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->spans = handlers;
+}
+
+void reference_AllowTruncatedStrings(tSaxmlParser parser, const int allow)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->bAllowTruncatedStrings = (allow) ? 1 : 0;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * State Handlers
+ */
+
+/* Wait for a tag start character */
+static int state_Begin(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_Begin] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        DBG("[state_Begin] Initialize\n");
+        ContextBufferClear(ctxt);
+        ctxt->bInitialize = 0;
+    }
+
+    switch(character)
+    {
+        case '<':
+           nextState = state_StartTag;
+           break;
+        default:
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
+
+/* We've already found a tag start character, determine if this is start or end tag,
+ *  and parse the tag name */
+static int state_StartTag(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+
+    DBG1("[state_StartTag] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        DBG("[state_StartTag] Initialize\n");
+        ctxt->bInitialize = 0;
+    }
+
+    switch(character)
+    {
+        case '<': case '>':
+            /* Syntax error! */
+            return SAXML_ERROR_SYNTAX;
+        case ' ': case '\r': case '\n': case '\t':
+            /* Ignore whitespace */
+            break;
+        case '/':
+            ChangeState(ctxt, state_EndTag);
+            break;
+        default:
+            ContextBufferClear(ctxt);
+            if(NULL != ctxt->spans && NULL != ctxt->position)
+                ContextBufferAddRun(ctxt, ctxt->position, 1);
+            else
+            {
+                ctxt->buffer[0] = character;
+                ctxt->length = 1;
+            }
+            ChangeState(ctxt, state_TagName);
+            break;
+    }
+
+    return 0;
+}
+
+static int state_TagName(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_TagName] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        /* Expect one character in the buffer; the start of the tag name from the previous state*/
+        DBG("[state_TagName] Initialize\n");
+        ctxt->bInitialize = 0;
+    }
+
+    switch(character)
+    {
+        case ' ': case '\r': case '\n': case '\t':
+            /* Tag name complete, whitespace indicates tag attribute */
+            nextState = state_Attribute;
+            break;
+        case '/':
+            nextState = state_EmptyTag;
+            break;
+        case '>':
+            nextState = state_TagContents; /* Done with tag, contents may follow */
+            break;
+        default:
+            if(ContextBufferAddChar(ctxt, character) != 0)
+               return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        CallHandler(ctxt, tagHandler);
+        if(nextState != state_EmptyTag)
+        {
+            ContextBufferClear(ctxt);
+        }
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
+
+static int state_EmptyTag(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_EmptyTag] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        /* We need to keep the buffer as-is, since it contains the tag name */
+        DBG("[state_EmptyTag] Initialize\n");
+        ctxt->bInitialize = 0;
+    }
+
+    switch(character)
+    {
+        case '>':
+            nextState = state_TagContents;
+            break;
+        default:
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        CallHandler(ctxt, tagEndHandler);
+        ContextBufferClear(ctxt);
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
+
+static int state_TagContents(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_TagContents] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        DBG("[state_TagContents] Initialize\n");
+        ContextBufferClear(ctxt);
+        ctxt->bInitialize = 0;
+        ctxt->bInQuotedText = 0;
+    }
+
+    switch(character)
+    {
+        case '<':
+            if(0 == ctxt->bInQuotedText)
+                nextState = state_StartTag;
+            else
+            {
+                if(ContextBufferAddChar(ctxt, character) != 0)
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+            }
+            break;
+        case '"':
+            ctxt->bInQuotedText ^= 1;
+            if(ContextBufferAddChar(ctxt, character) != 0)
+                return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+        case ' ': case '\r': case '\n': case '\t':
+            if(0 == ctxt->bInQuotedText && 0 == ContextTokenLength(ctxt))
+                break; /* Ignore leading whitespace */
+            if(ContextBufferAddChar(ctxt, character) != 0)
+               return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+        default:
+            if(ContextBufferAddChar(ctxt, character) != 0)
+               return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        CallHandler(ctxt, contentHandler);
+        ContextBufferClear(ctxt);
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
+
+static int state_Attribute(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_Attribute] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        DBG("[state_Attribute] Initialize\n");
+        ContextBufferClear(ctxt);
+        ctxt->bInitialize = 0;
+        ctxt->bInQuotedText = 0;
+    }
+
+    switch(character)
+    {
+        case ' ': case '\r': case '\n': case '\t':
+            if(0 == ctxt->bInQuotedText)
+            {
+                if(0 != ContextTokenLength(ctxt))
+                    nextState = state_Attribute;
+            }
+            else
+            {
+                if(ContextBufferAddChar(ctxt, character) != 0)
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+            }
+            break;
+        case '/':
+            if(0 == ctxt->bInQuotedText)
+            {
+                /* Handle the case where an attribute is included in an empty tag,
+                   and the attribute name/value has no trailing whitespace
+                   prior to the empty tag terminator. */
+                if (ContextTokenLength(ctxt) > 0)
+                {
+                    CallHandler(ctxt, attributeHandler);
+                    ContextBufferClear(ctxt);
+                }
+
+                /* We've found an empty tag that contains at least one attribute.
+                   Since the buffer containing the tag name is long-gone (the attribute
+                   is now in the parser's string buffer), we don't have a way to get it
+                   back. In order to generate a "tagEnd" event, store a dummy string
+                   containing a single space character (which isn't a valid tag name),
+                   which will be provided to the tagEndHandler callback. */
+                if(ContextBufferAddChar(ctxt, ' ') != 0)
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+                nextState = state_EmptyTag;
+            }
+            else
+            {
+                if(ContextBufferAddChar(ctxt, character) != 0)
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+            }
+            break;
+        case '>':
+            if(0 == ctxt->bInQuotedText)
+                nextState = state_TagContents; /* Done with tag, contents may follow */
+            else
+            {
+                if(ContextBufferAddChar(ctxt, character) != 0)
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+            }
+            break;
+        case '"':
+            ctxt->bInQuotedText ^= 1;
+            ContextBufferAddChar(ctxt, character);
+            break;
+        default:
+            if(ContextBufferAddChar(ctxt, character) != 0)
+               return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        if(nextState != state_EmptyTag)
+        {
+            CallHandler(ctxt, attributeHandler);
+            ContextBufferClear(ctxt);
+        }
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
+
+static int state_EndTag(void *context, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) context;
+    pfnParserStateHandler nextState = NULL;
+
+    DBG1("[state_EndTag] %c\n", character);
+
+    if(ctxt->bInitialize)
+    {
+        DBG("[state_EndTag] Initialize\n");
+        ContextBufferClear(ctxt);
+        ctxt->bInitialize = 0;
+    }
+
+    switch(character)
+    {
+        case '<': /* syntax error */
+            return SAXML_ERROR_SYNTAX;
+        case ' ': case '\r': case '\n': case '\t':
+            /* Ignore whitespace */
+            break;
+        case '>':
+            nextState = state_TagContents;
+            break;
+        default:
+            if(ContextBufferAddChar(ctxt, character) != 0)
+               return SAXML_ERROR_BUFFER_OVERFLOW;
+            break;
+    }
+
+    if(NULL != nextState)
+    {
+        CallHandler(ctxt, tagEndHandler);
+        ContextBufferClear(ctxt);
+        ChangeState(ctxt, nextState);
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Reference function-pointer parsing engine, with the same API as saxml
+ */
+#ifndef SAXML_REFERENCE_H
+#define SAXML_REFERENCE_H
+
+#include "saxml/saxml.h"
+
+tSaxmlParser reference_Initialize(tSaxmlContext *context, const uint32_t maxStringSize);
+void reference_Deinitialize(tSaxmlParser parser);
+int reference_HandleCharacter(tSaxmlParser parser, const char character);
+int reference_HandleBuffer(tSaxmlParser parser, const char *buffer, const size_t length, size_t *offset);
+void reference_Reset(tSaxmlParser parser);
+void reference_SetSpanHandlers(tSaxmlParser parser, const tSaxmlSpanContext *handlers);
+void reference_AllowTruncatedStrings(tSaxmlParser parser, const int allow);
+
+#endif /* SAXML_REFERENCE_H */
@@ -0,0 +1,369 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Throughput of each parsing entry point, over generated documents of several shapes
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "saxml/saxml.h"
+#include "common.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNUSED(x) (void)x;
+
+#ifndef SAXML_VERSION
+   #define SAXML_VERSION "unknown"
+#endif
+
+#define BENCH_CHUNK_SIZE  65536 /* for saxml_HandleBuffer */
+#define BENCH_STRING_SIZE 256
+
+typedef struct
+{
+    const char *document;
+    size_t length;
+    const char *path; /* the document, written to a file */
+    uint32_t threads;
+    uint64_t *events; /* counted by the handlers, or by entry points which don't use them */
+} tInput;
+
+/* Handlers only count events, so that the parser dominates the measurement */
+static void CountString(void *cookie, const char *s) { UNUSED(s); ++(*(uint64_t *) cookie); }
+static void CountSpan(void *cookie, const char *s, size_t l)
+    { UNUSED(s); UNUSED(l); ++(*(uint64_t *) cookie); }
+
+static const tSaxmlSpanContext g_countSpans = { CountSpan, CountSpan, CountSpan, CountSpan };
+
+/* -----------------------------------------------------------------------------------------------
+ * Entry points
+ */
+
+static int RunCharacter(tSaxmlParser parser, const tInput *input)
+{
+    size_t i;
+    for(i = 0; i < input->length; ++i)
+    {
+        if(0 != saxml_HandleCharacter(parser, input->document[i]))
+            return -1;
+    }
+    return 0;
+}
+
+static int RunBuffer(tSaxmlParser parser, const tInput *input)
+{
+    size_t position, chunk;
+    for(position = 0; position < input->length; position += chunk)
+    {
+        chunk = input->length - position;
+        if(chunk > BENCH_CHUNK_SIZE)
+            chunk = BENCH_CHUNK_SIZE;
+        if(0 != saxml_HandleBuffer(parser, &input->document[position], chunk, NULL))
+            return -1;
+    }
+    return 0;
+}
+
+static int RunSpans(tSaxmlParser parser, const tInput *input)
+{
+    saxml_SetSpanHandlers(parser, &g_countSpans);
+    return saxml_HandleBuffer(parser, input->document, input->length, NULL);
+}
+
+static int RunValidated(tSaxmlParser parser, const tInput *input)
+{
+    saxml_SetSpanHandlers(parser, &g_countSpans);
+    saxml_EnableUtf8Validation(parser, 1);
+    return saxml_HandleBuffer(parser, input->document, input->length, NULL);
+}
+
+static int RunFile(tSaxmlParser parser, const tInput *input)
+{
+    saxml_SetSpanHandlers(parser, &g_countSpans);
+    return saxml_ParseFile(parser, input->path, NULL);
+}
+
+static int RunParallel(tSaxmlParser parser, const tInput *input)
+{
+    saxml_SetSpanHandlers(parser, &g_countSpans);
+    return saxml_ParseParallel(parser, input->document, input->length, input->threads, 0, NULL);
+}
+
+static int RunPull(tSaxmlParser parser, const tInput *input)
+{
+    tSaxmlParser pull;
+    tSaxmlToken token;
+    size_t position, chunk;
+    int result = 0;
+
+    UNUSED(parser);
+    pull = saxml_InitializePull(BENCH_STRING_SIZE);
+    if(NULL == pull)
+        return -1;
+    saxml_AllowTruncatedStrings(pull, 1);
+    for(position = 0; position < input->length && 0 == result; position += chunk)
+    {
+        chunk = input->length - position;
+        if(chunk > BENCH_CHUNK_SIZE)
+            chunk = BENCH_CHUNK_SIZE;
+        saxml_Feed(pull, &input->document[position], chunk);
+        while((result = saxml_NextToken(pull, &token)) > 0)
+            ++(*input->events);
+    }
+    saxml_Deinitialize(pull);
+    return result;
+}
+
+/* Build a tape of the document and replay it; the storage is kept for the next repetition,
+ *  so that the fastest doesn't include finding out how much is needed */
+static int RunTape(tSaxmlParser parser, const tInput *input)
+{
+    static void *storage = NULL;
+    static size_t storageSize = 0;
+    tSaxmlTape tape;
+    int result;
+
+    saxml_SetSpanHandlers(parser, &g_countSpans);
+    result = saxml_BuildTape(parser, input->document, input->length, storage, storageSize,
+        &tape, NULL);
+    if(SAXML_ERROR_BUFFER_OVERFLOW == result && tape.size > storageSize)
+    {
+        free(storage);
+        storageSize = tape.size;
+        storage = malloc(storageSize);
+        if(NULL == storage)
+        {
+            storageSize = 0;
+            return -1;
+        }
+        result = saxml_BuildTape(parser, input->document, input->length, storage, storageSize,
+            &tape, NULL);
+    }
+    if(0 == result)
+        result = saxml_ReplayTape(parser, &tape, 0, tape.count);
+    return result;
+}
+
+typedef struct
+{
+    const char *name;
+    int (*run)(tSaxmlParser parser, const tInput *input);
+} tEntryPoint;
+
+static const tEntryPoint g_entryPoints[] =
+{
+    { "HandleCharacter", RunCharacter },
+    { "HandleBuffer",    RunBuffer },
+    { "HandleBufferSpan", RunSpans },
+    { "HandleBufferUtf8", RunValidated },
+    { "ParseFile",       RunFile },
+    { "ParseParallel",   RunParallel },
+    { "NextToken",       RunPull },
+    { "Tape",            RunTape }
+};
+#define ENTRY_POINT_COUNT (sizeof(g_entryPoints) / sizeof(g_entryPoints[0]))
+
+/* -----------------------------------------------------------------------------------------------
+ * Measurement
+ */
+
+typedef struct
+{
+    uint64_t events;
+    double seconds; /* fastest of the repetitions */
+} tMeasurement;
+
+static int Measure(const tEntryPoint *entry, const tInput *input, uint32_t repeat,
+    tMeasurement *measurement)
+{
+    tSaxmlContext context;
+    tSaxmlParser parser;
+    uint32_t r;
+    double start, elapsed;
+    int result = 0;
+
+    context.cookie = input->events;
+    context.tagHandler = CountString;
+    context.tagEndHandler = CountString;
+    context.parameterHandler = NULL;
+    context.contentHandler = CountString;
+    context.attributeHandler = CountString;
+
+    measurement->seconds = 0.0;
+    for(r = 0; r < repeat && 0 == result; ++r)
+    {
+        parser = saxml_Initialize(&context, BENCH_STRING_SIZE);
+        if(NULL == parser)
+            return -1;
+        saxml_AllowTruncatedStrings(parser, 1);
+        *input->events = 0;
+
+        start = bench_Now();
+        result = entry->run(parser, input);
+        elapsed = bench_Now() - start;
+
+        saxml_Deinitialize(parser);
+        if(0 == r || elapsed < measurement->seconds)
+            measurement->seconds = elapsed;
+        measurement->events = *input->events;
+    }
+    return result;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * main
+ */
+
+static int WriteFile(const char *path, const char *data, size_t length)
+{
+    FILE *file = fopen(path, "wb");
+    size_t written;
+
+    if(NULL == file)
+        return -1;
+    written = fwrite(data, 1, length, file);
+    return (0 == fclose(file) && written == length) ? 0 : -1;
+}
+
+#define PROGRAM_OPTIONS "e:jm:r:s:t:w:?"
+
+static void DisplayHelp(const char *prog)
+{
+    fprintf(stderr, "%s <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   e [entry point]    Only measure this entry point (e.g. HandleBuffer)\n");
+    fprintf(stderr, "   j                  Write the results as JSON\n");
+    fprintf(stderr, "   m [megabytes]      Size of the generated document of each shape (default: 16)\n");
+    fprintf(stderr, "   r [count]          Number of times to parse each document; the fastest is reported (default: 3)\n");
+    fprintf(stderr, "   s [shape]          Only measure this shape (deep, attributes, text, small, quoted)\n");
+    fprintf(stderr, "   t [threads]        Threads for saxml_ParseParallel (default: number of cores, at least 2)\n");
+    fprintf(stderr, "   w [directory]      Only write the generated documents to this directory, as <shape>.xml\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *entryFilter = NULL, *shapeFilter = NULL, *directory = NULL;
+    char path[4096];
+    size_t size = 16;
+    uint32_t repeat = 3, shape, e;
+    int json = 0, arg, fd, result = 0, first = 1;
+    long cores;
+    char *document;
+    tInput input;
+    tMeasurement measurement;
+    uint64_t expectedEvents, events;
+
+    input.threads = 0;
+    input.events = &events;
+    while((arg = getopt(argc, argv, PROGRAM_OPTIONS)) != -1)
+    {
+        switch(arg)
+        {
+            case 'e': entryFilter = optarg; break;
+            case 'j': json = 1; break;
+            case 'm': size = strtoul(optarg, NULL, 10); break;
+            case 'r': repeat = strtoul(optarg, NULL, 10); break;
+            case 's': shapeFilter = optarg; break;
+            case 't': input.threads = strtoul(optarg, NULL, 10); break;
+            case 'w': directory = optarg; break;
+            default: DisplayHelp(argv[0]); return -1;
+        }
+    }
+
+    if(0 == input.threads)
+    {
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+        input.threads = (cores > 2) ? (uint32_t) cores : 2;
+    }
+
+    size *= 1024 * 1024;
+    document = (char *) malloc(size);
+    if(NULL == document || 0 == size || 0 == repeat)
+    {
+        DisplayHelp(argv[0]);
+        return -1;
+    }
+
+    if(json)
+        printf("{\n  \"version\": \"%s\",\n  \"results\": [", SAXML_VERSION);
+    for(shape = 0; shape < SHAPE_COUNT && 0 == result; ++shape)
+    {
+        if(NULL != shapeFilter && strcmp(shapeFilter, bench_ShapeName((eShape) shape)) != 0)
+            continue;
+        input.document = document;
+        input.length = bench_GenerateShape((eShape) shape, document, size);
+
+        if(NULL != directory)
+        {
+            sprintf(path, "%.4000s/%s.xml", directory, bench_ShapeName((eShape) shape));
+            result = WriteFile(path, document, input.length);
+            if(0 != result)
+                fprintf(stderr, "Failed to write '%s'\n", path);
+            continue;
+        }
+
+        /* saxml_ParseFile reads the same document back from a temporary file */
+        strcpy(path, "/tmp/saxml_bench_XXXXXX");
+        fd = mkstemp(path);
+        if(fd < 0 || 0 != close(fd) || 0 != WriteFile(path, document, input.length))
+        {
+            fprintf(stderr, "Failed to write temporary file\n");
+            result = -1;
+            break;
+        }
+        input.path = path;
+
+        expectedEvents = 0;
+        for(e = 0; e < ENTRY_POINT_COUNT && 0 == result; ++e)
+        {
+            if(NULL != entryFilter && strcmp(entryFilter, g_entryPoints[e].name) != 0)
+                continue;
+            result = Measure(&g_entryPoints[e], &input, repeat, &measurement);
+            if(0 != result)
+            {
+                fprintf(stderr, "%s failed on %s\n", g_entryPoints[e].name,
+                    bench_ShapeName((eShape) shape));
+                break;
+            }
+            /* Every entry point must see the same events */
+            if(0 == expectedEvents)
+                expectedEvents = measurement.events;
+            else if(expectedEvents != measurement.events)
+            {
+                fprintf(stderr, "%s reported %lu events on %s, rather than %lu\n",
+                    g_entryPoints[e].name, (unsigned long) measurement.events,
+                    bench_ShapeName((eShape) shape), (unsigned long) expectedEvents);
+                result = -1;
+                break;
+            }
+
+            if(json)
+            {
+                printf("%s\n    { \"shape\": \"%s\", \"entry\": \"%s\", \"bytes\": %lu, "
+                    "\"events\": %lu, \"seconds\": %.6f, \"mb_per_s\": %.2f, "
+                    "\"events_per_s\": %.0f, \"ns_per_byte\": %.3f }",
+                    first ? "" : ",", bench_ShapeName((eShape) shape), g_entryPoints[e].name,
+                    (unsigned long) input.length, (unsigned long) measurement.events,
+                    measurement.seconds, (double) input.length / measurement.seconds / 1e6,
+                    (double) measurement.events / measurement.seconds,
+                    measurement.seconds * 1e9 / (double) input.length);
+            }
+            else
+            {
+                printf("%-10s %-16s %8.1f MB/s  %7.2f Mevents/s  %6.2f ns/byte\n",
+                    bench_ShapeName((eShape) shape), g_entryPoints[e].name,
+                    (double) input.length / measurement.seconds / 1e6,
+                    (double) measurement.events / measurement.seconds / 1e6,
+                    measurement.seconds * 1e9 / (double) input.length);
+            }
+            first = 0;
+        }
+        remove(path);
+    }
+    if(json)
+        printf("\n  ]\n}\n");
+
+    free(document);
+    return result;
+}
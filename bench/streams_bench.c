@@ -0,0 +1,292 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parse very many interleaved streams, each with a parser of its own, and compare
+ *         pooled parsers (saxml_InitializePooled) against ones with buffers of their own, for
+ *         memory and throughput
+ */
+#include "saxml/saxml.h"
+#include "common.h"
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESSAGE_SIZE 512
+
+/* Each stream receives the same messages, one chunk at a time, interleaved with every other
+ *  stream handled by the same thread. A stream whose parser can't borrow a buffer is simply
+ *  retried on the next pass, as a server would retry a connection once a buffer is free. */
+typedef struct
+{
+    const char *message;
+    size_t messageLength;
+    uint32_t messageCount;
+    size_t chunkSize;          /* 0 for whole messages */
+    tSaxmlPool pool;           /* NULL for parsers with buffers of their own */
+    uint32_t maxStringSize;
+} tRunConfig;
+
+typedef struct
+{
+    const tRunConfig *config;
+    uint32_t streamCount;
+    char *storage;             /* for each stream's parser */
+    size_t parserSize;
+    tEventLog log;             /* sum of the streams' checksums, as their order varies */
+    uint64_t retries;          /* calls which failed with SAXML_ERROR_POOL */
+    int result;
+} tWorker;
+
+typedef struct
+{
+    tSaxmlParser parser;
+    tSaxmlContext context;
+    tEventLog log;
+    uint32_t message;
+    size_t offset;
+} tStream;
+
+static void *Worker(void *argument)
+{
+    tWorker *worker = (tWorker *) argument;
+    const tRunConfig *config = worker->config;
+    tStream *streams;
+    size_t length, offset;
+    uint32_t i, remaining;
+    int result;
+
+    worker->log.hash = 0;
+    worker->log.events = 0;
+    worker->retries = 0;
+    worker->result = 0;
+
+    streams = (tStream *) malloc(sizeof(*streams) * worker->streamCount);
+    if(NULL == streams)
+    {
+        worker->result = -1;
+        return NULL;
+    }
+    for(i = 0; i < worker->streamCount; ++i)
+    {
+        streams[i].context.cookie = &streams[i].log;
+        streams[i].context.tagHandler = bench_LogTag;
+        streams[i].context.tagEndHandler = bench_LogTagEnd;
+        streams[i].context.parameterHandler = NULL;
+        streams[i].context.contentHandler = bench_LogContent;
+        streams[i].context.attributeHandler = bench_LogAttribute;
+        bench_LogInitialize(&streams[i].log);
+        if(NULL != config->pool)
+            streams[i].parser = saxml_InitializePooledInPlace(
+                worker->storage + i * worker->parserSize, worker->parserSize,
+                &streams[i].context, config->pool);
+        else
+            streams[i].parser = saxml_InitializeInPlace(worker->storage + i * worker->parserSize,
+                worker->parserSize, &streams[i].context, config->maxStringSize);
+        saxml_SetSpanHandlers(streams[i].parser, &g_bench_spanHandlers);
+        streams[i].message = 0;
+        streams[i].offset = 0;
+    }
+
+    remaining = worker->streamCount;
+    while(remaining > 0 && 0 == worker->result)
+    {
+        for(i = 0; i < worker->streamCount; ++i)
+        {
+            tStream *s = &streams[i];
+            if(s->message == config->messageCount)
+                continue;
+
+            length = config->messageLength - s->offset;
+            if(0 != config->chunkSize && length > config->chunkSize)
+                length = config->chunkSize;
+            result = saxml_HandleBuffer(s->parser, config->message + s->offset, length, &offset);
+            if(SAXML_ERROR_POOL == result)
+                ++(worker->retries);
+            else if(0 != result)
+            {
+                fprintf(stderr, "Error %d in stream %lu\n", result, (unsigned long) i);
+                worker->result = result;
+                break;
+            }
+            s->offset += offset;
+            if(s->offset == config->messageLength)
+            {
+                s->offset = 0;
+                if(++(s->message) == config->messageCount)
+                    --remaining;
+            }
+        }
+    }
+
+    for(i = 0; i < worker->streamCount; ++i)
+    {
+        saxml_Deinitialize(streams[i].parser);
+        worker->log.hash += streams[i].log.hash;
+        worker->log.events += streams[i].log.events;
+    }
+    free(streams);
+    return NULL;
+}
+
+/* Parse every stream on threadCount threads. Returns 0 on success, with the combined checksum
+ *  of every stream's events in *log. */
+static int Run(const tRunConfig *config, uint32_t streamCount, uint32_t threadCount,
+    tEventLog *log, uint64_t *retries, double *seconds)
+{
+    tWorker *workers;
+    pthread_t *threads;
+    char *storage;
+    size_t parserSize;
+    uint32_t i, first = 0;
+    double start;
+    int result = 0;
+
+    parserSize = (NULL != config->pool) ? saxml_PooledStorageSize()
+        : saxml_StorageSize(config->maxStringSize);
+    storage = (char *) malloc(parserSize * streamCount);
+    workers = (tWorker *) malloc(sizeof(*workers) * threadCount);
+    threads = (pthread_t *) malloc(sizeof(*threads) * threadCount);
+    if(NULL == storage || NULL == workers || NULL == threads)
+        result = -1;
+
+    start = bench_Now();
+    for(i = 0; 0 == result && i < threadCount; ++i)
+    {
+        workers[i].config = config;
+        workers[i].streamCount = (streamCount - first) / (threadCount - i);
+        workers[i].storage = storage + first * parserSize;
+        workers[i].parserSize = parserSize;
+        first += workers[i].streamCount;
+        if(0 != pthread_create(&threads[i], NULL, Worker, &workers[i]))
+            result = -1;
+    }
+    threadCount = i;
+
+    log->hash = 0;
+    log->events = 0;
+    *retries = 0;
+    for(i = 0; i < threadCount; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        log->hash += workers[i].log.hash;
+        log->events += workers[i].log.events;
+        *retries += workers[i].retries;
+        if(0 != workers[i].result)
+            result = workers[i].result;
+    }
+    *seconds = bench_Now() - start;
+
+    free(threads);
+    free(workers);
+    free(storage);
+    return result;
+}
+
+/* -----------------------------------------------------------------------------------------------
+ * main
+ */
+
+#define PROGRAM_OPTIONS "b:c:m:s:t:v?"
+
+static void DisplayHelp(const char *prog)
+{
+    fprintf(stderr, "%s <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   b [buffers]        Buffers in the pool (default: 2 for each thread)\n");
+    fprintf(stderr, "   c [bytes]          Deliver messages in chunks of this size, so that strings cross calls (default: whole messages)\n");
+    fprintf(stderr, "   m [count]          Messages for each stream (default: 5)\n");
+    fprintf(stderr, "   s [streams]        Number of streams (default: 100000)\n");
+    fprintf(stderr, "   t [threads]        Number of threads (default: 4)\n");
+    fprintf(stderr, "   v                  Fail unless pooled parsers deliver the same events\n");
+}
+
+int main(int argc, char *argv[])
+{
+    char message[MESSAGE_SIZE];
+    tRunConfig config;
+    tEventLog pooled, unpooled;
+    uint64_t pooledRetries, unpooledRetries;
+    double pooledSeconds, unpooledSeconds;
+    uint32_t streamCount = 100000, threadCount = 4, bufferCount = 0;
+    int verify = 0;
+    int arg, result;
+
+    config.messageCount = 5;
+    config.chunkSize = 0;
+    config.maxStringSize = 256;
+    while((arg = getopt(argc, argv, PROGRAM_OPTIONS)) != -1)
+    {
+        switch(arg)
+        {
+            case 'b': bufferCount = strtoul(optarg, NULL, 10); break;
+            case 'c': config.chunkSize = strtoul(optarg, NULL, 10); break;
+            case 'm': config.messageCount = strtoul(optarg, NULL, 10); break;
+            case 's': streamCount = strtoul(optarg, NULL, 10); break;
+            case 't': threadCount = strtoul(optarg, NULL, 10); break;
+            case 'v': verify = 1; break;
+            default: DisplayHelp(argv[0]); return -1;
+        }
+    }
+    if(0 == threadCount || streamCount < threadCount || 0 == config.messageCount)
+    {
+        DisplayHelp(argv[0]);
+        return -1;
+    }
+    if(0 == bufferCount)
+        bufferCount = 2 * threadCount;
+
+    bench_Seed(1);
+    config.message = message;
+    config.messageLength = bench_GenerateShape(SHAPE_SMALL, message, sizeof(message));
+
+    config.pool = NULL;
+    result = Run(&config, streamCount, threadCount, &unpooled, &unpooledRetries,
+        &unpooledSeconds);
+    if(0 != result)
+        return -1;
+
+    config.pool = saxml_CreatePool(bufferCount, config.maxStringSize);
+    if(NULL == config.pool)
+        return -1;
+    result = Run(&config, streamCount, threadCount, &pooled, &pooledRetries, &pooledSeconds);
+    if(0 == result && saxml_PoolAvailable(config.pool) != bufferCount)
+    {
+        fprintf(stderr, "Pool buffers weren't returned\n");
+        result = -1;
+    }
+    saxml_DestroyPool(config.pool);
+    if(0 != result)
+        return -1;
+
+    if(pooled.hash != unpooled.hash || pooled.events != unpooled.events)
+    {
+        fprintf(stderr, "Event mismatch (%lu pooled, %lu unpooled)\n",
+            (unsigned long) pooled.events, (unsigned long) unpooled.events);
+        return -1;
+    }
+    if(verify)
+    {
+        printf("Pooled events match (%lu events, %lu retries)\n", (unsigned long) pooled.events,
+            (unsigned long) pooledRetries);
+        return 0;
+    }
+
+    printf("%lu streams, %lu threads, %lu messages of %lu bytes each\n",
+        (unsigned long) streamCount, (unsigned long) threadCount,
+        (unsigned long) config.messageCount, (unsigned long) config.messageLength);
+    printf("%-10s %14s %16s %10s %10s\n", "parsers", "bytes/stream", "total bytes", "MB/s",
+        "retries");
+    printf("%-10s %14lu %16lu %10.1f %10lu\n", "own",
+        (unsigned long) saxml_StorageSize(config.maxStringSize),
+        (unsigned long) (saxml_StorageSize(config.maxStringSize) * streamCount),
+        (double) config.messageLength * config.messageCount * streamCount / unpooledSeconds / 1e6,
+        (unsigned long) unpooledRetries);
+    printf("%-10s %14lu %16lu %10.1f %10lu\n", "pooled",
+        (unsigned long) saxml_PooledStorageSize(),
+        (unsigned long) (saxml_PooledStorageSize() * streamCount
+            + saxml_PoolStorageSize(bufferCount, config.maxStringSize)),
+        (double) config.messageLength * config.messageCount * streamCount / pooledSeconds / 1e6,
+        (unsigned long) pooledRetries);
+    return 0;
+}
@@ -6,6 +6,7 @@
 #define SAXML_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef void (*pfnStringHandler)(void *cookie, const char *szString);
 
@@ -19,10 +20,177 @@ typedef struct
     pfnStringHandler attributeHandler;
 } tSaxmlContext;
 
+/*! \brief Zero-copy alternative to pfnStringHandler
+ *  \param cookie Value of the cookie member of the tSaxmlContext provided to saxml_Initialize
+ *  \param data Start of the string. This is not NUL-terminated, and is only valid for the
+ *              duration of the call. When the string is contiguous within the buffer provided to
+ *              saxml_HandleBuffer, this points directly into that buffer.
+ *  \param length Number of characters in the string
+ */
+typedef void (*pfnSpanHandler)(void *cookie, const char *data, size_t length);
+
+typedef struct
+{
+    pfnSpanHandler tagHandler;
+    pfnSpanHandler tagEndHandler;
+    pfnSpanHandler contentHandler;
+    pfnSpanHandler attributeHandler;
+} tSaxmlSpanContext;
+
+/*! \brief Attribute region of a start tag; everything between the tag name and the closing '>'
+ *         or '/>', exactly as it appears in the document. Use saxml_NextAttribute or
+ *         saxml_FindAttribute to access individual attributes.
+ */
+typedef struct
+{
+    const char *data;
+    size_t length;
+} tSaxmlAttributes;
+
+/*! \brief A single attribute. The value has its surrounding quotes removed; for an attribute
+ *         with no value (e.g. 'name' rather than 'name="value"'), value is NULL.
+ */
+typedef struct
+{
+    const char *name;
+    size_t nameLength;
+    const char *value;
+    size_t valueLength;
+} tSaxmlAttribute;
+
+/*! \brief Handler for the attribute region of a start tag
+ *  \param cookie Value of the cookie member of the tSaxmlContext provided to saxml_Initialize
+ *  \param attributes Attribute region, which is only valid for the duration of the call
+ */
+typedef void (*pfnAttributesHandler)(void *cookie, const tSaxmlAttributes *attributes);
+
+/*! \brief Handler for an event whose name is in the parser's vocabulary (see
+ *         saxml_SetIdHandlers)
+ *  \param cookie Value of the cookie member of the tSaxmlContext provided to saxml_Initialize
+ *  \param id Index of the tag name (or, for attributes, of the attribute name) within the
+ *            vocabulary, or SAXML_UNKNOWN_ID if it isn't in the vocabulary
+ *  \param data Start of the string, as for pfnSpanHandler
+ *  \param length Number of characters in the string
+ */
+typedef void (*pfnIdHandler)(void *cookie, int32_t id, const char *data, size_t length);
+
+typedef struct
+{
+    pfnIdHandler tagHandler;
+    pfnIdHandler tagEndHandler;
+    pfnIdHandler attributeHandler;
+} tSaxmlIdContext;
+
+/*! \brief Handler for part of a string which may be longer than the parser's string buffer
+ *         (see saxml_SetFragmentHandlers)
+ *  \param cookie Value of the cookie member of the tSaxmlContext provided to saxml_Initialize
+ *  \param data Start of the fragment, as for pfnSpanHandler
+ *  \param length Number of characters in the fragment; may be zero for the last fragment
+ *  \param more Nonzero if more of the same string follows in the next call, zero if this is
+ *              the last fragment of the string
+ */
+typedef void (*pfnFragmentHandler)(void *cookie, const char *data, size_t length, int more);
+
+typedef struct
+{
+    pfnFragmentHandler contentHandler;
+    pfnFragmentHandler attributeHandler;
+} tSaxmlFragmentContext;
+
+/*! \brief Handler for the start or end of a document within a stream of concatenated
+ *         documents (see saxml_SetDocumentHandlers)
+ *  \param cookie Value of the cookie member of the tSaxmlContext provided to saxml_Initialize
+ *  \param index Number of documents which ended before this one started
+ */
+typedef void (*pfnDocumentHandler)(void *cookie, uint32_t index);
+
+typedef struct
+{
+    pfnDocumentHandler startHandler; /* before the root element's tag event */
+    pfnDocumentHandler endHandler;   /* after the root element's end tag event */
+} tSaxmlDocumentContext;
+
+/*! \brief Token returned by a pull parser (see saxml_NextToken)
+ */
+typedef struct
+{
+    int type;         /* one of SAXML_TOKEN_* */
+    const char *data; /* start of the string, as for pfnSpanHandler */
+    size_t length;    /* number of characters in the string */
+} tSaxmlToken;
+
+#define SAXML_TAPE_NONE   ((uint32_t) 0xFFFFFFFFu) /* no matching entry */
+#define SAXML_TAPE_COPIED 0x01 /* the entry's data is in the tape's storage, not the document */
+
+/*! \brief Entry in a tape (see saxml_BuildTape); one for each token, in document order
+ */
+typedef struct
+{
+    uint8_t type;    /* one of SAXML_TOKEN_* */
+    uint8_t flags;   /* SAXML_TAPE_COPIED, or zero */
+    uint32_t offset; /* of the data within the document (or, if copied, the tape's strings) */
+    uint32_t length; /* number of characters in the data */
+    uint32_t match;  /* for a tag, the index of its end tag; for an end tag, that of its tag;
+                        otherwise, that of the enclosing tag. SAXML_TAPE_NONE if there's none. */
+} tSaxmlTapeEntry;
+
+/*! \brief Index of the tokens of a whole document, built by saxml_BuildTape. Each entry's data
+ *         is at document + offset, or strings + offset if it's copied (see saxml_TapeData).
+ *         The subtree of the tag at index i ends at entries[i].match, so it can be passed over
+ *         by continuing from there.
+ */
+typedef struct
+{
+    const char *document;
+    const tSaxmlTapeEntry *entries;
+    uint32_t count;
+    const char *strings; /* data which isn't contiguous within the document */
+    size_t size;         /* bytes of storage used, or needed if the storage was too small */
+} tSaxmlTape;
+
+/*! \brief Statistics collected by a parser, when saxml is built with SAXML_STATS (see
+ *         saxml_GetStats). Events are counted by kind, whichever variant of handler (string,
+ *         span, ID or fragment) they're delivered to, and whether or not a handler is
+ *         registered; events outside of subscribed subtrees aren't counted.
+ */
+typedef struct
+{
+    uint64_t bytes;              /* characters parsed */
+    uint64_t tags;               /* start tag events */
+    uint64_t tagEnds;            /* end tag events, including those for empty tags */
+    uint64_t contents;           /* content events, including CDATA sections */
+    uint64_t attributes;         /* attribute events */
+    uint64_t attributeRegions;   /* events for the attributes handler */
+    uint32_t maxDepth;           /* greatest element depth reached */
+    uint32_t maxStringLength;    /* most characters ever held in the parser's string buffer */
+    uint32_t maxStringSize;      /* as passed to saxml_Initialize; at most maxStringSize - 2
+                                    characters fit in the string buffer */
+    uint64_t truncatedCharacters; /* characters dropped from truncated strings */
+    uint64_t errors;             /* parsing calls which failed with one of SAXML_ERROR_* */
+    uint64_t handlerTicks;       /* with SAXML_STATS_TIMING, time within handlers */
+    uint64_t parserTicks;        /* with SAXML_STATS_TIMING, time within the parser, excluding
+                                    handlers */
+} tSaxmlStats;
+
 typedef void *tSaxmlParser;
+typedef void *tSaxmlVocabulary;
+typedef void *tSaxmlPool;
+
+#define SAXML_UNKNOWN_ID              -1  /* name isn't in the vocabulary */
 
 #define SAXML_ERROR_SYNTAX            -1  /* error in XML syntax */
 #define SAXML_ERROR_BUFFER_OVERFLOW   -2  /* insufficient space in parser buffer */
+#define SAXML_ERROR_STACK_OVERFLOW    -3  /* insufficient space in element stack */
+#define SAXML_ERROR_FILE              -4  /* file couldn't be opened or read; see errno */
+#define SAXML_ERROR_STATE             -5  /* saved state is invalid, or doesn't fit the parser */
+#define SAXML_ERROR_ENCODING          -6  /* input isn't valid UTF-8 (or UTF-16) */
+#define SAXML_ERROR_POOL              -7  /* no buffer free in the parser's pool */
+
+#define SAXML_TOKEN_NONE               0  /* no more tokens until more input is provided */
+#define SAXML_TOKEN_TAG                1  /* start tag name */
+#define SAXML_TOKEN_TAG_END            2  /* end tag name */
+#define SAXML_TOKEN_CONTENT            3  /* tag contents */
+#define SAXML_TOKEN_ATTRIBUTE          4  /* attribute, e.g. 'name="value"' */
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,15 +203,117 @@ extern "C" {
  *                       parser encounters a string longer than this, it will be
  *                       truncated to this length when provided via the szString
  *                       parameter of the corresponding pfnStringHandler function.
- *  \return parser instance
+ *  \return parser instance, or NULL on failure. When saxml is built with SAXML_NO_MALLOC,
+ *          this always fails; use saxml_InitializeInPlace instead.
  */
 tSaxmlParser saxml_Initialize(tSaxmlContext *context, const uint32_t maxStringSize);
 
+/*! \brief Determine the amount of storage required by saxml_InitializeInPlace
+ *  \param maxStringSize Maximum number of characters for parsed strings (see saxml_Initialize)
+ *  \return Number of bytes of storage required
+ */
+size_t saxml_StorageSize(const uint32_t maxStringSize);
+
+/*! \brief Create an XML parsing instance within caller-provided storage, without any dynamic
+ *         memory allocation. Parser instances share no state, so any number may exist, and
+ *         different instances may be used concurrently from different threads.
+ *  \param storage Memory in which to place the parser, of any alignment. This must remain valid,
+ *                 and must not otherwise be modified, for as long as the parser is in use.
+ *  \param storageSize Size of storage, in bytes. Must be at least the value returned by
+ *                     saxml_StorageSize for the same maxStringSize.
+ *  \param context Pointer to structure containing pointers to parsing handling functions
+ *                 (see saxml_Initialize)
+ *  \param maxStringSize Maximum number of characters for parsed strings (see saxml_Initialize)
+ *  \return parser instance, or NULL if the arguments are invalid. The instance doesn't need to be
+ *          passed to saxml_Deinitialize (though it's harmless to do so); the storage may simply be
+ *          reused once the parser is no longer needed.
+ */
+tSaxmlParser saxml_InitializeInPlace(void *storage, const size_t storageSize,
+    tSaxmlContext *context, const uint32_t maxStringSize);
+
 /*! \brief Destroy an XML parsing instance
- *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize,
+ *                saxml_InitializePooled or one of their InPlace variants
  */
 void saxml_Deinitialize(tSaxmlParser parser);
 
+/*! \brief Create a pool of string buffers, shared by parsers created with
+ *         saxml_InitializePooled. A pooled parser borrows a buffer only while a string is being
+ *         buffered (e.g. one which continues into the next call), and returns it as soon as it
+ *         has been delivered, so a server with very many mostly idle streams needs only as many
+ *         buffers as it has strings in flight at once. Pools are lock-free, and may be shared by
+ *         parsers in use on different threads unless saxml is built with SAXML_NO_THREADS.
+ *  \param bufferCount Number of buffers
+ *  \param maxStringSize Maximum number of characters for parsed strings, as for
+ *                       saxml_Initialize, for every parser using the pool
+ *  \return pool instance, or NULL on failure. When saxml is built with SAXML_NO_MALLOC, this
+ *          always fails; use saxml_CreatePoolInPlace instead.
+ */
+tSaxmlPool saxml_CreatePool(const uint32_t bufferCount, const uint32_t maxStringSize);
+
+/*! \brief Determine the amount of storage required by saxml_CreatePoolInPlace
+ *  \param bufferCount Number of buffers (see saxml_CreatePool)
+ *  \param maxStringSize Maximum number of characters for parsed strings (see saxml_CreatePool)
+ *  \return Number of bytes of storage required
+ */
+size_t saxml_PoolStorageSize(const uint32_t bufferCount, const uint32_t maxStringSize);
+
+/*! \brief Create a pool of string buffers within caller-provided storage
+ *  \param storage Memory in which to place the pool, of any alignment, which must remain valid
+ *                 for as long as the pool is in use
+ *  \param storageSize Size of storage, in bytes. Must be at least the value returned by
+ *                     saxml_PoolStorageSize for the same bufferCount and maxStringSize.
+ *  \param bufferCount Number of buffers (see saxml_CreatePool)
+ *  \param maxStringSize Maximum number of characters for parsed strings (see saxml_CreatePool)
+ *  \return pool instance, or NULL if the arguments are invalid
+ */
+tSaxmlPool saxml_CreatePoolInPlace(void *storage, const size_t storageSize,
+    const uint32_t bufferCount, const uint32_t maxStringSize);
+
+/*! \brief Destroy a pool of string buffers, once no parser uses it
+ *  \param pool tSaxmlPool instance, obtained from a call to saxml_CreatePool or
+ *              saxml_CreatePoolInPlace
+ */
+void saxml_DestroyPool(tSaxmlPool pool);
+
+/*! \brief Determine how many of a pool's buffers aren't borrowed by any parser
+ *  \param pool tSaxmlPool instance
+ *  \return Number of free buffers
+ */
+uint32_t saxml_PoolAvailable(const tSaxmlPool pool);
+
+/*! \brief Create an XML parsing instance which borrows its string buffer from a pool (see
+ *         saxml_CreatePool), rather than holding one of its own. An idle parser is then just
+ *         its state, saxml_PooledStorageSize bytes. If a buffer is needed and none is free,
+ *         parsing fails with SAXML_ERROR_POOL, and the offset is that of the first character
+ *         which wasn't parsed; parsing may continue from there once a buffer is free. Pooled
+ *         parsers are otherwise the same as any other.
+ *  \param context Pointer to structure containing pointers to parsing handling functions
+ *                 (see saxml_Initialize)
+ *  \param pool Pool from which to borrow a buffer, which must outlive the parser
+ *  \return parser instance, or NULL on failure. When saxml is built with SAXML_NO_MALLOC,
+ *          this always fails; use saxml_InitializePooledInPlace instead.
+ */
+tSaxmlParser saxml_InitializePooled(tSaxmlContext *context, tSaxmlPool pool);
+
+/*! \brief Determine the amount of storage required by saxml_InitializePooledInPlace
+ *  \return Number of bytes of storage required
+ */
+size_t saxml_PooledStorageSize(void);
+
+/*! \brief Create a pooled XML parsing instance (see saxml_InitializePooled) within
+ *         caller-provided storage (see saxml_InitializeInPlace)
+ *  \param storage Memory in which to place the parser, of any alignment
+ *  \param storageSize Size of storage, in bytes; at least saxml_PooledStorageSize()
+ *  \param context Pointer to structure containing pointers to parsing handling functions
+ *  \param pool Pool from which to borrow a buffer, which must outlive the parser
+ *  \return parser instance, or NULL if the arguments are invalid. Unlike other parsers created
+ *          in place, the instance must be passed to saxml_Deinitialize (or saxml_Reset) before
+ *          the storage is reused, to return any buffer it has borrowed.
+ */
+tSaxmlParser saxml_InitializePooledInPlace(void *storage, const size_t storageSize,
+    tSaxmlContext *context, tSaxmlPool pool);
+
 /*! \brief Provide a single character to the XML parser. Based on the processing of this
  *         character, one of the pfnStringHandler functions may be called.
  *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
@@ -52,11 +322,474 @@ void saxml_Deinitialize(tSaxmlParser parser);
  */
 int saxml_HandleCharacter(tSaxmlParser parser, const char character);
 
+/*! \brief Provide a buffer of characters to the XML parser. This produces exactly the same
+ *         sequence of pfnStringHandler calls as passing each character, in order, to
+ *         saxml_HandleCharacter, but without the per-character call overhead. The buffer
+ *         does not need to contain complete XML elements; parsing state is retained between
+ *         calls.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param buffer Characters to process
+ *  \param length Number of characters in buffer
+ *  \param offset If not NULL, receives the number of characters successfully processed. On
+ *                error, this is the offset within buffer of the character that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not. Parsing stops at the first error.
+ */
+int saxml_HandleBuffer(tSaxmlParser parser, const char *buffer, const size_t length, size_t *offset);
+
+#define SAXML_UTF16_LE 0 /* little-endian */
+#define SAXML_UTF16_BE 1 /* big-endian */
+
+/*! \brief Provide a buffer of UTF-16 characters to the XML parser, which are transcoded to UTF-8
+ *         as they're parsed; every handler receives UTF-8. Code units and surrogate pairs may be
+ *         split across buffers. A byte order mark is passed through, as for one in UTF-8 input.
+ *         Strings are transcoded in small blocks, so span handlers receive strings from the
+ *         parser's buffer rather than from the caller's.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param buffer UTF-16 input
+ *  \param length Number of bytes in buffer
+ *  \param byteOrder SAXML_UTF16_LE or SAXML_UTF16_BE
+ *  \param offset If not NULL, receives the number of bytes successfully processed. On error,
+ *                this is the offset within buffer of the code unit that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not; SAXML_ERROR_ENCODING for an
+ *          unpaired surrogate, at a low surrogate or the code unit following a high surrogate
+ */
+int saxml_HandleBufferUtf16(tSaxmlParser parser, const char *buffer, const size_t length,
+    const int byteOrder, size_t *offset);
+
+/*! \brief Parse a large buffer on multiple threads. The buffer is split into chunks at tag start
+ *         characters, which are parsed speculatively by worker threads; the events are then
+ *         delivered on the calling thread, in document order, exactly as saxml_HandleBuffer
+ *         would deliver them. Chunks for which the speculation turns out to be wrong (e.g. a
+ *         '<' within quoted text) are parsed again on the calling thread. Span handlers may
+ *         receive strings which cross chunk boundaries, since the whole buffer is available.
+ *         If an element stack is set (see saxml_SetElementStack), when saxml is built with
+ *         SAXML_NO_MALLOC or SAXML_NO_THREADS, or if the buffer is no larger than a single
+ *         chunk, this is equivalent to saxml_HandleBuffer. saxml_SkipCurrentElement takes
+ *         effect as it would for saxml_HandleBuffer; the rest of the chunk in which it's
+ *         called is parsed again on the calling thread.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param buffer Characters to process; typically a whole document or a mapped file
+ *  \param length Number of characters in buffer
+ *  \param threadCount Number of worker threads; less than 2 parses on the calling thread only
+ *  \param chunkSize Nominal size of each chunk, in bytes; 0 for the default of 1MB
+ *  \param offset As for saxml_HandleBuffer
+ *  \return As for saxml_HandleBuffer
+ */
+int saxml_ParseParallel(tSaxmlParser parser, const char *buffer, const size_t length,
+    const uint32_t threadCount, const size_t chunkSize, size_t *offset);
+
+/*! \brief Parse the contents of a file. Regular files are mapped into memory and parsed as a
+ *         single buffer, as by saxml_HandleBuffer, so span handlers receive strings of any
+ *         length without copying. Pipes, devices and files which can't be mapped are read in
+ *         large chunks instead. Parsing state is retained afterwards, as for saxml_HandleBuffer.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param path Path of the file to parse
+ *  \param offset If not NULL, receives the number of bytes successfully processed. On error,
+ *                this is the offset within the file of the byte that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not. SAXML_ERROR_FILE indicates that
+ *          the file couldn't be opened or read, in which case errno describes the problem.
+ */
+int saxml_ParseFile(tSaxmlParser parser, const char *path, size_t *offset);
+
+#define SAXML_INGEST_AUTO       0 /* the best available of the following */
+#define SAXML_INGEST_SERIAL     1 /* read, then parse, on the calling thread */
+#define SAXML_INGEST_THREAD     2 /* read on a thread of its own, while parsing */
+#define SAXML_INGEST_IO_URING   3 /* read asynchronously with io_uring (Linux), while parsing */
+
+/*! \brief Parse everything which can be read from a file descriptor (e.g. standard input, a
+ *         pipe or a socket) until the end of its input. Data is read in large chunks, and
+ *         except with SAXML_INGEST_SERIAL, the next chunk is read into one buffer while the
+ *         last is parsed from the other, so time spent waiting for input overlaps with
+ *         parsing. Each chunk is handed over as soon as a read returns it, so a stream of
+ *         messages is parsed as each arrives. Parsing state is retained afterwards, as for
+ *         saxml_HandleBuffer.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param fd File descriptor to read from, which isn't closed
+ *  \param mode One of SAXML_INGEST_*. SAXML_INGEST_THREAD is available where saxml is built
+ *              with threads and dynamic memory allocation, and SAXML_INGEST_IO_URING also
+ *              needs a Linux kernel which permits io_uring (5.6 or later).
+ *  \param offset If not NULL, receives the number of bytes successfully processed. On error,
+ *                this is the offset within the input of the byte that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not. SAXML_ERROR_FILE indicates that
+ *          the descriptor couldn't be read, in which case errno describes the problem; errno is
+ *          ENOSYS if the requested mode isn't available, in which case nothing has been read.
+ */
+int saxml_ParseDescriptor(tSaxmlParser parser, const int fd, const int mode, size_t *offset);
+
+#define SAXML_RECORDS_ORDERED   0 /* events delivered on the calling thread, in record order */
+#define SAXML_RECORDS_UNORDERED 1 /* events delivered on worker threads, as records are parsed */
+
+/*! \brief Parse a buffer of concatenated documents (records) on multiple threads. The buffer
+ *         is split at the end of each root element, and each record (the root element, and
+ *         anything before it) is parsed from the start by a worker thread with a parser of its
+ *         own, configured like this one. The parser is reset first, and each record is framed
+ *         by the document handlers (see saxml_SetDocumentHandlers), if any. With
+ *         SAXML_RECORDS_ORDERED, the events are delivered on the calling thread, exactly as
+ *         saxml_HandleBuffer would deliver them with saxml_Reset called before each record.
+ *         With SAXML_RECORDS_UNORDERED, each record's events are delivered by the worker thread
+ *         which parsed it, as it parses it; handlers are then called concurrently, and must
+ *         use the document start handler's index (or thread-local state) to tell records
+ *         apart. Calls to saxml_SkipCurrentElement are ignored. When saxml is built with
+ *         SAXML_NO_MALLOC or SAXML_NO_THREADS, or threadCount is less than 2, the records are
+ *         parsed in order on the calling thread.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param buffer Characters to process
+ *  \param length Number of characters in buffer
+ *  \param threadCount Number of worker threads
+ *  \param delivery SAXML_RECORDS_ORDERED or SAXML_RECORDS_UNORDERED
+ *  \param offset If not NULL, receives the number of characters successfully processed: the end
+ *                of the last complete record, so that a trailing partial record can be passed
+ *                again, completed, in the next call. On error, this is the offset within
+ *                buffer of the character that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not. With SAXML_RECORDS_ORDERED,
+ *          parsing stops at the first error; with SAXML_RECORDS_UNORDERED, records after the
+ *          one which failed may already have been delivered.
+ */
+int saxml_ParseRecords(tSaxmlParser parser, const char *buffer, const size_t length,
+    const uint32_t threadCount, const int delivery, size_t *offset);
+
+/*! \brief Parse a whole document once, recording each token in a tape which can then be
+ *         replayed (see saxml_ReplayTape) or walked directly, as many times as needed, without
+ *         parsing the document again. Tokens are those that span handlers would receive, except
+ *         that an empty tag's end tag token is its tag name, as with an element stack. The
+ *         parser's truncation setting applies (to tokens which must be copied), but nothing
+ *         else of its configuration: references aren't decoded, and every token is recorded.
+ *         The parser is reset before and after.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param buffer Document; it must remain valid for as long as the tape is used
+ *  \param length Number of characters in buffer, less than 4GB
+ *  \param storage Memory for the tape's entries and copied strings
+ *  \param storageSize Size of storage, in bytes
+ *  \param tape Receives the tape. If storage is too small, tape->size is set to the size
+ *               needed, and the call should be repeated with that much storage.
+ *  \param offset If not NULL, receives the number of characters successfully processed. On
+ *                error, this is the offset within buffer of the character that caused the error.
+ *  \return 0 on successful parse, one of SAXML_ERROR_* if not; SAXML_ERROR_BUFFER_OVERFLOW
+ *          with tape->size greater than storageSize if storage is too small
+ */
+int saxml_BuildTape(tSaxmlParser parser, const char *buffer, const size_t length,
+    void *storage, const size_t storageSize, tSaxmlTape *tape, size_t *offset);
+
+/*! \brief Deliver the events recorded in part of a tape to the parser's handlers: its span
+ *         handlers, or else the string handlers of its tSaxmlContext. Calls to
+ *         saxml_SkipCurrentElement continue from the end tag of the innermost element,
+ *         without looking at anything within it. Other handlers, the element stack and
+ *         subscriptions aren't used.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param tape Tape built by saxml_BuildTape
+ *  \param first Index of the first entry to replay, e.g. a tag, to replay its subtree
+ *  \param count Number of entries to replay, e.g. (entries[first].match - first + 1)
+ *  \return 0 on success, or SAXML_ERROR_BUFFER_OVERFLOW if a string doesn't fit the parser's
+ *          buffer, and truncation isn't allowed
+ */
+int saxml_ReplayTape(tSaxmlParser parser, const tSaxmlTape *tape, const uint32_t first,
+    const uint32_t count);
+
+/*! \brief Data of a tape entry
+ *  \param tape Tape built by saxml_BuildTape
+ *  \param entry Entry within the tape
+ *  \return Start of the entry's data, of entry->length characters (not NUL-terminated)
+ */
+const char *saxml_TapeData(const tSaxmlTape *tape, const tSaxmlTapeEntry *entry);
+
+/*! \brief Create a pull parser, from which the caller requests each token in turn with
+ *         saxml_NextToken, rather than receiving events through handlers. Tokens correspond
+ *         to the events that span handlers would receive (see saxml_SetSpanHandlers). The
+ *         element stack, subscriptions, reference decoding and truncation settings all apply;
+ *         handlers must not be registered.
+ *  \param maxStringSize Maximum number of characters for a string which isn't contiguous
+ *                       within a single buffer provided to saxml_Feed
+ *  \return parser instance, or NULL on failure. When saxml is built with SAXML_NO_MALLOC,
+ *          this always fails; use saxml_InitializePullInPlace instead.
+ */
+tSaxmlParser saxml_InitializePull(const uint32_t maxStringSize);
+
+/*! \brief Create a pull parser within caller-provided storage (see saxml_InitializeInPlace)
+ *  \param storage Memory in which to place the parser, as for saxml_InitializeInPlace
+ *  \param storageSize Size of storage, in bytes; at least saxml_StorageSize(maxStringSize)
+ *  \param maxStringSize As for saxml_InitializePull
+ *  \return parser instance, or NULL if the arguments are invalid
+ */
+tSaxmlParser saxml_InitializePullInPlace(void *storage, const size_t storageSize,
+    const uint32_t maxStringSize);
+
+/*! \brief Provide the next buffer of characters to a pull parser. Parsing state is retained
+ *         across buffers, as for saxml_HandleBuffer.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_InitializePull
+ *  \param buffer Characters to process. This must remain valid until saxml_NextToken returns
+ *                SAXML_TOKEN_NONE or an error.
+ *  \param length Number of characters in buffer
+ */
+void saxml_Feed(tSaxmlParser parser, const char *buffer, const size_t length);
+
+/*! \brief Parse up to the next token in the buffer provided to saxml_Feed. For an empty tag
+ *         with attributes, the SAXML_TOKEN_TAG_END token's name is a single space unless
+ *         there's an element stack (see saxml_SetElementStack). saxml_SkipCurrentElement may
+ *         be called between tokens, with the same effect as from within a handler.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_InitializePull
+ *  \param token Receives the token. Its string points either into the buffer provided to
+ *               saxml_Feed or into the parser's string buffer, and is only valid until the
+ *               next call to saxml_NextToken.
+ *  \return Type of the token (one of SAXML_TOKEN_*); SAXML_TOKEN_NONE once the buffer has
+ *          been consumed, and saxml_Feed must be called with more input; or one of
+ *          SAXML_ERROR_* (see saxml_GetFeedOffset)
+ */
+int saxml_NextToken(tSaxmlParser parser, tSaxmlToken *token);
+
+/*! \brief Determine how much of the buffer provided to saxml_Feed has been consumed
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_InitializePull
+ *  \return Offset within the buffer of the next character to be parsed or, after an error,
+ *          of the character that caused the error
+ */
+size_t saxml_GetFeedOffset(tSaxmlParser parser);
+
 /*! \brief Reset the parser to its initial state
  *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
  */
 void saxml_Reset(tSaxmlParser parser);
 
+/*! \brief Save the parser's state between calls, so that parsing of a stream can later be
+ *         resumed from the same point by saxml_RestoreState, even in another process. The
+ *         state includes any partial token, reference and markup, and the element stack,
+ *         but none of the parser's configuration (handlers, subscriptions and settings).
+ *         Together with the offset of the next character in the stream, it's a checkpoint.
+ *         A pull parser's state may be saved between tokens; the checkpoint offset is then
+ *         that of the fed buffer plus saxml_GetFeedOffset.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param state Receives the state; may be NULL to determine its size
+ *  \param stateSize Size of state, in bytes
+ *  \return Size of the saved state, in bytes; a few dozen more than the partial token and the
+ *          element stack. If this is greater than stateSize, nothing is written.
+ */
+size_t saxml_SaveState(tSaxmlParser parser, void *state, const size_t stateSize);
+
+/*! \brief Restore a state saved by saxml_SaveState, to resume parsing from the point at
+ *         which it was saved. The parser must be configured as the one whose state was saved
+ *         was (with the same handlers, subscriptions, element stack and settings), with a
+ *         maxStringSize and element stack at least large enough for the saved state.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param state State saved by saxml_SaveState
+ *  \param stateSize Size of the saved state, in bytes, as returned by saxml_SaveState
+ *  \return 0 on success, or SAXML_ERROR_STATE if the state isn't one saved by this version
+ *          of saxml (including one which isn't consistent, such as an element stack which
+ *          doesn't match the depth), or doesn't fit the parser, or SAXML_ERROR_POOL if the
+ *          parser is pooled and there's no buffer free for the partial token; the parser is
+ *          unchanged in either case
+ */
+int saxml_RestoreState(tSaxmlParser parser, const void *state, const size_t stateSize);
+
+/*! \brief Register span handlers, which are called in place of the corresponding
+ *         pfnStringHandler functions of the tSaxmlContext provided to saxml_Initialize.
+ *         Strings which are contiguous within a buffer provided to saxml_HandleBuffer are not
+ *         copied, and are not limited to maxStringSize. Strings which cross buffer boundaries
+ *         (or which are provided via saxml_HandleCharacter) are copied into the parser's string
+ *         buffer and are subject to maxStringSize.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param handlers Span handlers; NULL members fall back to the tSaxmlContext handler for the
+ *                  same event. Must remain valid until replaced, or parser is destroyed. NULL to
+ *                  disable span handlers.
+ */
+void saxml_SetSpanHandlers(tSaxmlParser parser, const tSaxmlSpanContext *handlers);
+
+/*! \brief Register a handler which is called once for each start tag that has attributes, with
+ *         the tag's whole attribute region, instead of calling the attributeHandler of the
+ *         tSaxmlContext once for each attribute. The attribute region is a single string, and
+ *         so is subject to maxStringSize unless it's delivered in place (see
+ *         saxml_SetSpanHandlers). Individual attributes are only parsed when accessed.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param handler Attribute region handler, or NULL to restore per-attribute events
+ */
+void saxml_SetAttributesHandler(tSaxmlParser parser, pfnAttributesHandler handler);
+
+/*! \brief Register fragment handlers, which are called in place of the corresponding ID, span
+ *         and pfnStringHandler handlers. Contents and attributes of any length are then
+ *         delivered without being truncated or failing with SAXML_ERROR_BUFFER_OVERFLOW: each
+ *         time the parser's string buffer fills, its contents are delivered as a fragment, and
+ *         the rest of the string follows in later calls. Strings which fit (or which are
+ *         contiguous within a buffer provided to saxml_HandleBuffer) are delivered as a single
+ *         fragment. Fragments are split at arbitrary characters, so a multi-byte character may
+ *         span two fragments.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param handlers Fragment handlers; NULL members leave the event to the other handlers. Must
+ *                  remain valid until replaced, or parser is destroyed. NULL to disable
+ *                  fragment handlers.
+ */
+void saxml_SetFragmentHandlers(tSaxmlParser parser, const tSaxmlFragmentContext *handlers);
+
+/*! \brief Frame a stream of concatenated documents (e.g. one per message). The depth of the
+ *         root element is tracked, and the start and end of each document reported. Once a
+ *         document ends, nothing but the start of the next tag is looked for, as at the start
+ *         of parsing; text between documents isn't reported as contents. Document handlers
+ *         can't be used with a pull parser.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param handlers Document handlers; either member may be NULL. Must remain valid until
+ *                  replaced, or parser is destroyed. NULL to stop framing.
+ */
+void saxml_SetDocumentHandlers(tSaxmlParser parser, const tSaxmlDocumentContext *handlers);
+
+/*! \brief Iterate over the attributes in a start tag's attribute region
+ *  \param attributes Attribute region provided to a pfnAttributesHandler
+ *  \param iterator Iteration state; set to zero before the first call
+ *  \param attribute Receives the next attribute
+ *  \return 1 if an attribute was found, 0 if there are no more attributes
+ */
+int saxml_NextAttribute(const tSaxmlAttributes *attributes, size_t *iterator,
+    tSaxmlAttribute *attribute);
+
+/*! \brief Find an attribute by name within a start tag's attribute region
+ *  \param attributes Attribute region provided to a pfnAttributesHandler
+ *  \param name NUL-terminated attribute name
+ *  \param attribute Receives the first attribute with the given name
+ *  \return 1 if the attribute was found, 0 if not
+ */
+int saxml_FindAttribute(const tSaxmlAttributes *attributes, const char *name,
+    tSaxmlAttribute *attribute);
+
+/*! \brief Decode the predefined entity references (&amp; &lt; &gt; &quot; &apos;) and
+ *         numeric character references (&#N; &#xN;) in tag contents and attributes, as they're
+ *         parsed. Referenced characters are encoded as UTF-8. Anything which isn't a reference
+ *         that can be decoded, such as an entity declared in a DTD, is passed through unchanged.
+ *         A string containing a decoded reference is copied into the parser's string buffer, so
+ *         is subject to maxStringSize even when span handlers are registered. Attribute regions
+ *         (see saxml_SetAttributesHandler) aren't decoded; use saxml_DecodeReferences on the
+ *         attribute values instead.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param enable Nonzero to decode references, zero to pass them through (the default)
+ */
+void saxml_EnableReferenceDecoding(tSaxmlParser parser, const int enable);
+
+/*! \brief Decode the entity and character references in a string, in the same way as
+ *         saxml_EnableReferenceDecoding does for parsed strings
+ *  \param destination Receives the decoded string, which is never longer than the source. The
+ *                     destination may be the same as source, to decode in place.
+ *  \param source String to decode (e.g. an attribute value from saxml_NextAttribute)
+ *  \param length Number of characters in source
+ *  \return Number of characters written to destination. The result isn't NUL-terminated.
+ */
+size_t saxml_DecodeReferences(char *destination, const char *source, const size_t length);
+
+/*! \brief Create a vocabulary of element and attribute names, for which the parser reports
+ *         integer IDs (see saxml_SetIdHandlers). The names are stored in a perfect hash, so
+ *         looking up a name costs one hash and one comparison regardless of vocabulary size.
+ *  \param names NUL-terminated names; the ID of each is its index. The array and the names must
+ *               remain valid for as long as the vocabulary is in use. Names must be unique.
+ *  \param count Number of names
+ *  \return vocabulary instance, or NULL on failure. When saxml is built with SAXML_NO_MALLOC,
+ *          this always fails; use saxml_CreateVocabularyInPlace instead.
+ */
+tSaxmlVocabulary saxml_CreateVocabulary(const char * const *names, const uint32_t count);
+
+/*! \brief Determine the amount of storage required by saxml_CreateVocabularyInPlace
+ *  \param count Number of names in the vocabulary
+ *  \return Number of bytes of storage required
+ */
+size_t saxml_VocabularyStorageSize(const uint32_t count);
+
+/*! \brief Create a vocabulary within caller-provided storage, without any dynamic memory
+ *         allocation
+ *  \param storage Memory in which to place the vocabulary, of any alignment. This must remain
+ *                 valid, and must not otherwise be modified, for as long as the vocabulary is
+ *                 in use.
+ *  \param storageSize Size of storage, in bytes. Must be at least the value returned by
+ *                     saxml_VocabularyStorageSize for the same count.
+ *  \param names Names (see saxml_CreateVocabulary)
+ *  \param count Number of names
+ *  \return vocabulary instance, or NULL if the arguments are invalid or the names aren't unique
+ */
+tSaxmlVocabulary saxml_CreateVocabularyInPlace(void *storage, const size_t storageSize,
+    const char * const *names, const uint32_t count);
+
+/*! \brief Destroy a vocabulary
+ *  \param vocabulary tSaxmlVocabulary instance, obtained from a call to saxml_CreateVocabulary
+ *                    or saxml_CreateVocabularyInPlace
+ */
+void saxml_DestroyVocabulary(tSaxmlVocabulary vocabulary);
+
+/*! \brief Look up a name in a vocabulary (e.g. the name of an attribute from
+ *         saxml_NextAttribute)
+ *  \param vocabulary tSaxmlVocabulary instance
+ *  \param name Name to look up, which doesn't need to be NUL-terminated
+ *  \param length Number of characters in name
+ *  \return ID of the name, or SAXML_UNKNOWN_ID if it isn't in the vocabulary
+ */
+int32_t saxml_VocabularyLookup(const tSaxmlVocabulary vocabulary, const char *name,
+    const size_t length);
+
+/*! \brief Register ID handlers, which are called in place of the corresponding span and
+ *         pfnStringHandler handlers, with the ID of the tag or attribute name in the given
+ *         vocabulary. Handlers can then dispatch on an integer rather than comparing strings.
+ *         The string is provided as it would be to a pfnSpanHandler.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param vocabulary Names to be reported by ID. Must remain valid until replaced, or parser is
+ *                    destroyed. NULL reports every name as SAXML_UNKNOWN_ID.
+ *  \param handlers ID handlers; NULL members fall back to the span or tSaxmlContext handler for
+ *                  the same event. Must remain valid until replaced, or parser is destroyed.
+ *                  NULL to disable ID handlers.
+ */
+void saxml_SetIdHandlers(tSaxmlParser parser, const tSaxmlVocabulary vocabulary,
+    const tSaxmlIdContext *handlers);
+
+/*! \brief Provide storage for an element stack, in which the parser keeps the names of the open
+ *         elements. This is required for saxml_Subscribe. With an element stack, the
+ *         tagEndHandler for an empty tag with attributes (e.g. '<tag name="value"/>') receives
+ *         the tag name, rather than a single space character.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param storage Memory for the stack; must remain valid until replaced, or parser is
+ *                 destroyed. NULL to disable the element stack.
+ *  \param storageSize Size of storage, in bytes. Each open element takes the length of its name
+ *                     plus one; parsing fails with SAXML_ERROR_STACK_OVERFLOW if the open
+ *                     elements don't fit.
+ */
+void saxml_SetElementStack(tSaxmlParser parser, void *storage, const size_t storageSize);
+
+/*! \brief Determine the number of open elements (see saxml_SetElementStack)
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \return Number of open elements, or 0 if there's no element stack. Within a tagHandler,
+ *          this includes the element being started; within a tagEndHandler, the element being
+ *          ended.
+ */
+uint32_t saxml_GetDepth(tSaxmlParser parser);
+
+/*! \brief Subscribe to the events within elements with a matching path. Once subscribed, only
+ *         events for a matching element (its tag, attributes, content and end tag) and for
+ *         everything it contains are delivered. Everything else is dropped without being
+ *         copied into the parser's string buffer. Multiple patterns may be registered; an
+ *         element matches if any of them match.
+ *  \param parser tSaxmlParser instance, which must have an element stack
+ *                (see saxml_SetElementStack)
+ *  \param pattern Path pattern, made up of '/'-separated element names from the document
+ *                 root, e.g. "/feed/item/price". '*' matches any single element, and '//'
+ *                 any number of elements, so "//item/price" matches a price element within an
+ *                 item element at any depth. The pattern must remain valid until the parser is
+ *                 destroyed, or subscriptions are cleared. NULL clears all subscriptions.
+ *  \return 0 on success, SAXML_ERROR_SYNTAX if the pattern is invalid, or
+ *          SAXML_ERROR_BUFFER_OVERFLOW if there's no element stack or too many patterns (more
+ *          than 8) are registered
+ */
+int saxml_Subscribe(tSaxmlParser parser, const char *pattern);
+
+/*! \brief Skip the rest of the innermost open element. This may only be called from within a
+ *         handler, and is typically called from a tagHandler. Everything up to the element's
+ *         end tag (its remaining attributes, its content, and any elements it contains) is then
+ *         passed over without being buffered or delivered to any handler. The end tag itself
+ *         is still delivered to the tagEndHandler, so that applications which track the
+ *         element hierarchy stay in step. If the element is already ending (an empty tag, or
+ *         when called from a tagEndHandler), this has no effect.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ */
+void saxml_SkipCurrentElement(tSaxmlParser parser);
+
+/*! \brief Read the statistics collected by a parser since it was created (saxml_Reset doesn't
+ *         clear them). Statistics are only collected when saxml is built with SAXML_STATS,
+ *         and otherwise cost nothing. With SAXML_STATS_TIMING too, the time spent within
+ *         handlers and within the parser itself is measured, in nanoseconds, or in the units
+ *         of SAXML_STATS_CLOCK() if saxml is built with that defined (e.g. as a cycle counter).
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param stats Receives the statistics
+ *  \return Nonzero if statistics are collected; zero if not, in which case *stats is zeroed
+ */
+int saxml_GetStats(tSaxmlParser parser, tSaxmlStats *stats);
+
 /*! \brief Allow parsing to continue on parsed string buffer overflow
  *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
  *  \param allow Nonzero to continue parsing in the event that the parser string buffer
@@ -64,6 +797,53 @@ void saxml_Reset(tSaxmlParser parser);
  */
 void saxml_AllowTruncatedStrings(tSaxmlParser parser, const int allow);
 
+/*! \brief Check that input is well-formed UTF-8 as it's parsed; overlong encodings, surrogates
+ *         and code points beyond U+10FFFF are rejected with SAXML_ERROR_ENCODING, after the
+ *         events for everything before the invalid character have been delivered. Runs of ASCII
+ *         are checked with vector instructions where available. A sequence may be split across
+ *         buffers, so one which is incomplete at the end of a stream is only detected by
+ *         saxml_BuildTape, which is given the whole document.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param enable Nonzero to validate, zero to accept any input (the default)
+ */
+void saxml_EnableUtf8Validation(tSaxmlParser parser, const int enable);
+
+#define SAXML_EVENT_TAG       0x01
+#define SAXML_EVENT_TAG_END   0x02
+#define SAXML_EVENT_CONTENT   0x04
+#define SAXML_EVENT_ATTRIBUTE 0x08
+#define SAXML_EVENT_ALL       0x0F
+
+/*! \brief Choose which events are delivered. Events without a registered handler (string,
+ *         span, fragment or ID) are never delivered either, so by default only the handlers
+ *         decide. Strings which won't be delivered aren't buffered at all, so can't overflow the
+ *         parser's buffer, and are passed over by the delimiter scans alone; a caller which only
+ *         needs the tag structure parses at close to scanning speed. Tag names are always
+ *         buffered with an element stack, which needs them. Attribute regions (see
+ *         saxml_SetAttributesHandler) aren't affected. Handlers in the tSaxmlContext are checked
+ *         at each call to the parser, so may be changed between calls.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param mask Any of SAXML_EVENT_* (the default is SAXML_EVENT_ALL)
+ */
+void saxml_SetEventMask(tSaxmlParser parser, const uint32_t mask);
+
+#define SAXML_WHITESPACE_PRESERVE 0 /* contents as they appear, after leading whitespace */
+#define SAXML_WHITESPACE_TRIM     1 /* trailing whitespace is removed too */
+#define SAXML_WHITESPACE_COLLAPSE 2 /* as for trim, and each run of whitespace within contents
+                                       is replaced by a single space */
+
+/*! \brief Choose how whitespace in contents is handled. Leading whitespace is always skipped;
+ *         with SAXML_WHITESPACE_TRIM or SAXML_WHITESPACE_COLLAPSE, contents which are nothing
+ *         but whitespace (e.g. from a decoded reference) aren't delivered at all. CDATA sections
+ *         and contents delivered through fragment handlers are passed through unchanged.
+ *         Collapsed contents which were tracked in the caller's buffer are copied into the
+ *         parser's buffer if they contain whitespace other than single spaces, so are then
+ *         subject to maxStringSize.
+ *  \param parser tSaxmlParser instance, obtained from a call to saxml_Initialize
+ *  \param policy One of SAXML_WHITESPACE_* (the default is SAXML_WHITESPACE_PRESERVE)
+ */
+void saxml_SetWhitespacePolicy(tSaxmlParser parser, const int policy);
+
 #ifdef __cplusplus
 };
 #endif
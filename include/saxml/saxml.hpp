@@ -0,0 +1,190 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief C++ interface, with events delivered to a handler object's member functions (C++17)
+ */
+#ifndef SAXML_HPP
+#define SAXML_HPP
+
+#include "saxml/saxml.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace saxml {
+
+namespace detail {
+
+/* Whether a handler has a member function for each event; a missing one is detected here, at
+ *  compile time, so that no handler at all is registered for that event */
+template <typename H, typename = void> struct HasTag : std::false_type {};
+template <typename H>
+struct HasTag<H, std::void_t<decltype(std::declval<H &>().onTag(std::string_view()))>>
+    : std::true_type {};
+
+template <typename H, typename = void> struct HasTagEnd : std::false_type {};
+template <typename H>
+struct HasTagEnd<H, std::void_t<decltype(std::declval<H &>().onTagEnd(std::string_view()))>>
+    : std::true_type {};
+
+template <typename H, typename = void> struct HasContent : std::false_type {};
+template <typename H>
+struct HasContent<H, std::void_t<decltype(std::declval<H &>().onContent(std::string_view()))>>
+    : std::true_type {};
+
+template <typename H, typename = void> struct HasAttribute : std::false_type {};
+template <typename H>
+struct HasAttribute<H,
+    std::void_t<decltype(std::declval<H &>().onAttribute(std::string_view()))>>
+    : std::true_type {};
+
+/* Span handlers which call the handler's member functions directly, so that they can be
+ *  inlined into the one call the parser makes for each event. A discarded branch isn't
+ *  instantiated, so a handler only needs the member functions it uses. */
+template <typename H>
+constexpr pfnSpanHandler TagHandler()
+{
+    if constexpr(HasTag<H>::value)
+        return [](void *cookie, const char *data, std::size_t length)
+            { static_cast<H *>(cookie)->onTag(std::string_view(data, length)); };
+    else
+        return nullptr;
+}
+
+template <typename H>
+constexpr pfnSpanHandler TagEndHandler()
+{
+    if constexpr(HasTagEnd<H>::value)
+        return [](void *cookie, const char *data, std::size_t length)
+            { static_cast<H *>(cookie)->onTagEnd(std::string_view(data, length)); };
+    else
+        return nullptr;
+}
+
+template <typename H>
+constexpr pfnSpanHandler ContentHandler()
+{
+    if constexpr(HasContent<H>::value)
+        return [](void *cookie, const char *data, std::size_t length)
+            { static_cast<H *>(cookie)->onContent(std::string_view(data, length)); };
+    else
+        return nullptr;
+}
+
+template <typename H>
+constexpr pfnSpanHandler AttributeHandler()
+{
+    if constexpr(HasAttribute<H>::value)
+        return [](void *cookie, const char *data, std::size_t length)
+            { static_cast<H *>(cookie)->onAttribute(std::string_view(data, length)); };
+    else
+        return nullptr;
+}
+
+template <typename H>
+struct Dispatch
+{
+    static constexpr tSaxmlSpanContext spans =
+        { TagHandler<H>(), TagEndHandler<H>(), ContentHandler<H>(), AttributeHandler<H>() };
+};
+
+} /* namespace detail */
+
+/*! \brief An XML parser which delivers events to a Handler object. The handler has any of the
+ *         member functions below, each taking a std::string_view; events without one are
+ *         parsed, but their strings aren't buffered or delivered:
+ *           onTag(name), onTagEnd(name), onContent(text), onAttribute(attribute)
+ *         Strings point directly into the caller's buffer where possible (see
+ *         saxml_SetSpanHandlers), so are only valid during the call. An empty tag's end tag
+ *         name is " " unless an element stack is provided (see setElementStack).
+ */
+template <typename Handler>
+class Parser
+{
+public:
+    /*! \brief Create a parser, allocating its storage
+     *  \param handler Receives the events; must outlive the parser
+     *  \param maxStringSize As for saxml_Initialize
+     */
+    explicit Parser(Handler &handler, const std::uint32_t maxStringSize = 256)
+    {
+        Configure(handler);
+        m_parser = saxml_Initialize(&m_context, maxStringSize);
+        Register();
+    }
+
+    /*! \brief Create a parser in caller-provided storage, as for saxml_InitializeInPlace */
+    Parser(Handler &handler, void *storage, const std::size_t storageSize,
+        const std::uint32_t maxStringSize)
+    {
+        Configure(handler);
+        m_parser = saxml_InitializeInPlace(storage, storageSize, &m_context, maxStringSize);
+        Register();
+    }
+
+    ~Parser() { if(nullptr != m_parser) saxml_Deinitialize(m_parser); }
+
+    /* The parser refers to the context within this object, so it can't be copied or moved */
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+
+    /*! \brief True if the parser was created successfully */
+    bool valid() const { return nullptr != m_parser; }
+
+    /*! \brief Parse a buffer, as for saxml_HandleBuffer; state is retained between calls */
+    int parse(std::string_view buffer, std::size_t *offset = nullptr)
+        { return saxml_HandleBuffer(m_parser, buffer.data(), buffer.size(), offset); }
+
+    /*! \brief Parse UTF-16 input, as for saxml_HandleBufferUtf16 */
+    int parseUtf16(std::string_view buffer, const int byteOrder, std::size_t *offset = nullptr)
+    {
+        return saxml_HandleBufferUtf16(m_parser, buffer.data(), buffer.size(), byteOrder,
+            offset);
+    }
+
+    /*! \brief Parse a whole file, as for saxml_ParseFile */
+    int parseFile(const char *path, std::size_t *offset = nullptr)
+        { return saxml_ParseFile(m_parser, path, offset); }
+
+    void reset() { saxml_Reset(m_parser); }
+    void skipCurrentElement() { saxml_SkipCurrentElement(m_parser); }
+    void setElementStack(void *storage, const std::size_t storageSize)
+        { saxml_SetElementStack(m_parser, storage, storageSize); }
+    int subscribe(const char *pattern) { return saxml_Subscribe(m_parser, pattern); }
+    void allowTruncatedStrings(const bool allow)
+        { saxml_AllowTruncatedStrings(m_parser, allow ? 1 : 0); }
+    void enableReferenceDecoding(const bool enable)
+        { saxml_EnableReferenceDecoding(m_parser, enable ? 1 : 0); }
+    void enableUtf8Validation(const bool enable)
+        { saxml_EnableUtf8Validation(m_parser, enable ? 1 : 0); }
+    void setEventMask(const std::uint32_t mask) { saxml_SetEventMask(m_parser, mask); }
+    void setWhitespacePolicy(const int policy) { saxml_SetWhitespacePolicy(m_parser, policy); }
+
+    /*! \brief The underlying parser, for the rest of the C interface */
+    tSaxmlParser native() const { return m_parser; }
+
+private:
+    void Configure(Handler &handler)
+    {
+        m_context.cookie = &handler;
+        m_context.tagHandler = nullptr;
+        m_context.tagEndHandler = nullptr;
+        m_context.parameterHandler = nullptr;
+        m_context.contentHandler = nullptr;
+        m_context.attributeHandler = nullptr;
+    }
+
+    void Register()
+    {
+        if(nullptr != m_parser)
+            saxml_SetSpanHandlers(m_parser, &detail::Dispatch<Handler>::spans);
+    }
+
+    tSaxmlContext m_context;
+    tSaxmlParser m_parser = nullptr;
+};
+
+} /* namespace saxml */
+
+#endif /* SAXML_HPP */
@@ -0,0 +1,78 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Accessors for the attribute region of a start tag
+ */
+#include "saxml/saxml.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* strlen, memcmp */
+
+#define IS_SPACE(c) (' ' == (c) || '\t' == (c) || '\r' == (c) || '\n' == (c))
+
+int saxml_NextAttribute(const tSaxmlAttributes *attributes, size_t *iterator,
+    tSaxmlAttribute *attribute)
+{
+    const char *data = attributes->data;
+    size_t length = attributes->length;
+    size_t position = *iterator;
+    char quote;
+
+    /* Skip separators; the name runs up to whitespace or '=' */
+    while(position < length && (IS_SPACE(data[position]) || '=' == data[position]))
+        ++position;
+    if(position >= length)
+    {
+        *iterator = length;
+        return 0;
+    }
+    attribute->name = &data[position];
+    while(position < length && !IS_SPACE(data[position]) && '=' != data[position])
+        ++position;
+    attribute->nameLength = (size_t) (&data[position] - attribute->name);
+
+    attribute->value = NULL;
+    attribute->valueLength = 0;
+    while(position < length && IS_SPACE(data[position]))
+        ++position;
+    if(position < length && '=' == data[position])
+    {
+        ++position;
+        while(position < length && IS_SPACE(data[position]))
+            ++position;
+        if(position < length && ('"' == data[position] || '\'' == data[position]))
+        {
+            /* Quoted value; an unterminated value extends to the end of the region */
+            quote = data[position++];
+            attribute->value = &data[position];
+            while(position < length && quote != data[position])
+                ++position;
+            attribute->valueLength = (size_t) (&data[position] - attribute->value);
+            if(position < length)
+                ++position;
+        }
+        else
+        {
+            attribute->value = &data[position];
+            while(position < length && !IS_SPACE(data[position]))
+                ++position;
+            attribute->valueLength = (size_t) (&data[position] - attribute->value);
+        }
+    }
+
+    *iterator = position;
+    return 1;
+}
+
+int saxml_FindAttribute(const tSaxmlAttributes *attributes, const char *name,
+    tSaxmlAttribute *attribute)
+{
+    size_t iterator = 0;
+    size_t nameLength = strlen(name);
+
+    while(saxml_NextAttribute(attributes, &iterator, attribute))
+    {
+        if(attribute->nameLength == nameLength && memcmp(attribute->name, name, nameLength) == 0)
+            return 1;
+    }
+
+    return 0;
+}
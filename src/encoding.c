@@ -0,0 +1,163 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief UTF-8 validation and UTF-16 transcoding of input
+ */
+#include "saxml/saxml.h"
+#include "encoding.h"
+
+/* ---------------------------------------------------------------------------------------------
+ * UTF-8
+ */
+
+void encoding_Utf8Reset(tUtf8State *state)
+{
+    state->needed = 0;
+    state->lower = 0x80;
+    state->upper = 0xBF;
+}
+
+const char *encoding_ValidateUtf8(tUtf8State *state, pfnAsciiHandler pfnAscii,
+    const char *position, const char *end)
+{
+    uint8_t needed = state->needed, lower = state->lower, upper = state->upper;
+    uint8_t c;
+
+    for(; position < end; ++position)
+    {
+        c = (uint8_t) *position;
+        if(needed > 0)
+        {
+            if(c < lower || c > upper)
+                break;
+            --needed;
+            lower = 0x80;
+            upper = 0xBF;
+            continue;
+        }
+
+        if(c < 0x80)
+        {
+            /* Most documents are mostly ASCII */
+            position = pfnAscii(position, end) - 1;
+            continue;
+        }
+        if(c >= 0xC2 && c <= 0xDF)
+            needed = 1;
+        else if(c >= 0xE0 && c <= 0xEF)
+        {
+            needed = 2;
+            if(0xE0 == c)
+                lower = 0xA0; /* overlong */
+            else if(0xED == c)
+                upper = 0x9F; /* surrogates */
+        }
+        else if(c >= 0xF0 && c <= 0xF4)
+        {
+            needed = 3;
+            if(0xF0 == c)
+                lower = 0x90; /* overlong */
+            else if(0xF4 == c)
+                upper = 0x8F; /* beyond U+10FFFF */
+        }
+        else
+            break;
+    }
+
+    state->needed = needed;
+    state->lower = lower;
+    state->upper = upper;
+    return position;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * UTF-16
+ */
+
+void encoding_Utf16Reset(tUtf16State *state)
+{
+    state->bPending = 0;
+    state->pending = 0;
+    state->surrogate = 0;
+}
+
+/* Encode a code point as UTF-8. Returns the number of characters written. */
+static int EncodeUtf8(const uint32_t codePoint, char *output)
+{
+    if(codePoint < 0x80)
+    {
+        output[0] = (char) codePoint;
+        return 1;
+    }
+    if(codePoint < 0x800)
+    {
+        output[0] = (char) (0xC0 | (codePoint >> 6));
+        output[1] = (char) (0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if(codePoint < 0x10000)
+    {
+        output[0] = (char) (0xE0 | (codePoint >> 12));
+        output[1] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        output[2] = (char) (0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    output[0] = (char) (0xF0 | (codePoint >> 18));
+    output[1] = (char) (0x80 | ((codePoint >> 12) & 0x3F));
+    output[2] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+    output[3] = (char) (0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+int encoding_Utf16ToUtf8(tUtf16State *state, const int bBigEndian, const char **input,
+    const char *inputEnd, char **output, const char *outputEnd)
+{
+    const char *position = *input;
+    char *out = *output;
+    uint8_t first, second;
+    uint16_t unit;
+    int result = 0;
+
+    while(position < inputEnd && outputEnd - out >= ENCODING_MAX_UTF8)
+    {
+        /* A code unit may be split across buffers */
+        if(!state->bPending)
+        {
+            state->pending = (uint8_t) *position++;
+            state->bPending = 1;
+            if(position >= inputEnd)
+                break;
+        }
+        first = state->pending;
+        second = (uint8_t) *position;
+        unit = bBigEndian ? (uint16_t) ((first << 8) | second) : (uint16_t) ((second << 8) | first);
+
+        if(0 != state->surrogate)
+        {
+            if(unit < 0xDC00 || unit > 0xDFFF)
+            {
+                --position; /* at the start of the unit which should have been the low surrogate */
+                result = SAXML_ERROR_ENCODING;
+                break;
+            }
+            out += EncodeUtf8(0x10000 + (((uint32_t) state->surrogate - 0xD800) << 10)
+                + (unit - 0xDC00), out);
+            state->surrogate = 0;
+        }
+        else if(unit >= 0xD800 && unit <= 0xDBFF)
+            state->surrogate = unit;
+        else if(unit >= 0xDC00 && unit <= 0xDFFF)
+        {
+            --position;
+            result = SAXML_ERROR_ENCODING;
+            break;
+        }
+        else
+            out += EncodeUtf8(unit, out);
+        state->bPending = 0;
+        ++position;
+    }
+
+    *input = position;
+    *output = out;
+    return result;
+}
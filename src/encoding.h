@@ -0,0 +1,48 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief UTF-8 validation and UTF-16 transcoding of input, either of which may be split across
+ *         buffers
+ */
+#ifndef SAXML_ENCODING_H
+#define SAXML_ENCODING_H
+
+#include "scan.h"
+#include <stdint.h>
+
+/* Longest UTF-8 encoding of a character */
+#define ENCODING_MAX_UTF8 4
+
+/* A UTF-8 sequence being validated */
+typedef struct
+{
+    uint8_t needed; /* continuation bytes still to come */
+    uint8_t lower;  /* range of the next continuation byte, which is narrower after some lead
+                       bytes, to exclude overlong encodings, surrogates and code points beyond
+                       U+10FFFF */
+    uint8_t upper;
+} tUtf8State;
+
+/* A UTF-16 character being transcoded */
+typedef struct
+{
+    uint8_t bPending;   /* true if the first byte of a code unit has been seen */
+    uint8_t pending;
+    uint16_t surrogate; /* a high surrogate waiting for its low surrogate, or zero */
+} tUtf16State;
+
+void encoding_Utf8Reset(tUtf8State *state);
+
+/* Validate [position, end), continuing the sequence in state; ASCII runs are passed over with
+ *  pfnAscii. Returns the first character which can't be part of valid UTF-8, or end. */
+const char *encoding_ValidateUtf8(tUtf8State *state, pfnAsciiHandler pfnAscii,
+    const char *position, const char *end);
+
+void encoding_Utf16Reset(tUtf16State *state);
+
+/* Transcode UTF-16 from *input to UTF-8 at *output, for as long as there's input and room for
+ *  a whole character of output. Both are advanced past what's been transcoded. Returns 0, or
+ *  SAXML_ERROR_ENCODING if *input is an unpaired surrogate. */
+int encoding_Utf16ToUtf8(tUtf16State *state, const int bBigEndian, const char **input,
+    const char *inputEnd, char **output, const char *outputEnd);
+
+#endif /* SAXML_ENCODING_H */
@@ -0,0 +1,66 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parsing of a file, mapped into memory where possible
+ */
+#define _POSIX_C_SOURCE 200112L /* posix_madvise */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include <stddef.h> /* for NULL */
+#include <stdint.h> /* SIZE_MAX */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+   #define SAXML_FILE_MMAP
+   #include <sys/mman.h>
+#endif
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+int saxml_ParseFile(tSaxmlParser parser, const char *path, size_t *offset)
+{
+    size_t position = 0;
+    int fd, result;
+    #if defined(SAXML_FILE_MMAP)
+    struct stat status;
+    void *data;
+    size_t length;
+    #endif
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        if(NULL != offset)
+            *offset = 0;
+        return SAXML_ERROR_FILE;
+    }
+
+    #if defined(SAXML_FILE_MMAP)
+    /* Regular files are mapped and parsed as a single buffer; anything else (pipes, devices,
+       or a file which can't be mapped) is read in chunks, see saxml_ParseDescriptor */
+    if(0 == fstat(fd, &status) && S_ISREG(status.st_mode) && status.st_size > 0
+       && (uintmax_t) status.st_size <= (uintmax_t) SIZE_MAX)
+    {
+        length = (size_t) status.st_size;
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(MAP_FAILED != data)
+        {
+            posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+            result = saxml_HandleBuffer(parser, (const char *) data, length, &position);
+            munmap(data, length);
+            close(fd);
+            if(NULL != offset)
+                *offset = position;
+            return result;
+        }
+    }
+    #endif
+
+    result = saxml_ParseDescriptor(parser, fd, SAXML_INGEST_AUTO, &position);
+    close(fd);
+    if(NULL != offset)
+        *offset = position;
+    return result;
+}
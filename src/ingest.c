@@ -0,0 +1,502 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parsing of everything which can be read from a file descriptor, with reads overlapped
+ *         with parsing where possible: on a reader thread, or with io_uring
+ */
+#define _DEFAULT_SOURCE /* syscall */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include <stddef.h> /* for NULL */
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#ifndef SAXML_NO_MALLOC
+   #include <stdlib.h> /* malloc, free */
+#endif
+#if !defined(SAXML_NO_MALLOC) && !defined(SAXML_NO_THREADS) && defined(__GNUC__)
+   #define SAXML_INGEST_THREADED
+   #include <pthread.h>
+#endif
+#if defined(__linux__) && defined(SAXML_HAVE_IO_URING) && !defined(SAXML_NO_MALLOC) \
+    && defined(__GNUC__)
+   #include <linux/io_uring.h>
+   #if defined(IORING_FEAT_RW_CUR_POS) /* IORING_OP_READ from the current position (5.6) */
+      #define SAXML_INGEST_URING
+      #include <string.h> /* memset */
+      #include <sys/mman.h>
+      #include <sys/syscall.h>
+   #endif
+#endif
+
+#define INGEST_READ_SIZE       (1024 * 1024) /* serial read() size, with dynamic allocation */
+#define INGEST_READ_SIZE_STACK 512           /* serial read() size, without */
+#define INGEST_SLOT_SIZE       (256 * 1024)  /* size of each of the two overlapped buffers */
+#define INGEST_UNAVAILABLE     1             /* a backend couldn't start; nothing was read */
+
+/* Parse a chunk, accumulating the offset of its end (or of an error) in *total */
+static int IngestChunk(tSaxmlParser parser, const char *data, const size_t length,
+    size_t *total)
+{
+    size_t position = 0;
+    int result;
+
+    result = saxml_HandleBuffer(parser, data, length, &position);
+    *total += (0 == result) ? length : position;
+    return result;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Serial: read, then parse
+ */
+
+static int IngestSerial(tSaxmlParser parser, const int fd, size_t *offset)
+{
+    char stackBuffer[INGEST_READ_SIZE_STACK];
+    char *buffer = stackBuffer;
+    size_t bufferSize = sizeof(stackBuffer);
+    ssize_t length;
+    int result = 0;
+
+    #ifndef SAXML_NO_MALLOC
+    buffer = (char *) malloc(INGEST_READ_SIZE);
+    if(NULL != buffer)
+        bufferSize = INGEST_READ_SIZE;
+    else
+        buffer = stackBuffer;
+    #endif
+
+    while(0 == result)
+    {
+        length = read(fd, buffer, bufferSize);
+        if(length < 0)
+        {
+            if(EINTR == errno)
+                continue;
+            result = SAXML_ERROR_FILE;
+            break;
+        }
+        if(0 == length)
+            break;
+        result = IngestChunk(parser, buffer, (size_t) length, offset);
+    }
+
+    #ifndef SAXML_NO_MALLOC
+    if(buffer != stackBuffer)
+        free(buffer);
+    #endif
+    return result;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Reader thread: one thread fills a buffer while the caller parses the other
+ */
+
+#if defined(SAXML_INGEST_THREADED)
+
+/* The two buffers are handed back and forth without locks: the reader fills slot (produced % 2)
+ *  while fewer than two slots are filled, and the parser parses slot (consumed % 2) while any
+ *  are, each side only writing its own count. The lock is only taken by a side which has to
+ *  wait, to sleep, and by the other to wake it. The reader hands each buffer over as soon as a
+ *  read() returns, rather than filling it, so that a message arriving on an interactive stream
+ *  isn't held back for the next. */
+typedef struct
+{
+    char *data;
+    ssize_t length;            /* bytes read, 0 at the end of input, or -1 on error */
+    int error;                 /* errno, if length < 0 */
+} tIngestSlot;
+
+#define INGEST_READER 0
+#define INGEST_PARSER 1
+
+typedef struct
+{
+    int fd;
+    tIngestSlot slots[2];
+    unsigned int produced;     /* slots filled, by the reader */
+    unsigned int consumed;     /* slots parsed, by the parser */
+    int waiting[2];            /* set while the reader or parser is going to sleep, or asleep */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} tIngestReader;
+
+static void IngestUnlock(void *lock)
+{
+    pthread_mutex_unlock((pthread_mutex_t *) lock);
+}
+
+/* Wait, as the given side, for the other side's count to move on from value. A side only
+ *  sleeps once it has said so, and the other only checks after moving its count, so one of
+ *  them sees the other's change. */
+static void IngestWait(tIngestReader *reader, const int side, const unsigned int *count,
+    const unsigned int value)
+{
+    if(__atomic_load_n(count, __ATOMIC_ACQUIRE) != value)
+        return;
+
+    pthread_mutex_lock(&reader->lock);
+    pthread_cleanup_push(IngestUnlock, &reader->lock); /* the reader may be cancelled here */
+    __atomic_store_n(&reader->waiting[side], 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(count, __ATOMIC_SEQ_CST) == value)
+        pthread_cond_wait(&reader->wake, &reader->lock);
+    __atomic_store_n(&reader->waiting[side], 0, __ATOMIC_RELAXED);
+    pthread_cleanup_pop(1);
+}
+
+/* Move on a side's own count, waking the other side if it's waiting for that */
+static void IngestPost(tIngestReader *reader, const int side, unsigned int *count)
+{
+    __atomic_store_n(count, *count + 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&reader->waiting[side ^ 1], __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&reader->lock);
+        pthread_cond_signal(&reader->wake);
+        pthread_mutex_unlock(&reader->lock);
+    }
+}
+
+static void *IngestReaderThread(void *argument)
+{
+    tIngestReader *reader = (tIngestReader *) argument;
+    tIngestSlot *slot;
+    ssize_t length;
+
+    do
+    {
+        IngestWait(reader, INGEST_READER, &reader->consumed, reader->produced - 2u);
+        slot = &reader->slots[reader->produced & 1u];
+        do
+        {
+            length = read(reader->fd, slot->data, INGEST_SLOT_SIZE);
+        } while(length < 0 && EINTR == errno);
+        slot->length = length;
+        slot->error = (length < 0) ? errno : 0;
+        IngestPost(reader, INGEST_READER, &reader->produced);
+    } while(length > 0);
+    return NULL;
+}
+
+static int IngestThreaded(tSaxmlParser parser, const int fd, size_t *offset)
+{
+    tIngestReader reader;
+    tIngestSlot *slot;
+    pthread_t thread;
+    char *buffers;
+    int bFinished = 0;
+    int result = INGEST_UNAVAILABLE;
+
+    buffers = (char *) malloc(2 * INGEST_SLOT_SIZE);
+    if(NULL == buffers)
+        return INGEST_UNAVAILABLE;
+    reader.fd = fd;
+    reader.slots[0].data = buffers;
+    reader.slots[1].data = buffers + INGEST_SLOT_SIZE;
+    reader.produced = 0;
+    reader.consumed = 0;
+    reader.waiting[INGEST_READER] = 0;
+    reader.waiting[INGEST_PARSER] = 0;
+    if(0 != pthread_mutex_init(&reader.lock, NULL))
+    {
+        free(buffers);
+        return INGEST_UNAVAILABLE;
+    }
+    if(0 != pthread_cond_init(&reader.wake, NULL))
+    {
+        pthread_mutex_destroy(&reader.lock);
+        free(buffers);
+        return INGEST_UNAVAILABLE;
+    }
+
+    if(0 == pthread_create(&thread, NULL, IngestReaderThread, &reader))
+    {
+        for(result = 0; 0 == result; )
+        {
+            IngestWait(&reader, INGEST_PARSER, &reader.produced, reader.consumed);
+            slot = &reader.slots[reader.consumed & 1u];
+            if(slot->length <= 0)
+            {
+                bFinished = 1;
+                if(slot->length < 0)
+                {
+                    errno = slot->error;
+                    result = SAXML_ERROR_FILE;
+                }
+                break;
+            }
+            result = IngestChunk(parser, slot->data, (size_t) slot->length, offset);
+            IngestPost(&reader, INGEST_PARSER, &reader.consumed);
+        }
+
+        /* After a parsing error, the reader may be waiting for input which never arrives */
+        if(!bFinished)
+            pthread_cancel(thread);
+        pthread_join(thread, NULL);
+    }
+
+    pthread_cond_destroy(&reader.wake);
+    pthread_mutex_destroy(&reader.lock);
+    free(buffers);
+    return result;
+}
+
+#endif /* SAXML_INGEST_THREADED */
+
+/* ---------------------------------------------------------------------------------------------
+ * io_uring: the next read is submitted to the kernel before the current buffer is parsed
+ */
+
+#if defined(SAXML_INGEST_URING)
+
+#define URING_ENTRIES     2
+#define URING_CANCEL_DATA 2 /* user_data of a cancellation; reads use their buffer's index */
+#define URING_CURRENT     ((uint64_t) -1) /* the offset of a read from the current position */
+
+/* A minimal ring, used through the system calls directly, as liburing isn't always available */
+typedef struct
+{
+    int fd;
+    void *rings;
+    size_t ringsSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned int *sqTail, *sqMask, *sqArray;
+    unsigned int *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe *cqes;
+} tIngestRing;
+
+static int RingSetup(tIngestRing *ring)
+{
+    struct io_uring_params params;
+    size_t sqSize, cqSize;
+
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if(ring->fd < 0)
+        return -1;
+    if(0 == (params.features & IORING_FEAT_SINGLE_MMAP)
+       || 0 == (params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        close(ring->fd);
+        return -1;
+    }
+
+    sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ringsSize = (sqSize > cqSize) ? sqSize : cqSize;
+    ring->rings = mmap(NULL, ring->ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+        IORING_OFF_SQ_RING);
+    if(MAP_FAILED == ring->rings)
+    {
+        close(ring->fd);
+        return -1;
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if(MAP_FAILED == (void *) ring->sqes)
+    {
+        munmap(ring->rings, ring->ringsSize);
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sqTail = (unsigned int *) ((char *) ring->rings + params.sq_off.tail);
+    ring->sqMask = (unsigned int *) ((char *) ring->rings + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned int *) ((char *) ring->rings + params.sq_off.array);
+    ring->cqHead = (unsigned int *) ((char *) ring->rings + params.cq_off.head);
+    ring->cqTail = (unsigned int *) ((char *) ring->rings + params.cq_off.tail);
+    ring->cqMask = (unsigned int *) ((char *) ring->rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->rings + params.cq_off.cqes);
+    return 0;
+}
+
+static void RingTeardown(tIngestRing *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    munmap(ring->rings, ring->ringsSize);
+    close(ring->fd);
+}
+
+/* Queue a request and submit it to the kernel. Returns 0 on success, or -1 with errno set. */
+static int RingSubmit(tIngestRing *ring, const uint8_t opcode, const int fd,
+    const uint64_t offset, void *address, const unsigned int length, const uint64_t userData)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail, index;
+
+    tail = *ring->sqTail; /* only written here */
+    index = tail & *ring->sqMask;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t) (uintptr_t) address;
+    sqe->len = length;
+    sqe->user_data = userData;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while(syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0)
+    {
+        if(EINTR != errno)
+            return -1;
+    }
+    return 0;
+}
+
+/* Read into one of the two buffers, from the current position as read() does, identifying the
+ *  read by the buffer's index */
+static int RingRead(tIngestRing *ring, const int fd, char *buffers[2], const unsigned int index)
+{
+    return RingSubmit(ring, IORING_OP_READ, fd, URING_CURRENT, buffers[index], INGEST_SLOT_SIZE,
+        index);
+}
+
+/* Wait for a request to complete. Returns 0 on success, or -1 with errno set. */
+static int RingComplete(tIngestRing *ring, uint64_t *userData, int32_t *value)
+{
+    struct io_uring_cqe *cqe;
+    unsigned int head;
+
+    for(;;)
+    {
+        head = *ring->cqHead; /* only written here */
+        if(head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            cqe = &ring->cqes[head & *ring->cqMask];
+            *userData = cqe->user_data;
+            *value = cqe->res;
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if(syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+           && EINTR != errno)
+        {
+            return -1;
+        }
+    }
+}
+
+static int IngestUring(tSaxmlParser parser, const int fd, size_t *offset)
+{
+    tIngestRing ring;
+    char *buffers[2];
+    uint64_t userData;
+    int32_t value;
+    unsigned int i = 0;
+    int bPending = 0;
+    int result = 0;
+
+    if(0 != RingSetup(&ring))
+        return INGEST_UNAVAILABLE;
+    buffers[0] = (char *) malloc(2 * INGEST_SLOT_SIZE);
+    if(NULL == buffers[0])
+    {
+        RingTeardown(&ring);
+        return INGEST_UNAVAILABLE;
+    }
+    buffers[1] = buffers[0] + INGEST_SLOT_SIZE;
+
+    if(0 != RingRead(&ring, fd, buffers, 0))
+        result = INGEST_UNAVAILABLE;
+    else
+        bPending = 1;
+    while(0 == result)
+    {
+        if(0 != RingComplete(&ring, &userData, &value))
+        {
+            result = SAXML_ERROR_FILE;
+            break;
+        }
+        bPending = 0;
+        if(value < 0)
+        {
+            if(-EINTR == value || -EAGAIN == value)
+            {
+                if(0 == RingRead(&ring, fd, buffers, i))
+                {
+                    bPending = 1;
+                    continue;
+                }
+            }
+            else
+                errno = -value;
+            result = SAXML_ERROR_FILE;
+            break;
+        }
+        if(0 == value)
+            break;
+
+        /* Read ahead into the other buffer while this one is parsed */
+        if(0 != RingRead(&ring, fd, buffers, i ^ 1))
+        {
+            result = SAXML_ERROR_FILE;
+            break;
+        }
+        bPending = 1;
+        result = IngestChunk(parser, buffers[i], (size_t) value, offset);
+        i ^= 1;
+    }
+
+    /* The kernel may still write to the buffer of a read in flight (perhaps waiting for input
+       which never arrives), so it's cancelled, and its completion awaited, before it's freed. A
+       read the cancellation didn't find has already completed; if the cancellation itself
+       failed, the read may never complete, so the buffer is left allocated rather than waited
+       for. */
+    if(bPending && 0 == RingSubmit(&ring, IORING_OP_ASYNC_CANCEL, -1, 0,
+        (void *) (uintptr_t) (i & 1), 0, URING_CANCEL_DATA))
+    {
+        while(0 == RingComplete(&ring, &userData, &value))
+        {
+            if(URING_CANCEL_DATA != userData)
+            {
+                bPending = 0;
+                break;
+            }
+            if(value < 0 && -EALREADY != value && -ENOENT != value)
+            {
+                DBG1("[saxml] Failed to cancel a read (%d)\n", (int) value);
+                break;
+            }
+        }
+    }
+
+    if(!bPending)
+        free(buffers[0]);
+    RingTeardown(&ring);
+    return result;
+}
+
+#endif /* SAXML_INGEST_URING */
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+int saxml_ParseDescriptor(tSaxmlParser parser, const int fd, const int mode, size_t *offset)
+{
+    size_t position = 0;
+    int result = INGEST_UNAVAILABLE;
+
+    #if defined(SAXML_INGEST_URING)
+    if(SAXML_INGEST_AUTO == mode || SAXML_INGEST_IO_URING == mode)
+        result = IngestUring(parser, fd, &position);
+    #endif
+    #if defined(SAXML_INGEST_THREADED)
+    if(INGEST_UNAVAILABLE == result && (SAXML_INGEST_AUTO == mode || SAXML_INGEST_THREAD == mode))
+        result = IngestThreaded(parser, fd, &position);
+    #endif
+    if(INGEST_UNAVAILABLE == result && (SAXML_INGEST_AUTO == mode || SAXML_INGEST_SERIAL == mode))
+        result = IngestSerial(parser, fd, &position);
+
+    if(INGEST_UNAVAILABLE == result)
+    {
+        DBG1("[saxml] Ingest mode %d isn't available\n", mode);
+        errno = ENOSYS;
+        result = SAXML_ERROR_FILE;
+    }
+    if(NULL != offset)
+        *offset = position;
+    return result;
+}
@@ -0,0 +1,1118 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parsing on multiple threads: speculatively, of a complete document, and of
+ *         independent records (concatenated documents)
+ */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include "parser.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* memchr, memcpy, strlen */
+#if !defined(SAXML_NO_MALLOC) && !defined(SAXML_NO_THREADS)
+   #define SAXML_PARALLEL
+   #include <stdlib.h> /* malloc, realloc, free */
+   #include <pthread.h>
+#endif
+
+#define PARALLEL_DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define PARALLEL_CHUNKS_PER_THREAD  2 /* chunks parsed ahead of delivery, per worker thread */
+#define PARALLEL_MIN_EVENTS         256
+#define PARALLEL_MIN_ARENA          4096
+
+/* ---------------------------------------------------------------------------------------------
+ * Record boundaries
+ */
+
+/* Find a terminator (e.g. "-->") in [position, end). Returns the character after it, or NULL. */
+static const char *FindTerminator(const char *position, const char * const end,
+    const char *terminator, const size_t length)
+{
+    const char *start = position;
+    const char *found;
+
+    while(NULL != (found = (const char *) memchr(position, terminator[length - 1],
+        (size_t) (end - position))))
+    {
+        if((size_t) (found - start) >= length - 1
+           && 0 == memcmp(found - (length - 1), terminator, length - 1))
+        {
+            return found + 1;
+        }
+        position = found + 1;
+    }
+    return NULL;
+}
+
+/* Find the '>' which ends a tag or declaration, outside of quotes and (for a declaration) its
+ *  internal subset. Returns the character after it, or NULL. */
+static const char *FindTagEnd(const char *position, const char * const end,
+    const int bDeclaration)
+{
+    int bQuoted = 0, bSubset = 0;
+
+    for(; position < end; ++position)
+    {
+        if('"' == *position)
+            bQuoted = !bQuoted;
+        else if(bQuoted)
+            ;
+        else if('[' == *position && bDeclaration)
+            bSubset = 1;
+        else if(']' == *position)
+            bSubset = 0;
+        else if('>' == *position && !bSubset)
+            return position + 1;
+    }
+    return NULL;
+}
+
+/* Find the end of the record starting at position: its root element, and anything before it.
+ *  Elements are passed over as skipped elements are (see saxml_SkipCurrentElement), so quotes
+ *  only matter within tags. Returns the character after the root element's end, or NULL if
+ *  the record isn't complete. */
+static const char *RecordEnd(const char *position, const char * const end)
+{
+    uint32_t depth = 0;
+
+    for(;;)
+    {
+        position = (const char *) memchr(position, '<', (size_t) (end - position));
+        if(NULL == position || end - position < 2)
+            return NULL;
+        ++position;
+
+        if('/' == *position)
+        {
+            position = (const char *) memchr(position, '>', (size_t) (end - position));
+            if(NULL == position)
+                return NULL;
+            ++position;
+            if(depth <= 1)
+                return position;
+            --depth;
+        }
+        else if('?' == *position)
+            position = FindTerminator(position + 1, end, "?>", 2);
+        else if('!' == *position)
+        {
+            if(end - position >= 3 && 0 == memcmp(position, "!--", 3))
+                position = FindTerminator(position + 3, end, "-->", 3);
+            else if(end - position < 8)
+                return NULL; /* can't yet tell which kind of declaration this is */
+            else if(0 == memcmp(position, "![CDATA[", 8))
+                position = FindTerminator(position + 8, end, "]]>", 3);
+            else
+                position = FindTagEnd(position, end, 1);
+        }
+        else
+        {
+            position = FindTagEnd(position, end, 0);
+            if(NULL == position)
+                return NULL;
+            if('/' != position[-2])
+                ++depth;
+            else if(0 == depth)
+                return position; /* an empty root element */
+        }
+        if(NULL == position)
+            return NULL;
+    }
+}
+
+/* Parse each complete record in order, on the calling thread */
+static int RecordsSerial(tParserContext *ctxt, const char *buffer, const char * const bufferEnd,
+    const char **stop)
+{
+    const char *end;
+    size_t offset;
+    int result;
+
+    while(NULL != (end = RecordEnd(buffer, bufferEnd)))
+    {
+        saxml_Reset(ctxt);
+        result = saxml_HandleBuffer(ctxt, buffer, (size_t) (end - buffer), &offset);
+        if(0 != result)
+        {
+            *stop = buffer + offset;
+            return result;
+        }
+        buffer = end;
+    }
+    *stop = buffer;
+    return 0;
+}
+
+#if defined(SAXML_PARALLEL)
+
+/* The document is split into chunks, each starting just after a '<'. Worker threads parse each
+ *  chunk from the state the parser would be in just after a tag start character, recording the
+ *  events rather than delivering them. The calling thread then delivers the chunks in order:
+ *  when the parser really is in that state at the start of a chunk, the chunk's events are
+ *  replayed and its end state taken over; otherwise (e.g. the '<' was within quoted text), the
+ *  chunk is parsed again, on the calling thread. */
+
+/* Handler through which an event was delivered, so that it's replayed through the same one */
+typedef enum
+{
+    EVENT_TAG,
+    EVENT_TAG_END,
+    EVENT_CONTENT,
+    EVENT_ATTRIBUTE,
+    EVENT_TAG_SPAN,
+    EVENT_TAG_END_SPAN,
+    EVENT_CONTENT_SPAN,
+    EVENT_ATTRIBUTE_SPAN,
+    EVENT_TAG_ID,
+    EVENT_TAG_END_ID,
+    EVENT_ATTRIBUTE_ID,
+    EVENT_ATTRIBUTES,
+    EVENT_CONTENT_FRAGMENT,
+    EVENT_ATTRIBUTE_FRAGMENT,
+    EVENT_DOCUMENT_START,
+    EVENT_DOCUMENT_END
+} eEvent;
+
+/* The caller's handlers, through which recorded events are delivered */
+typedef struct
+{
+    tSaxmlContext *user;
+    const tSaxmlSpanContext *spans;
+    pfnAttributesHandler pfnAttributes;
+    const tSaxmlIdContext *ids;
+    const tSaxmlFragmentContext *fragments;
+    const tSaxmlDocumentContext *documents;
+} tHandlers;
+
+typedef struct
+{
+    uint8_t event;
+    int32_t id;       /* or for fragments, the more flag, or for documents, the index */
+    const char *data; /* within the document, or NULL if copied into the chunk's arena */
+    size_t offset;    /* within the arena */
+    size_t length;
+} tEvent;
+
+typedef struct
+{
+    /* Recording handlers, with the chunk as the cookie */
+    tSaxmlContext context;
+    tSaxmlSpanContext spans;
+    tSaxmlIdContext ids;
+    tSaxmlFragmentContext fragments;
+    tSaxmlDocumentContext documents;
+    tParserContext *parser;
+    char *stack; /* the parser's own element stack, for records */
+
+    const char *document;
+    const char *documentEnd;
+
+    tEvent *events;
+    size_t eventCount;
+    size_t eventCapacity;
+    char *arena; /* strings which aren't within the document, each NUL-terminated */
+    size_t arenaLength;
+    size_t arenaCapacity;
+    int bFailed; /* true if the events didn't fit in memory; the chunk must be parsed again */
+
+    /* While the chunk is parsed again by the caller's parser after a skip (see ChunkReparse),
+       events are forwarded to the caller's handlers rather than being recorded */
+    tParserContext *forward;
+    size_t skipAt;
+    tHandlers handlers;
+
+    int result;
+    const char *stop;
+    const char *end; /* for records, the end of the record */
+    int bParsed;
+} tChunk;
+
+typedef struct
+{
+    const char *document;
+    size_t length;
+    size_t chunkSize;
+    uint32_t chunkCount;
+
+    tChunk *chunks; /* chunk n is parsed in chunks[n % slotCount] */
+    uint32_t slotCount;
+    uint32_t nextChunk;      /* next chunk to be claimed by a worker */
+    uint32_t deliveredCount; /* chunks which have been delivered, so whose slots are free */
+    int bStop;
+
+    /* Records are found as they're claimed, so their number is only known once the last one
+       has been; until then, chunkCount is UINT32_MAX */
+    const tParserContext *ctxt;
+    int bOrdered;
+    size_t nextStart;
+
+    pthread_mutex_t lock;
+    pthread_cond_t slotFree;
+    pthread_cond_t chunkParsed;
+} tParallel;
+
+/* ---------------------------------------------------------------------------------------------
+ * Event recording
+ */
+
+static void ChunkForward(tChunk *chunk, const uint8_t event, const int32_t id, const char *data,
+    const size_t length);
+
+static void Record(tChunk *chunk, const uint8_t event, const int32_t id, const char *data,
+    const size_t length)
+{
+    tEvent *e;
+    void *grown;
+    size_t capacity;
+
+    if(NULL != chunk->forward)
+    {
+        ChunkForward(chunk, event, id, data, length);
+        return;
+    }
+    if(chunk->bFailed)
+        return;
+
+    if(chunk->eventCount == chunk->eventCapacity)
+    {
+        capacity = (0 == chunk->eventCapacity) ? PARALLEL_MIN_EVENTS : 2 * chunk->eventCapacity;
+        grown = realloc(chunk->events, capacity * sizeof(*e));
+        if(NULL == grown)
+        {
+            chunk->bFailed = 1;
+            return;
+        }
+        chunk->events = (tEvent *) grown;
+        chunk->eventCapacity = capacity;
+    }
+
+    e = &chunk->events[chunk->eventCount];
+    e->event = event;
+    e->id = id;
+    e->length = length;
+    if(data >= chunk->document && data + length <= chunk->documentEnd)
+        e->data = data; /* remains valid until the caller's buffer goes away */
+    else
+    {
+        /* Copied from the chunk parser's string buffer, which will be reused */
+        if(chunk->arenaCapacity - chunk->arenaLength < length + 1)
+        {
+            capacity = (0 == chunk->arenaCapacity) ? PARALLEL_MIN_ARENA : chunk->arenaCapacity;
+            while(capacity - chunk->arenaLength < length + 1)
+                capacity *= 2;
+            grown = realloc(chunk->arena, capacity);
+            if(NULL == grown)
+            {
+                chunk->bFailed = 1;
+                return;
+            }
+            chunk->arena = (char *) grown;
+            chunk->arenaCapacity = capacity;
+        }
+        memcpy(&chunk->arena[chunk->arenaLength], data, length);
+        chunk->arena[chunk->arenaLength + length] = '\0';
+        e->data = NULL;
+        e->offset = chunk->arenaLength;
+        chunk->arenaLength += length + 1;
+    }
+    ++(chunk->eventCount);
+}
+
+static void RecordTag(void *cookie, const char *s)
+    { Record((tChunk *) cookie, EVENT_TAG, 0, s, strlen(s)); }
+static void RecordTagEnd(void *cookie, const char *s)
+    { Record((tChunk *) cookie, EVENT_TAG_END, 0, s, strlen(s)); }
+static void RecordContent(void *cookie, const char *s)
+    { Record((tChunk *) cookie, EVENT_CONTENT, 0, s, strlen(s)); }
+static void RecordAttribute(void *cookie, const char *s)
+    { Record((tChunk *) cookie, EVENT_ATTRIBUTE, 0, s, strlen(s)); }
+static void RecordTagSpan(void *cookie, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_TAG_SPAN, 0, s, l); }
+static void RecordTagEndSpan(void *cookie, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_TAG_END_SPAN, 0, s, l); }
+static void RecordContentSpan(void *cookie, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_CONTENT_SPAN, 0, s, l); }
+static void RecordAttributeSpan(void *cookie, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_ATTRIBUTE_SPAN, 0, s, l); }
+static void RecordTagId(void *cookie, int32_t id, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_TAG_ID, id, s, l); }
+static void RecordTagEndId(void *cookie, int32_t id, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_TAG_END_ID, id, s, l); }
+static void RecordAttributeId(void *cookie, int32_t id, const char *s, size_t l)
+    { Record((tChunk *) cookie, EVENT_ATTRIBUTE_ID, id, s, l); }
+static void RecordAttributes(void *cookie, const tSaxmlAttributes *attributes)
+    { Record((tChunk *) cookie, EVENT_ATTRIBUTES, 0, attributes->data, attributes->length); }
+static void RecordContentFragment(void *cookie, const char *s, size_t l, int more)
+    { Record((tChunk *) cookie, EVENT_CONTENT_FRAGMENT, more, s, l); }
+static void RecordAttributeFragment(void *cookie, const char *s, size_t l, int more)
+    { Record((tChunk *) cookie, EVENT_ATTRIBUTE_FRAGMENT, more, s, l); }
+static void RecordDocumentStart(void *cookie, uint32_t index)
+    { Record((tChunk *) cookie, EVENT_DOCUMENT_START, (int32_t) index, "", 0); }
+static void RecordDocumentEnd(void *cookie, uint32_t index)
+    { Record((tChunk *) cookie, EVENT_DOCUMENT_END, (int32_t) index, "", 0); }
+
+#define RECORD_IF(handler, recorder) ((NULL != (handler)) ? (recorder) : NULL)
+
+/* Set up a chunk's parser with the caller's configuration, recording events for each of the
+ *  caller's handlers */
+static void ChunkConfigure(tChunk *chunk, const tParserContext *ctxt)
+{
+    tParserContext *parser = chunk->parser;
+    const tSaxmlContext *user = ctxt->user;
+
+    chunk->context.tagHandler = RECORD_IF(user->tagHandler, RecordTag);
+    chunk->context.tagEndHandler = RECORD_IF(user->tagEndHandler, RecordTagEnd);
+    chunk->context.parameterHandler = NULL;
+    chunk->context.contentHandler = RECORD_IF(user->contentHandler, RecordContent);
+    chunk->context.attributeHandler = RECORD_IF(user->attributeHandler, RecordAttribute);
+
+    parser->spans = NULL;
+    if(NULL != ctxt->spans)
+    {
+        chunk->spans.tagHandler = RECORD_IF(ctxt->spans->tagHandler, RecordTagSpan);
+        chunk->spans.tagEndHandler = RECORD_IF(ctxt->spans->tagEndHandler, RecordTagEndSpan);
+        chunk->spans.contentHandler = RECORD_IF(ctxt->spans->contentHandler, RecordContentSpan);
+        chunk->spans.attributeHandler =
+            RECORD_IF(ctxt->spans->attributeHandler, RecordAttributeSpan);
+        parser->spans = &chunk->spans;
+    }
+
+    parser->ids = NULL;
+    if(NULL != ctxt->ids)
+    {
+        chunk->ids.tagHandler = RECORD_IF(ctxt->ids->tagHandler, RecordTagId);
+        chunk->ids.tagEndHandler = RECORD_IF(ctxt->ids->tagEndHandler, RecordTagEndId);
+        chunk->ids.attributeHandler = RECORD_IF(ctxt->ids->attributeHandler, RecordAttributeId);
+        parser->ids = &chunk->ids;
+    }
+    parser->vocabulary = ctxt->vocabulary;
+
+    parser->fragments = NULL;
+    if(NULL != ctxt->fragments)
+    {
+        chunk->fragments.contentHandler =
+            RECORD_IF(ctxt->fragments->contentHandler, RecordContentFragment);
+        chunk->fragments.attributeHandler =
+            RECORD_IF(ctxt->fragments->attributeHandler, RecordAttributeFragment);
+        parser->fragments = &chunk->fragments;
+    }
+    parser->pfnAttributes = RECORD_IF(ctxt->pfnAttributes, RecordAttributes);
+
+    parser->pfnScan = ctxt->pfnScan;
+    parser->scanSets = ctxt->scanSets;
+    parser->bAllowTruncatedStrings = ctxt->bAllowTruncatedStrings;
+    parser->bDecodeReferences = ctxt->bDecodeReferences;
+    parser->bValidateUtf8 = ctxt->bValidateUtf8;
+    parser->eventMask = ctxt->eventMask;
+    parser->whitespace = ctxt->whitespace;
+
+    /* Every chunk but the first starts just after a '<', so not within a UTF-8 sequence */
+    parser->state = STATE_START_TAG;
+    parser->length = 0;
+    parser->spanLength = 0;
+    parser->bFragmented = 0;
+    parser->bSkipRequested = 0;
+    parser->skipDepth = 0;
+    encoding_Utf8Reset(&parser->utf8);
+    #if defined(SAXML_ENABLE_STATS)
+    memset(&parser->stats, 0, sizeof(parser->stats));
+    parser->statsDepth = 0;
+    #endif
+
+    chunk->eventCount = 0;
+    chunk->arenaLength = 0;
+    chunk->bFailed = 0;
+    chunk->forward = NULL;
+}
+
+static void GetHandlers(tHandlers *handlers, const tParserContext *ctxt)
+{
+    handlers->user = ctxt->user;
+    handlers->spans = ctxt->spans;
+    handlers->pfnAttributes = ctxt->pfnAttributes;
+    handlers->ids = ctxt->ids;
+    handlers->fragments = ctxt->fragments;
+    handlers->documents = ctxt->documents;
+}
+
+/* Deliver an event to the caller's handlers */
+static void Deliver(const tHandlers *h, const tEvent *e, const char *data)
+{
+    void *cookie = h->user->cookie;
+    tSaxmlAttributes attributes;
+
+    switch(e->event)
+    {
+        case EVENT_TAG: h->user->tagHandler(cookie, data); break;
+        case EVENT_TAG_END: h->user->tagEndHandler(cookie, data); break;
+        case EVENT_CONTENT: h->user->contentHandler(cookie, data); break;
+        case EVENT_ATTRIBUTE: h->user->attributeHandler(cookie, data); break;
+        case EVENT_TAG_SPAN: h->spans->tagHandler(cookie, data, e->length); break;
+        case EVENT_TAG_END_SPAN: h->spans->tagEndHandler(cookie, data, e->length); break;
+        case EVENT_CONTENT_SPAN: h->spans->contentHandler(cookie, data, e->length); break;
+        case EVENT_ATTRIBUTE_SPAN: h->spans->attributeHandler(cookie, data, e->length); break;
+        case EVENT_TAG_ID: h->ids->tagHandler(cookie, e->id, data, e->length); break;
+        case EVENT_TAG_END_ID: h->ids->tagEndHandler(cookie, e->id, data, e->length); break;
+        case EVENT_ATTRIBUTE_ID: h->ids->attributeHandler(cookie, e->id, data, e->length); break;
+        case EVENT_ATTRIBUTES:
+            attributes.data = data;
+            attributes.length = e->length;
+            h->pfnAttributes(cookie, &attributes);
+            break;
+        case EVENT_CONTENT_FRAGMENT:
+            h->fragments->contentHandler(cookie, data, e->length, (int) e->id);
+            break;
+        case EVENT_ATTRIBUTE_FRAGMENT:
+            h->fragments->attributeHandler(cookie, data, e->length, (int) e->id);
+            break;
+        case EVENT_DOCUMENT_START: h->documents->startHandler(cookie, (uint32_t) e->id); break;
+        case EVENT_DOCUMENT_END: h->documents->endHandler(cookie, (uint32_t) e->id); break;
+        default: break;
+    }
+}
+
+/* Deliver a chunk's recorded events to the caller's handlers. With bSkip, stops at an event
+ *  during which a handler asks to skip the current element, returning its index; otherwise
+ *  such requests are ignored. Returns the number of events if all were delivered. */
+static size_t ChunkReplay(tParserContext *ctxt, const tChunk *chunk, const int bSkip)
+{
+    tHandlers handlers;
+    const tEvent *e;
+    size_t i;
+
+    GetHandlers(&handlers, ctxt);
+    for(i = 0; i < chunk->eventCount; ++i)
+    {
+        e = &chunk->events[i];
+        Deliver(&handlers, e, (NULL != e->data) ? e->data : &chunk->arena[e->offset]);
+        if(ctxt->bSkipRequested)
+        {
+            ctxt->bSkipRequested = 0;
+            if(bSkip)
+                return i;
+        }
+    }
+    return chunk->eventCount;
+}
+
+/* An event from the caller's parser, parsing a chunk again after a skip */
+static void ChunkForward(tChunk *chunk, const uint8_t event, const int32_t id, const char *data,
+    const size_t length)
+{
+    tEvent e;
+    size_t n = (chunk->eventCount)++;
+
+    if(n < chunk->skipAt)
+        return; /* delivered already */
+    if(n == chunk->skipAt)
+    {
+        /* Delivered already too, but the skip is requested now, where the engine acts on it */
+        chunk->forward->bSkipRequested = 1;
+        return;
+    }
+    e.event = event;
+    e.id = id;
+    e.length = length;
+    Deliver(&chunk->handlers, &e, data);
+}
+
+/* A handler asked to skip the current element during the replay of a chunk's event at skipAt.
+ *  The serial parser would have acted on that where the event ended, but the chunk's parser
+ *  didn't, so the chunk is parsed again by the caller's parser, from the start state it was
+ *  replayed from. Events up to skipAt have been delivered already, so are dropped; the rest
+ *  are forwarded to the caller's handlers as they're parsed, where further skips take effect
+ *  as usual. */
+static int ChunkReparse(tParserContext *ctxt, tChunk *chunk, const size_t skipAt,
+    const char *start, const char *end, const char **stop)
+{
+    int result;
+
+    GetHandlers(&chunk->handlers, ctxt);
+    chunk->forward = ctxt;
+    chunk->skipAt = skipAt;
+    chunk->eventCount = 0;
+
+    /* The recording handlers are registered for the same events as the caller's */
+    ctxt->user = &chunk->context;
+    ctxt->spans = (NULL != ctxt->spans) ? &chunk->spans : NULL;
+    ctxt->ids = (NULL != ctxt->ids) ? &chunk->ids : NULL;
+    ctxt->fragments = (NULL != ctxt->fragments) ? &chunk->fragments : NULL;
+    ctxt->pfnAttributes = RECORD_IF(ctxt->pfnAttributes, RecordAttributes);
+
+    result = parser_ParsePart(ctxt, start, end, stop);
+
+    ctxt->user = chunk->handlers.user;
+    ctxt->spans = chunk->handlers.spans;
+    ctxt->ids = chunk->handlers.ids;
+    ctxt->fragments = chunk->handlers.fragments;
+    ctxt->pfnAttributes = chunk->handlers.pfnAttributes;
+    chunk->forward = NULL;
+    return result;
+}
+
+/* Take over the state of a chunk's parser at the end of the chunk; the caller's parser must
+ *  have a buffer for any partial token (see parser_AcquireBuffer) */
+static void ChunkTakeState(tParserContext *ctxt, const tChunk *chunk)
+{
+    const tParserContext *parser = chunk->parser;
+
+    ctxt->state = parser->state;
+    if(parser->length > 0)
+        memcpy(ctxt->buffer, parser->buffer, parser->length);
+    ctxt->length = parser->length;
+    ctxt->spanStart = parser->spanStart;
+    ctxt->spanLength = parser->spanLength;
+    ctxt->bFragmented = parser->bFragmented;
+    ctxt->referenceState = parser->referenceState;
+    ctxt->referenceLength = parser->referenceLength;
+    memcpy(ctxt->reference, parser->reference, sizeof(ctxt->reference));
+    ctxt->skipDepth = parser->skipDepth;
+    ctxt->markupState = parser->markupState;
+    ctxt->markupMatched = parser->markupMatched;
+    ctxt->utf8 = parser->utf8;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Chunking and worker threads
+ */
+
+/* Offset of the start of a chunk; just after the first '<' at or after its nominal start */
+static size_t ChunkStart(const tParallel *parallel, const uint32_t chunk)
+{
+    size_t start = (size_t) chunk * parallel->chunkSize;
+    const char *found;
+
+    if(0 == chunk)
+        return 0;
+    if(chunk >= parallel->chunkCount)
+        return parallel->length;
+    found = (const char *) memchr(&parallel->document[start], '<', parallel->length - start);
+    return (NULL == found) ? parallel->length : (size_t) (found - parallel->document) + 1;
+}
+
+static void *Worker(void *argument)
+{
+    tParallel *parallel = (tParallel *) argument;
+    tChunk *chunk;
+    uint32_t n;
+
+    pthread_mutex_lock(&parallel->lock);
+    for(;;)
+    {
+        while(!parallel->bStop && parallel->nextChunk < parallel->chunkCount
+              && parallel->nextChunk >= parallel->deliveredCount + parallel->slotCount)
+            pthread_cond_wait(&parallel->slotFree, &parallel->lock);
+        if(parallel->bStop || parallel->nextChunk >= parallel->chunkCount)
+            break;
+        n = (parallel->nextChunk)++;
+        chunk = &parallel->chunks[n % parallel->slotCount];
+        pthread_mutex_unlock(&parallel->lock);
+
+        chunk->result = parser_ParsePart(chunk->parser, &parallel->document[ChunkStart(parallel, n)],
+            &parallel->document[ChunkStart(parallel, n + 1)], &chunk->stop);
+
+        pthread_mutex_lock(&parallel->lock);
+        chunk->bParsed = 1;
+        pthread_cond_broadcast(&parallel->chunkParsed);
+    }
+    pthread_mutex_unlock(&parallel->lock);
+
+    return NULL;
+}
+
+static void ParallelFree(tParallel *parallel)
+{
+    uint32_t i;
+    tChunk *chunk;
+
+    for(i = 0; i < parallel->slotCount; ++i)
+    {
+        chunk = &parallel->chunks[i];
+        if(NULL != chunk->parser)
+            free(chunk->parser);
+        free(chunk->stack);
+        free(chunk->events);
+        free(chunk->arena);
+    }
+    free(parallel->chunks);
+}
+
+/* Allocate a parser for each slot. Returns 0 on success. */
+static int ParallelAllocate(tParallel *parallel, const tParserContext *ctxt)
+{
+    size_t storageSize = saxml_StorageSize(ctxt->maxStringSize);
+    tChunk *chunk;
+    void *storage;
+    uint32_t i;
+
+    parallel->chunks = (tChunk *) calloc(parallel->slotCount, sizeof(tChunk));
+    if(NULL == parallel->chunks)
+        return -1;
+
+    for(i = 0; i < parallel->slotCount; ++i)
+    {
+        chunk = &parallel->chunks[i];
+        chunk->context.cookie = chunk;
+        chunk->document = parallel->document;
+        chunk->documentEnd = parallel->document + parallel->length;
+        /* malloc'd memory is always suitably aligned, so the context is at the start */
+        storage = malloc(storageSize);
+        if(NULL == storage)
+            return -1;
+        chunk->parser = (tParserContext *) saxml_InitializeInPlace(storage, storageSize,
+            &chunk->context, ctxt->maxStringSize);
+        if(NULL == chunk->parser)
+        {
+            free(storage);
+            return -1;
+        }
+        ChunkConfigure(chunk, ctxt);
+    }
+
+    return 0;
+}
+
+static int ParseParallel(tParserContext *ctxt, tParallel *parallel, const uint32_t threadCount,
+    const char **stop)
+{
+    pthread_t *threads;
+    uint32_t started, n;
+    tChunk *chunk;
+    size_t skipAt;
+    int result, bReplay;
+
+    threads = (pthread_t *) malloc(threadCount * sizeof(pthread_t));
+    if(NULL == threads)
+        return parser_ParsePart(ctxt, parallel->document, parallel->document + parallel->length,
+            stop);
+
+    for(started = 0; started < threadCount; ++started)
+    {
+        if(0 != pthread_create(&threads[started], NULL, Worker, parallel))
+            break;
+    }
+
+    /* The first chunk is parsed here, from the caller's state, while the rest are parsed ahead */
+    result = parser_ParsePart(ctxt, parallel->document,
+        &parallel->document[ChunkStart(parallel, 1)], stop);
+
+    for(n = 1; 0 == result && n < parallel->chunkCount; ++n)
+    {
+        chunk = &parallel->chunks[n % parallel->slotCount];
+        if(0 == started)
+            chunk->bParsed = 0; /* no worker threads; parse everything here */
+        else
+        {
+            pthread_mutex_lock(&parallel->lock);
+            while(!chunk->bParsed)
+                pthread_cond_wait(&parallel->chunkParsed, &parallel->lock);
+            pthread_mutex_unlock(&parallel->lock);
+        }
+
+        bReplay = chunk->bParsed && !chunk->bFailed && STATE_START_TAG == ctxt->state
+            && 0 == ctxt->length && 0 == ctxt->spanLength;
+        if(bReplay && chunk->parser->length > 0 && !parser_AcquireBuffer(ctxt))
+        {
+            /* A pooled parser returns its buffer whenever nothing is buffered, so may need
+               another for the partial token at the end of the chunk; if none is free, the
+               chunk isn't delivered */
+            DBG("[saxml] No pool buffer is free\n");
+            STATS_ADD(ctxt, errors, 1)
+            result = SAXML_ERROR_POOL;
+            *stop = &parallel->document[ChunkStart(parallel, n)];
+        }
+        else if(bReplay)
+        {
+            STATS_HANDLER_BEGIN(ctxt)
+            skipAt = ChunkReplay(ctxt, chunk, 1);
+            STATS_HANDLER_END(ctxt)
+            if(skipAt < chunk->eventCount)
+            {
+                result = ChunkReparse(ctxt, chunk, skipAt,
+                    &parallel->document[ChunkStart(parallel, n)],
+                    &parallel->document[ChunkStart(parallel, n + 1)], stop);
+            }
+            else
+            {
+                #if defined(SAXML_ENABLE_STATS)
+                parser_MergeStats(ctxt, chunk->parser);
+                #endif
+                ChunkTakeState(ctxt, chunk);
+                result = chunk->result;
+                *stop = chunk->stop;
+            }
+        }
+        else
+        {
+            result = parser_ParsePart(ctxt, &parallel->document[ChunkStart(parallel, n)],
+                &parallel->document[ChunkStart(parallel, n + 1)], stop);
+        }
+
+        pthread_mutex_lock(&parallel->lock);
+        ChunkConfigure(chunk, ctxt);
+        chunk->bParsed = 0;
+        ++(parallel->deliveredCount);
+        pthread_cond_broadcast(&parallel->slotFree);
+        pthread_mutex_unlock(&parallel->lock);
+    }
+
+    pthread_mutex_lock(&parallel->lock);
+    parallel->bStop = 1;
+    pthread_cond_broadcast(&parallel->slotFree);
+    pthread_mutex_unlock(&parallel->lock);
+    for(n = 0; n < started; ++n)
+        pthread_join(threads[n], NULL);
+    free(threads);
+
+    return result;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Records
+ */
+
+/* Records are claimed by worker threads in order, each finding the end of the one it claims,
+ *  and parsed from the start by the slot's parser. In order, the calling thread then either
+ *  replays each record's events, or (for unordered delivery, where the worker's parser calls
+ *  the caller's handlers itself) just collects its result. */
+
+/* Set up a slot's parser to parse a record from the start */
+static void RecordsConfigure(tChunk *chunk, const tParallel *parallel)
+{
+    const tParserContext *ctxt = parallel->ctxt;
+    tParserContext *parser = chunk->parser;
+
+    parser->documents = NULL;
+    if(parallel->bOrdered)
+    {
+        ChunkConfigure(chunk, ctxt);
+        if(NULL != ctxt->documents)
+        {
+            chunk->documents.startHandler =
+                RECORD_IF(ctxt->documents->startHandler, RecordDocumentStart);
+            chunk->documents.endHandler =
+                RECORD_IF(ctxt->documents->endHandler, RecordDocumentEnd);
+            parser->documents = &chunk->documents;
+        }
+    }
+    else
+    {
+        parser->user = ctxt->user;
+        parser->spans = ctxt->spans;
+        parser->ids = ctxt->ids;
+        parser->vocabulary = ctxt->vocabulary;
+        parser->fragments = ctxt->fragments;
+        parser->pfnAttributes = ctxt->pfnAttributes;
+        parser->pfnScan = ctxt->pfnScan;
+        parser->scanSets = ctxt->scanSets;
+        parser->bAllowTruncatedStrings = ctxt->bAllowTruncatedStrings;
+        parser->bDecodeReferences = ctxt->bDecodeReferences;
+        parser->bValidateUtf8 = ctxt->bValidateUtf8;
+        parser->eventMask = ctxt->eventMask;
+        parser->whitespace = ctxt->whitespace;
+        parser->documents = ctxt->documents;
+        chunk->eventCount = 0;
+        chunk->arenaLength = 0;
+        chunk->bFailed = 0;
+        #if defined(SAXML_ENABLE_STATS)
+        memset(&parser->stats, 0, sizeof(parser->stats));
+        #endif
+    }
+
+    parser->stack = chunk->stack;
+    parser->stackSize = (NULL == chunk->stack) ? 0 : ctxt->stackSize;
+    memcpy(parser->subscriptions, ctxt->subscriptions, sizeof(parser->subscriptions));
+    parser->subscriptionCount = ctxt->subscriptionCount;
+    saxml_Reset(parser);
+}
+
+/* Claim the next record, with the lock held. Returns NULL once there are no more. */
+static tChunk *RecordClaim(tParallel *parallel)
+{
+    const char *start = &parallel->document[parallel->nextStart];
+    const char *end;
+    tChunk *chunk;
+    uint32_t n;
+
+    if(UINT32_MAX != parallel->chunkCount)
+        return NULL;
+    end = RecordEnd(start, parallel->document + parallel->length);
+    if(NULL == end)
+    {
+        parallel->chunkCount = parallel->nextChunk;
+        pthread_cond_broadcast(&parallel->chunkParsed);
+        return NULL;
+    }
+
+    n = (parallel->nextChunk)++;
+    chunk = &parallel->chunks[n % parallel->slotCount];
+    chunk->parser->documentCount = parallel->ctxt->documentCount + n;
+    chunk->stop = start; /* where the record starts, until it's parsed */
+    chunk->end = end;
+    parallel->nextStart = (size_t) (end - parallel->document);
+    return chunk;
+}
+
+static void RecordParse(tChunk *chunk)
+{
+    const char *start = chunk->stop;
+
+    chunk->result = parser_ParsePart(chunk->parser, start, chunk->end, &chunk->stop);
+    if(0 == chunk->result)
+        chunk->result = parser_EndParts(chunk->parser, &chunk->stop);
+}
+
+static void *RecordsWorker(void *argument)
+{
+    tParallel *parallel = (tParallel *) argument;
+    tChunk *chunk;
+
+    pthread_mutex_lock(&parallel->lock);
+    for(;;)
+    {
+        while(!parallel->bStop && UINT32_MAX == parallel->chunkCount
+              && parallel->nextChunk >= parallel->deliveredCount + parallel->slotCount)
+            pthread_cond_wait(&parallel->slotFree, &parallel->lock);
+        if(parallel->bStop || NULL == (chunk = RecordClaim(parallel)))
+            break;
+        pthread_mutex_unlock(&parallel->lock);
+
+        RecordParse(chunk);
+
+        pthread_mutex_lock(&parallel->lock);
+        chunk->bParsed = 1;
+        pthread_cond_broadcast(&parallel->chunkParsed);
+    }
+    pthread_mutex_unlock(&parallel->lock);
+
+    return NULL;
+}
+
+static int ParseRecords(tParserContext *ctxt, tParallel *parallel, const uint32_t threadCount,
+    const char **stop)
+{
+    pthread_t *threads;
+    uint32_t started, n;
+    tChunk *chunk;
+    int result = 0, bDone;
+
+    threads = (pthread_t *) malloc(threadCount * sizeof(pthread_t));
+    if(NULL == threads)
+        return RecordsSerial(ctxt, parallel->document, parallel->document + parallel->length,
+            stop);
+
+    for(started = 0; started < threadCount; ++started)
+    {
+        if(0 != pthread_create(&threads[started], NULL, RecordsWorker, parallel))
+            break;
+    }
+
+    *stop = parallel->document;
+    for(n = 0; 0 == result; ++n)
+    {
+        chunk = &parallel->chunks[n % parallel->slotCount];
+        pthread_mutex_lock(&parallel->lock);
+        if(0 == started)
+        {
+            /* No worker threads; parse everything here */
+            chunk = RecordClaim(parallel);
+            pthread_mutex_unlock(&parallel->lock);
+            if(NULL == chunk)
+                break;
+            RecordParse(chunk);
+        }
+        else
+        {
+            while(!chunk->bParsed && n < parallel->chunkCount)
+                pthread_cond_wait(&parallel->chunkParsed, &parallel->lock);
+            bDone = !chunk->bParsed;
+            pthread_mutex_unlock(&parallel->lock);
+            if(bDone)
+                break;
+        }
+
+        if(parallel->bOrdered)
+        {
+            STATS_HANDLER_BEGIN(ctxt)
+            ChunkReplay(ctxt, chunk, 0);
+            STATS_HANDLER_END(ctxt)
+        }
+        #if defined(SAXML_ENABLE_STATS)
+        parser_MergeStats(ctxt, chunk->parser);
+        #endif
+        result = chunk->result;
+        *stop = (0 == result) ? chunk->end : chunk->stop;
+
+        pthread_mutex_lock(&parallel->lock);
+        RecordsConfigure(chunk, parallel);
+        chunk->bParsed = 0;
+        ++(parallel->deliveredCount);
+        pthread_cond_broadcast(&parallel->slotFree);
+        pthread_mutex_unlock(&parallel->lock);
+    }
+
+    pthread_mutex_lock(&parallel->lock);
+    parallel->bStop = 1;
+    pthread_cond_broadcast(&parallel->slotFree);
+    pthread_mutex_unlock(&parallel->lock);
+    for(n = 0; n < started; ++n)
+        pthread_join(threads[n], NULL);
+    free(threads);
+
+    /* Only now that the workers are done with it */
+    if(NULL != ctxt->documents)
+        ctxt->documentCount += parallel->deliveredCount - ((0 == result) ? 0 : 1);
+
+    return result;
+}
+
+#endif /* SAXML_PARALLEL */
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+int saxml_ParseParallel(tSaxmlParser parser, const char *buffer, const size_t length,
+    const uint32_t threadCount, const size_t chunkSize, size_t *offset)
+{
+#if defined(SAXML_PARALLEL)
+    tParserContext *ctxt = (tParserContext *) parser;
+    tParallel parallel;
+    const char *stop = buffer + length, *endStop;
+    int result, end;
+
+    /* Neither the element stack nor the depth within a document can be inferred at a chunk
+       boundary */
+    if(threadCount < 2 || NULL != ctxt->stack || NULL != ctxt->documents)
+        return saxml_HandleBuffer(parser, buffer, length, offset);
+
+    parallel.document = buffer;
+    parallel.length = length;
+    parallel.chunkSize = (0 == chunkSize) ? PARALLEL_DEFAULT_CHUNK_SIZE : chunkSize;
+    if(length <= parallel.chunkSize)
+        return saxml_HandleBuffer(parser, buffer, length, offset);
+    parallel.chunkCount = (uint32_t) ((length + parallel.chunkSize - 1) / parallel.chunkSize);
+    parallel.slotCount = threadCount * PARALLEL_CHUNKS_PER_THREAD;
+    if(parallel.slotCount > parallel.chunkCount - 1)
+        parallel.slotCount = parallel.chunkCount - 1;
+    parallel.nextChunk = 1;
+    parallel.deliveredCount = 1;
+    parallel.bStop = 0;
+
+    if(0 != ParallelAllocate(&parallel, ctxt))
+    {
+        if(NULL != parallel.chunks)
+            ParallelFree(&parallel);
+        return saxml_HandleBuffer(parser, buffer, length, offset);
+    }
+    if(0 != pthread_mutex_init(&parallel.lock, NULL))
+    {
+        ParallelFree(&parallel);
+        return saxml_HandleBuffer(parser, buffer, length, offset);
+    }
+    pthread_cond_init(&parallel.slotFree, NULL);
+    pthread_cond_init(&parallel.chunkParsed, NULL);
+
+    /* The state taken over from each chunk may include a partial token */
+    if(parser_AcquireBuffer(ctxt))
+        result = ParseParallel(ctxt, &parallel, threadCount, &stop);
+    else
+    {
+        stop = buffer;
+        result = SAXML_ERROR_POOL;
+    }
+
+    /* A token tracked in place must be copied before the caller's buffer goes away */
+    end = parser_EndParts(ctxt, &endStop);
+    if(0 == result)
+    {
+        result = end;
+        stop = (0 == end) ? buffer + length : endStop;
+    }
+    if(NULL != offset)
+        *offset = (size_t) (stop - buffer);
+    parser_ReleaseBuffer(ctxt);
+
+    pthread_cond_destroy(&parallel.chunkParsed);
+    pthread_cond_destroy(&parallel.slotFree);
+    pthread_mutex_destroy(&parallel.lock);
+    ParallelFree(&parallel);
+
+    return result;
+#else
+    UNUSED(threadCount);
+    UNUSED(chunkSize);
+    return saxml_HandleBuffer(parser, buffer, length, offset);
+#endif
+}
+
+int saxml_ParseRecords(tSaxmlParser parser, const char *buffer, const size_t length,
+    const uint32_t threadCount, const int delivery, size_t *offset)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *stop = buffer;
+    int result;
+#if defined(SAXML_PARALLEL)
+    tParallel parallel;
+    uint32_t i;
+#endif
+
+    saxml_Reset(parser);
+
+#if defined(SAXML_PARALLEL)
+    if(threadCount < 2)
+        result = RecordsSerial(ctxt, buffer, buffer + length, &stop);
+    else
+    {
+        parallel.document = buffer;
+        parallel.length = length;
+        parallel.chunkSize = 0;
+        parallel.chunkCount = UINT32_MAX;
+        parallel.slotCount = threadCount * PARALLEL_CHUNKS_PER_THREAD;
+        parallel.nextChunk = 0;
+        parallel.deliveredCount = 0;
+        parallel.bStop = 0;
+        parallel.ctxt = ctxt;
+        parallel.bOrdered = (SAXML_RECORDS_UNORDERED != delivery);
+        parallel.nextStart = 0;
+
+        result = ParallelAllocate(&parallel, ctxt);
+        for(i = 0; 0 == result && i < parallel.slotCount; ++i)
+        {
+            if(NULL != ctxt->stack)
+            {
+                parallel.chunks[i].stack = (char *) malloc(ctxt->stackSize);
+                if(NULL == parallel.chunks[i].stack)
+                    result = -1;
+            }
+            if(0 == result)
+                RecordsConfigure(&parallel.chunks[i], &parallel);
+        }
+        if(0 == result && 0 != pthread_mutex_init(&parallel.lock, NULL))
+            result = -1;
+
+        if(0 != result)
+            result = RecordsSerial(ctxt, buffer, buffer + length, &stop);
+        else
+        {
+            pthread_cond_init(&parallel.slotFree, NULL);
+            pthread_cond_init(&parallel.chunkParsed, NULL);
+
+            result = ParseRecords(ctxt, &parallel, threadCount, &stop);
+
+            pthread_cond_destroy(&parallel.chunkParsed);
+            pthread_cond_destroy(&parallel.slotFree);
+            pthread_mutex_destroy(&parallel.lock);
+        }
+        if(NULL != parallel.chunks)
+            ParallelFree(&parallel);
+    }
+#else
+    UNUSED(threadCount);
+    UNUSED(delivery);
+    result = RecordsSerial(ctxt, buffer, buffer + length, &stop);
+#endif
+
+    if(NULL != offset)
+        *offset = (size_t) (stop - buffer);
+    return result;
+}
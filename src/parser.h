@@ -0,0 +1,232 @@
+/*! \copyright 2017-2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Parser context, shared between the parsing engine and the drivers built on it
+ */
+#ifndef SAXML_PARSER_H
+#define SAXML_PARSER_H
+
+#include "saxml/saxml.h"
+#include "scan.h"
+#include "encoding.h"
+#include "references.h"
+
+#define SAXML_MAX_SUBSCRIPTIONS 8
+#define SAXML_MIN_STRING_SIZE   2
+
+/* Parser states. Tag contents and attributes are split into separate states for leading
+ *  (nothing buffered yet, not quoted), unquoted and quoted text, so that none of the
+ *  transitions depend on anything other than the state and the character class. */
+typedef enum
+{
+    STATE_BEGIN,               /* wait for a tag start character */
+    STATE_START_TAG,           /* tag start character found; start tag, or end tag? */
+    STATE_TAG_NAME,
+    STATE_EMPTY_TAG,           /* tag name (or attribute placeholder) buffered, waiting for '>' */
+    STATE_CONTENTS_LEADING,
+    STATE_CONTENTS,
+    STATE_CONTENTS_QUOTED,
+    STATE_ATTRIBUTE_LEADING,
+    STATE_ATTRIBUTE,
+    STATE_ATTRIBUTE_QUOTED,
+    STATE_END_TAG,
+    STATE_ATTRIBUTES_LEADING,  /* whole attribute region, for the attributes handler */
+    STATE_ATTRIBUTES,
+    STATE_ATTRIBUTES_QUOTED,
+    STATE_REFERENCE,           /* within an entity or character reference in contents or an attribute */
+    STATE_SKIP_OWN_TAG,        /* skipping the rest of the start tag of the element being skipped */
+    STATE_SKIP_OWN_TAG_QUOTED,
+    STATE_SKIP_CONTENT,        /* skipping an element's contents, waiting for a tag start character */
+    STATE_SKIP_TAG_OPEN,       /* within skipped contents; start tag, or end tag? */
+    STATE_SKIP_TAG,
+    STATE_SKIP_TAG_QUOTED,
+    STATE_SKIP_EMPTY_TAG,
+    STATE_SKIP_END_TAG,
+    STATE_DECLARATION,         /* after '<!'; comment, CDATA section or other declaration? */
+    STATE_COMMENT_OPEN,        /* after '<!-' */
+    STATE_CDATA_OPEN,          /* after '<![', matching the rest of 'CDATA[' */
+    STATE_COMMENT,             /* within a comment, waiting for '-->' */
+    STATE_PI,                  /* within a processing instruction, waiting for '?>' */
+    STATE_CDATA,               /* within a CDATA section, waiting for ']]>' */
+    STATE_DOCTYPE,             /* within a document type (or other) declaration, waiting for '>' */
+    STATE_DOCTYPE_QUOTED,
+    STATE_DOCTYPE_SUBSET,      /* within a document type declaration's internal subset */
+    STATE_DOCTYPE_SUBSET_QUOTED,
+    STATE_COUNT
+} eParserState;
+
+typedef struct
+{
+    tSaxmlContext *user;
+    const tSaxmlSpanContext *spans; /* optional (pointer, length) handlers */
+    pfnAttributesHandler pfnAttributes; /* optional handler for whole attribute regions */
+    const tSaxmlIdContext *ids; /* optional handlers for names in the vocabulary */
+    const tSaxmlFragmentContext *fragments; /* optional handlers for strings of any length */
+    tSaxmlVocabulary vocabulary;
+
+    pfnScanHandler pfnScan; /* delimiter scanning kernel for runs of uninteresting characters */
+    const tScanSet * const *scanSets; /* delimiter set for each state */
+
+    /* Events to deliver (SAXML_EVENT_*); the caller's mask, and the effective set which also
+       excludes events without a registered handler. Tokens in the states in discardStates (a
+       bit for each state) aren't buffered, and only those in trackStates may be tracked in
+       place (see spanStart). */
+    uint64_t discardStates;
+    uint64_t trackStates;
+    uint8_t eventMask;
+    uint8_t events;
+    uint8_t whitespace; /* SAXML_WHITESPACE_* */
+
+    uint8_t state;
+
+    /* Flags, packed together since a server may hold a parser for each of very many streams;
+       each is described with the state it belongs to */
+    unsigned int bAllowTruncatedStrings : 1; /* true if truncated parsing results are acceptable */
+    unsigned int bTrackSpans : 1;
+    unsigned int bFragmented : 1;
+    unsigned int bDiscard : 1;
+    unsigned int bSkipRequested : 1;
+    unsigned int bDecodeReferences : 1;
+    unsigned int bValidateUtf8 : 1;
+    unsigned int bTokenReady : 1;
+    unsigned int bOwnsStorage : 1; /* true if allocated by saxml_Initialize */
+
+    /* Token buffer. A pooled parser (see saxml_InitializePooled) holds one of its pool's
+       buffers only while a token is buffered, and buffer is NULL otherwise. */
+    char *buffer;
+    tSaxmlPool pool;
+    uint32_t maxStringSize;
+    uint32_t length;
+
+    /* When span handlers are registered, a token which is contiguous in the caller's input
+       is tracked here rather than being copied into buffer (bTrackSpans is set while parsing
+       such input), if its event is delivered from there. At most one of length and spanLength
+       is nonzero. */
+    const char *spanStart;
+    size_t spanLength;
+
+    /* bFragmented is set once part of the token has been delivered to a fragment handler, in
+       which case the rest of it must be delivered to the same handler even if it's empty */
+
+    /* Names of the open elements, each NUL-terminated, in caller-provided storage */
+    char *stack;
+    size_t stackSize;
+    size_t stackUsed;
+    uint32_t depth;
+
+    /* Path patterns; while subscribed, only events within the subtree of the element at
+       matchDepth (the outermost open element which matches a pattern) are delivered, and
+       bDiscard is true when there's no such element */
+    const char *subscriptions[SAXML_MAX_SUBSCRIPTIONS];
+    uint32_t subscriptionCount;
+    uint32_t matchDepth;
+
+    /* Skipping the rest of the innermost element (bSkipRequested); skipDepth counts it and the
+       elements nested within it which are open */
+    uint32_t skipDepth;
+
+    /* A reference being decoded (with bDecodeReferences), from the '&', and the state to return
+       to once it's done */
+    uint8_t referenceState;
+    uint8_t referenceLength;
+    char reference[REFERENCE_MAX_LENGTH];
+
+    /* Markup other than elements (comments, processing instructions, CDATA sections and
+       declarations); the state to return to once it ends, and how many characters of its
+       opening keyword or terminator have been matched, since either may be split across
+       buffers */
+    uint8_t markupState;
+    uint8_t markupMatched;
+
+    /* UTF-8 validation (bValidateUtf8); input is validated in blocks ahead of the engine, and
+       utf8Validated is the end of the block when the engine stops early within one (for pull
+       parsing). UTF-16 input is transcoded to UTF-8 instead. */
+    pfnAsciiHandler pfnAscii;
+    const char *utf8Validated;
+    tUtf8State utf8;
+    tUtf16State utf16;
+
+    /* Framing of concatenated documents; the depth of elements within the current document,
+       and the number of documents which have ended */
+    const tSaxmlDocumentContext *documents;
+    uint32_t documentDepth;
+    uint32_t documentCount;
+
+    /* Pull parsing; the handlers store each event in token, and parsing stops once one has
+       been stored (bTokenReady). Input is consumed from the buffer provided to saxml_Feed. */
+    tSaxmlContext pullContext;
+    tSaxmlToken *token;
+    uint8_t lastTokenType;
+    const char *inputStart;
+    const char *input;
+    const char *inputEnd;
+
+    #if defined(SAXML_ENABLE_STATS)
+    tSaxmlStats stats;
+    int32_t statsDepth; /* relative to the start of parsing, for ParseParallel's chunks */
+    #endif
+    #if defined(SAXML_ENABLE_STATS_TIMING)
+    uint64_t statsHandlerStart;
+    #endif
+} tParserContext;
+
+/* Statistics (see saxml_GetStats); these compile to nothing unless saxml is built with
+ *  SAXML_STATS */
+#if defined(SAXML_ENABLE_STATS)
+   #define STATS_ADD(ctxt, counter, n) (ctxt)->stats.counter += (n);
+   #define STATS_MAX(ctxt, counter, value)                                              \
+       if((value) > (ctxt)->stats.counter)                                              \
+           (ctxt)->stats.counter = (value);
+#else
+   #define STATS_ADD(ctxt, counter, n)
+   #define STATS_MAX(ctxt, counter, value)
+#endif
+
+/* Time within handlers, measured with SAXML_STATS_CLOCK (nanoseconds by default) */
+#if defined(SAXML_ENABLE_STATS_TIMING)
+   #if !defined(SAXML_STATS_CLOCK)
+      #define SAXML_STATS_CLOCK() parser_Clock()
+   #endif
+   #define STATS_HANDLER_BEGIN(ctxt) (ctxt)->statsHandlerStart = SAXML_STATS_CLOCK();
+   #define STATS_HANDLER_END(ctxt)                                                      \
+       (ctxt)->stats.handlerTicks += SAXML_STATS_CLOCK() - (ctxt)->statsHandlerStart;
+#else
+   #define STATS_HANDLER_BEGIN(ctxt)
+   #define STATS_HANDLER_END(ctxt)
+#endif
+
+/* Run the parsing engine over one part of a larger buffer, all of which remains valid until
+ *  parsing of it is finished. A token tracked in place at the end of the part isn't copied
+ *  into the parser's buffer, so that it can continue into the following part. Returns 0 on
+ *  success or one of SAXML_ERROR_*, in which case *stop is set to the character which caused
+ *  the error. */
+int parser_ParsePart(tParserContext *ctxt, const char *position, const char *end,
+    const char **stop);
+
+/* Finish parsing a buffer with parser_ParsePart, copying any token still tracked in place into
+ *  the parser's buffer. Returns 0 on success, or SAXML_ERROR_BUFFER_OVERFLOW if it didn't fit,
+ *  in which case *stop is set to the first character which didn't fit. */
+int parser_EndParts(tParserContext *ctxt, const char **stop);
+
+/* Make sure a pooled parser has a buffer, borrowing one from its pool if necessary. Returns
+ *  nonzero on success, or 0 if none is free. */
+int parser_AcquireBuffer(tParserContext *ctxt);
+
+/* Return a pooled parser's buffer to its pool, unless a token is buffered in it */
+void parser_ReleaseBuffer(tParserContext *ctxt);
+
+/* Start skipping the innermost element, if saxml_SkipCurrentElement was called while parsing
+ *  was stopped, just after the event which would otherwise have been followed by the request */
+void parser_ApplySkipRequest(tParserContext *ctxt);
+
+#if defined(SAXML_ENABLE_STATS)
+/* Add the statistics of a parser which parsed part of the same input, from the state ctxt is
+ *  in now */
+void parser_MergeStats(tParserContext *ctxt, const tParserContext *part);
+#endif
+
+#if defined(SAXML_ENABLE_STATS_TIMING)
+/* Monotonic clock, in nanoseconds */
+uint64_t parser_Clock(void);
+#endif
+
+#endif /* SAXML_PARSER_H */
@@ -0,0 +1,193 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Pools of string buffers, shared by parsers which borrow one only while it's needed
+ */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include "parser.h"
+#include "pool.h"
+#include <stddef.h> /* for NULL */
+#ifndef SAXML_NO_MALLOC
+#include <stdlib.h> /* malloc and free */
+#endif
+
+/* Free buffers are marked by a bit each in a bitmap, so that borrowing is a search for a set
+ *  bit and an atomic compare-and-swap to clear it, and returning is an atomic OR. Unlike a
+ *  lock-free list, a bitmap isn't subject to the ABA problem, and needs no storage within the
+ *  buffers themselves. Without threads (or atomic builtins), plain memory accesses suffice. */
+#if defined(__GNUC__) && !defined(SAXML_NO_THREADS)
+   #define POOL_LOAD(word) __atomic_load_n(word, __ATOMIC_RELAXED)
+   #define POOL_CLEAR(word, expected, desired)                                          \
+       __atomic_compare_exchange_n(word, &(expected), desired, 0, __ATOMIC_ACQUIRE,     \
+           __ATOMIC_RELAXED)
+   #define POOL_SET(word, bits) (void) __atomic_fetch_or(word, bits, __ATOMIC_RELEASE)
+#else
+   #define POOL_LOAD(word) (*(word))
+   #define POOL_CLEAR(word, expected, desired) (*(word) = (desired), 1)
+   #define POOL_SET(word, bits) (*(word) |= (bits))
+#endif
+
+#define POOL_WORD_BITS 32
+
+typedef struct
+{
+    uint32_t bufferCount;
+    uint32_t bufferSize;
+    uint32_t wordCount;
+    uint32_t *freeBits;        /* a bit for each buffer, set if it's free */
+    char *buffers;
+    int bOwnsStorage;          /* true if allocated by saxml_CreatePool */
+} tPool;
+
+typedef union
+{
+    void *p;
+    size_t s;
+    long l;
+    double d;
+} tStorageAlignment;
+#define STORAGE_ALIGNMENT sizeof(tStorageAlignment)
+
+static uint32_t PoolWordCount(const uint32_t bufferCount)
+{
+    return (bufferCount + POOL_WORD_BITS - 1) / POOL_WORD_BITS;
+}
+
+/* Index of the lowest set bit of a nonzero word */
+static uint32_t PoolLowestBit(uint32_t word)
+{
+    uint32_t index = 0;
+
+    if(0 == (word & 0xFFFF)) { word >>= 16; index += 16; }
+    if(0 == (word & 0xFF)) { word >>= 8; index += 8; }
+    if(0 == (word & 0xF)) { word >>= 4; index += 4; }
+    if(0 == (word & 0x3)) { word >>= 2; index += 2; }
+    if(0 == (word & 0x1)) { index += 1; }
+    return index;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Internal Functions
+ */
+
+uint32_t pool_BufferSize(const tSaxmlPool pool)
+{
+    return ((const tPool *) pool)->bufferSize;
+}
+
+char *pool_Borrow(tSaxmlPool pool)
+{
+    tPool *p = (tPool *) pool;
+    uint32_t i, word, bit;
+
+    for(i = 0; i < p->wordCount; ++i)
+    {
+        word = POOL_LOAD(&p->freeBits[i]);
+        while(0 != word)
+        {
+            bit = PoolLowestBit(word);
+            if(POOL_CLEAR(&p->freeBits[i], word, word & ~((uint32_t) 1 << bit)))
+                return p->buffers + (size_t) (i * POOL_WORD_BITS + bit) * p->bufferSize;
+            /* word now holds the bitmap's current value */
+        }
+    }
+    return NULL;
+}
+
+void pool_Return(tSaxmlPool pool, char *buffer)
+{
+    tPool *p = (tPool *) pool;
+    uint32_t index = (uint32_t) ((size_t) (buffer - p->buffers) / p->bufferSize);
+
+    POOL_SET(&p->freeBits[index / POOL_WORD_BITS], (uint32_t) 1 << (index % POOL_WORD_BITS));
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+size_t saxml_PoolStorageSize(const uint32_t bufferCount, const uint32_t maxStringSize)
+{
+    return (STORAGE_ALIGNMENT - 1) + sizeof(tPool)
+        + PoolWordCount(bufferCount) * sizeof(uint32_t) + (size_t) bufferCount * maxStringSize;
+}
+
+tSaxmlPool saxml_CreatePoolInPlace(void *storage, const size_t storageSize,
+    const uint32_t bufferCount, const uint32_t maxStringSize)
+{
+    tPool *p;
+    size_t padding;
+    uint32_t i;
+
+    if(maxStringSize < SAXML_MIN_STRING_SIZE || 0 == bufferCount || NULL == storage)
+        return NULL;
+    if(storageSize < saxml_PoolStorageSize(bufferCount, maxStringSize))
+        return NULL;
+
+    padding = (STORAGE_ALIGNMENT - ((size_t) storage % STORAGE_ALIGNMENT)) % STORAGE_ALIGNMENT;
+    p = (tPool *) ((char *) storage + padding);
+    p->bufferCount = bufferCount;
+    p->bufferSize = maxStringSize;
+    p->wordCount = PoolWordCount(bufferCount);
+    p->freeBits = (uint32_t *) (p + 1);
+    p->buffers = (char *) (p->freeBits + p->wordCount);
+    p->bOwnsStorage = 0;
+
+    for(i = 0; i < p->wordCount; ++i)
+        p->freeBits[i] = 0xFFFFFFFFu;
+    if(0 != bufferCount % POOL_WORD_BITS)
+        p->freeBits[p->wordCount - 1] = ((uint32_t) 1 << (bufferCount % POOL_WORD_BITS)) - 1;
+
+    return (tSaxmlPool) p;
+}
+
+tSaxmlPool saxml_CreatePool(const uint32_t bufferCount, const uint32_t maxStringSize)
+{
+    #ifdef SAXML_NO_MALLOC
+    UNUSED(bufferCount);
+    UNUSED(maxStringSize);
+    return NULL; /* saxml_CreatePoolInPlace must be used */
+    #else
+    tPool *p;
+    void *storage;
+    size_t storageSize = saxml_PoolStorageSize(bufferCount, maxStringSize);
+
+    storage = malloc(storageSize);
+    if(NULL == storage)
+        return NULL;
+
+    p = (tPool *) saxml_CreatePoolInPlace(storage, storageSize, bufferCount, maxStringSize);
+    if(NULL == p)
+    {
+        free(storage);
+        return NULL;
+    }
+    p->bOwnsStorage = 1;
+
+    return (tSaxmlPool) p;
+    #endif
+}
+
+void saxml_DestroyPool(tSaxmlPool pool)
+{
+    #ifndef SAXML_NO_MALLOC
+    tPool *p = (tPool *) pool;
+    if(NULL != p && p->bOwnsStorage)
+        free(p);
+    #else
+    UNUSED(pool);
+    #endif
+}
+
+uint32_t saxml_PoolAvailable(const tSaxmlPool pool)
+{
+    const tPool *p = (const tPool *) pool;
+    uint32_t i, word, count = 0;
+
+    for(i = 0; i < p->wordCount; ++i)
+    {
+        for(word = POOL_LOAD(&p->freeBits[i]); 0 != word; word &= word - 1)
+            ++count;
+    }
+    return count;
+}
@@ -0,0 +1,19 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Pools of string buffers, shared by parsers which borrow one only while it's needed
+ */
+#ifndef SAXML_POOL_H
+#define SAXML_POOL_H
+
+#include "saxml/saxml.h"
+
+/* Size of each of a pool's buffers */
+uint32_t pool_BufferSize(const tSaxmlPool pool);
+
+/* Borrow a buffer from a pool. Returns NULL if none is free. */
+char *pool_Borrow(tSaxmlPool pool);
+
+/* Return a buffer obtained from pool_Borrow */
+void pool_Return(tSaxmlPool pool, char *buffer);
+
+#endif /* SAXML_POOL_H */
@@ -0,0 +1,145 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Pull parsing, where the caller requests each token in turn
+ */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include "parser.h"
+#include <stddef.h> /* for NULL */
+#ifndef SAXML_NO_MALLOC
+   #include <stdlib.h> /* malloc, free */
+#endif
+
+/* The parsing engine is the same one used by every other entry point. Each event is stored
+ *  in the caller's token by the span handlers below, and the engine stops as soon as one has
+ *  been stored, leaving the rest of the fed buffer for the next call. Tokens tracked in place
+ *  are only copied into the parser's buffer once the fed buffer is consumed. */
+
+static void PullToken(tParserContext *ctxt, int type, const char *data, size_t length)
+{
+    ctxt->token->type = type;
+    ctxt->token->data = data;
+    ctxt->token->length = length;
+    ctxt->bTokenReady = 1;
+}
+
+static void PullTag(void *cookie, const char *data, size_t length)
+    { PullToken((tParserContext *) cookie, SAXML_TOKEN_TAG, data, length); }
+static void PullTagEnd(void *cookie, const char *data, size_t length)
+    { PullToken((tParserContext *) cookie, SAXML_TOKEN_TAG_END, data, length); }
+static void PullContent(void *cookie, const char *data, size_t length)
+    { PullToken((tParserContext *) cookie, SAXML_TOKEN_CONTENT, data, length); }
+static void PullAttribute(void *cookie, const char *data, size_t length)
+    { PullToken((tParserContext *) cookie, SAXML_TOKEN_ATTRIBUTE, data, length); }
+
+static const tSaxmlSpanContext g_pullSpans = { PullTag, PullTagEnd, PullContent, PullAttribute };
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+tSaxmlParser saxml_InitializePullInPlace(void *storage, const size_t storageSize,
+    const uint32_t maxStringSize)
+{
+    static tSaxmlContext placeholder; /* replaced by the parser's own context */
+    tParserContext *ctxt;
+
+    ctxt = (tParserContext *) saxml_InitializeInPlace(storage, storageSize, &placeholder,
+        maxStringSize);
+    if(NULL == ctxt)
+        return NULL;
+
+    ctxt->pullContext.cookie = ctxt;
+    ctxt->pullContext.tagHandler = NULL;
+    ctxt->pullContext.tagEndHandler = NULL;
+    ctxt->pullContext.parameterHandler = NULL;
+    ctxt->pullContext.contentHandler = NULL;
+    ctxt->pullContext.attributeHandler = NULL;
+    ctxt->user = &ctxt->pullContext;
+    ctxt->spans = &g_pullSpans;
+
+    return (tSaxmlParser) ctxt;
+}
+
+tSaxmlParser saxml_InitializePull(const uint32_t maxStringSize)
+{
+    #ifdef SAXML_NO_MALLOC
+    UNUSED(maxStringSize);
+    return NULL; /* saxml_InitializePullInPlace must be used */
+    #else
+    tParserContext *ctxt;
+    void *storage;
+    size_t storageSize = saxml_StorageSize(maxStringSize);
+
+    storage = malloc(storageSize);
+    if(NULL == storage)
+        return NULL;
+
+    ctxt = (tParserContext *) saxml_InitializePullInPlace(storage, storageSize, maxStringSize);
+    if(NULL == ctxt)
+    {
+        free(storage);
+        return NULL;
+    }
+    ctxt->bOwnsStorage = 1;
+
+    return (tSaxmlParser) ctxt;
+    #endif
+}
+
+void saxml_Feed(tSaxmlParser parser, const char *buffer, const size_t length)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->inputStart = buffer;
+    ctxt->input = buffer;
+    ctxt->inputEnd = buffer + length;
+    ctxt->utf8Validated = NULL;
+}
+
+int saxml_NextToken(tSaxmlParser parser, tSaxmlToken *token)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *stop = ctxt->input;
+    int result = 0;
+
+    token->type = SAXML_TOKEN_NONE;
+    token->data = NULL;
+    token->length = 0;
+    ctxt->token = token;
+    ctxt->bTokenReady = 0;
+
+    /* A skip requested after an end tag has no effect, as it would from its handler */
+    if(ctxt->bSkipRequested)
+    {
+        if(SAXML_TOKEN_TAG_END == ctxt->lastTokenType)
+            ctxt->bSkipRequested = 0;
+        else
+            parser_ApplySkipRequest(ctxt);
+    }
+    ctxt->lastTokenType = SAXML_TOKEN_NONE;
+
+    if(ctxt->input < ctxt->inputEnd)
+    {
+        result = parser_ParsePart(ctxt, ctxt->input, ctxt->inputEnd, &stop);
+        ctxt->input = stop;
+        if(0 != result)
+            return result;
+        if(ctxt->bTokenReady)
+        {
+            ctxt->lastTokenType = token->type;
+            return token->type;
+        }
+    }
+
+    /* The fed buffer is consumed; anything still tracked within it must be kept */
+    result = parser_EndParts(ctxt, &stop);
+    if(0 != result)
+        ctxt->input = stop;
+    return result;
+}
+
+size_t saxml_GetFeedOffset(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    return (size_t) (ctxt->input - ctxt->inputStart);
+}
@@ -0,0 +1,136 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Entity and character reference decoding
+ */
+#include "saxml/saxml.h"
+#include "references.h"
+#include <string.h> /* memcmp, memcpy */
+
+typedef struct
+{
+    const char *name;
+    size_t length;
+    char character;
+} tEntity;
+
+/* The entities predefined by XML; no others can be used without a DTD */
+static const tEntity g_entities[] =
+{
+    { "amp", 3, '&' },
+    { "lt", 2, '<' },
+    { "gt", 2, '>' },
+    { "quot", 4, '"' },
+    { "apos", 4, '\'' }
+};
+#define ENTITY_COUNT (sizeof(g_entities) / sizeof(g_entities[0]))
+
+/* Encode a code point as UTF-8. Returns the number of characters written, or 0 if the code
+ *  point isn't a character which may be referenced. */
+static size_t EncodeUtf8(const uint32_t codePoint, char *decoded)
+{
+    if(0 == codePoint || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+        return 0;
+    if(codePoint < 0x80)
+    {
+        decoded[0] = (char) codePoint;
+        return 1;
+    }
+    if(codePoint < 0x800)
+    {
+        decoded[0] = (char) (0xC0 | (codePoint >> 6));
+        decoded[1] = (char) (0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if(codePoint < 0x10000)
+    {
+        decoded[0] = (char) (0xE0 | (codePoint >> 12));
+        decoded[1] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        decoded[2] = (char) (0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    decoded[0] = (char) (0xF0 | (codePoint >> 18));
+    decoded[1] = (char) (0x80 | ((codePoint >> 12) & 0x3F));
+    decoded[2] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+    decoded[3] = (char) (0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+size_t reference_Decode(const char *name, const size_t length, char *decoded)
+{
+    uint32_t codePoint = 0;
+    uint32_t digit;
+    size_t i;
+    int bHex;
+
+    if(length < 2 || '#' != name[0])
+    {
+        for(i = 0; i < ENTITY_COUNT; ++i)
+        {
+            if(g_entities[i].length == length && memcmp(g_entities[i].name, name, length) == 0)
+            {
+                decoded[0] = g_entities[i].character;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    /* Character reference: "#" followed by decimal digits, or "#x" followed by hex digits */
+    bHex = ('x' == name[1]);
+    i = (bHex) ? 2 : 1;
+    if(i >= length)
+        return 0;
+    for(; i < length; ++i)
+    {
+        if(name[i] >= '0' && name[i] <= '9')
+            digit = (uint32_t) (name[i] - '0');
+        else if(bHex && name[i] >= 'a' && name[i] <= 'f')
+            digit = (uint32_t) (name[i] - 'a' + 10);
+        else if(bHex && name[i] >= 'A' && name[i] <= 'F')
+            digit = (uint32_t) (name[i] - 'A' + 10);
+        else
+            return 0;
+        codePoint = codePoint * ((bHex) ? 16 : 10) + digit;
+        if(codePoint > 0x10FFFF)
+            return 0;
+    }
+
+    return EncodeUtf8(codePoint, decoded);
+}
+
+size_t saxml_DecodeReferences(char *destination, const char *source, const size_t length)
+{
+    char decoded[REFERENCE_MAX_DECODED];
+    size_t in = 0, out = 0;
+    size_t start, count, decodedLength;
+
+    while(in < length)
+    {
+        if('&' != source[in])
+        {
+            destination[out++] = source[in++];
+            continue;
+        }
+
+        start = in + 1;
+        for(count = 0; start + count < length && count < REFERENCE_MAX_LENGTH - 1 &&
+            REFERENCE_IS_NAME(source[start + count]); ++count)
+            ;
+        if(start + count < length && ';' == source[start + count])
+        {
+            decodedLength = reference_Decode(&source[start], count, decoded);
+            if(decodedLength > 0)
+            {
+                /* A reference is never shorter than the character it decodes to, so
+                   decoding in place never overwrites source characters not yet read */
+                memcpy(&destination[out], decoded, decodedLength);
+                out += decodedLength;
+                in = start + count + 1;
+                continue;
+            }
+        }
+        destination[out++] = source[in++];
+    }
+
+    return out;
+}
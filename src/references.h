@@ -0,0 +1,29 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Entity and character reference decoding
+ */
+#ifndef SAXML_REFERENCES_H
+#define SAXML_REFERENCES_H
+
+#include <stddef.h>
+
+/* Longest reference, including the leading '&' but not the terminating ';', which is
+ *  considered for decoding. Anything longer is passed through unchanged. */
+#define REFERENCE_MAX_LENGTH 16
+
+/* Longest UTF-8 encoding of a referenced character */
+#define REFERENCE_MAX_DECODED 4
+
+/* Characters which may appear in a reference name, between the '&' and the ';' */
+#define REFERENCE_IS_NAME(c)          \
+    (((c) >= 'a' && (c) <= 'z') ||    \
+     ((c) >= 'A' && (c) <= 'Z') ||    \
+     ((c) >= '0' && (c) <= '9') ||    \
+     '#' == (c))
+
+/* Decode the reference with the given name (the characters between '&' and ';') to UTF-8.
+ *  Returns the number of characters written to decoded, or 0 if the name isn't a predefined
+ *  entity or a valid character reference. */
+size_t reference_Decode(const char *name, const size_t length, char *decoded);
+
+#endif /* SAXML_REFERENCES_H */
@@ -4,466 +4,2102 @@
  */
 #include "saxml/saxml.h"
 #include "helpers.h"
+#include "parser.h"
+#include "pool.h"
 #include <stddef.h> /* for NULL */
+#include <string.h> /* memchr, memcpy */
 #ifndef SAXML_NO_MALLOC
 #include <stdlib.h> /* malloc and free */
 #endif
-
-#if defined(SAXML_NO_MALLOC) && !defined(SAXML_MAX_STRING_LENGTH)
-#error saxml: Must define SAXML_MAX_STRING_LENGTH
+#if defined(SAXML_ENABLE_STATS_TIMING)
+#include <time.h> /* clock_gettime */
 #endif
 
-#define SAXML_MIN_STRING_SIZE   2
-
-typedef int (*pfnParserStateHandler)(void *context, const char character);
+/* Dispatch parser actions with computed goto where the compiler supports it, otherwise with
+ *  a switch statement */
+#if defined(__GNUC__) && !defined(SAXML_NO_COMPUTED_GOTO)
+   #define SAXML_COMPUTED_GOTO
+#endif
 
-typedef struct
+/* Character classes */
+typedef enum
 {
-    tSaxmlContext *user;
-
-    pfnParserStateHandler pfnHandler;
-
-    int bInitialize; /* true for first call into a state */
-    int bInQuotedText; /* true if we're within quotes */
-    int bAllowTruncatedStrings; /* true if truncated parsing results are acceptable */
-
-    char *buffer;
-    uint32_t maxStringSize;
-    uint32_t length;
-} tParserContext;
-#ifdef SAXML_NO_MALLOC
-static tParserContext g_saxmlParserContext;
-static char g_saxmlBuffer[SAXML_MAX_STRING_LENGTH];
-#endif
+    CLASS_OTHER,
+    CLASS_SPACE,
+    CLASS_TAG_START,  /* '<' */
+    CLASS_TAG_END,    /* '>' */
+    CLASS_SLASH,
+    CLASS_QUOTE,
+    CLASS_AMPERSAND,
+    CLASS_MARKUP,     /* '!' or '?', which follow '<' for markup other than elements */
+    CLASS_COUNT
+} eCharacterClass;
+
+/* Actions taken on a transition */
+typedef enum
+{
+    ACTION_NONE,               /* stay in the current state */
+    ACTION_SEEK,               /* skip to the next tag start character */
+    ACTION_ERROR,              /* syntax error */
+    ACTION_ENTER,              /* change state */
+    ACTION_TAG_NAME,           /* first character of a tag name */
+    ACTION_ADD,                /* add the character (and any following run) to the token */
+    ACTION_ADD_UNCHECKED,      /* add the character to the token, ignoring overflow */
+    ACTION_EMIT_TAG,
+    ACTION_EMIT_TAG_END,
+    ACTION_EMIT_CONTENT,
+    ACTION_EMIT_ATTRIBUTE,
+    ACTION_EMPTY_TAG,          /* emit the attribute, if any, and store the tag end placeholder */
+    ACTION_EMIT_ATTRIBUTES,
+    ACTION_EMPTY_TAG_ATTRIBUTES, /* as ACTION_EMPTY_TAG, for the whole attribute region */
+    ACTION_REFERENCE,          /* start of a reference if decoding, otherwise as ACTION_ADD */
+    ACTION_REFERENCE_NAME,     /* accumulate, and at the terminating ';' decode, a reference */
+    ACTION_SKIP_RUN,           /* skip the character, and any following run */
+    ACTION_SKIP_OPEN,          /* end of a nested start tag within a skipped element */
+    ACTION_SKIP_CLOSE,         /* end of a nested end tag within a skipped element */
+    ACTION_SKIP_END_TAG,       /* start of an end tag, which may end the skipped element */
+    ACTION_SKIP_EMPTY_TAG,     /* the skipped element turned out to be an empty tag */
+    ACTION_MARKUP,             /* start of markup other than an element */
+    ACTION_MARKUP_OPEN,        /* match the keyword which identifies the kind of declaration */
+    ACTION_MARKUP_TEXT,        /* find the terminator of a comment, PI or CDATA section */
+    ACTION_MARKUP_RUN,         /* skip a run within a declaration */
+    ACTION_MARKUP_END,         /* return to the state the markup interrupted */
+    ACTION_COUNT
+} eParserAction;
+
+/* Caller-provided storage may have any alignment; the parser context is placed at the first
+ *  address within it which is suitably aligned for any of these types */
+typedef union
+{
+    void *p;
+    size_t s;
+    long l;
+    double d;
+} tStorageAlignment;
+#define STORAGE_ALIGNMENT sizeof(tStorageAlignment)
+
+#define OT CLASS_OTHER
+#define SP CLASS_SPACE
+#define LT CLASS_TAG_START
+#define GT CLASS_TAG_END
+#define SL CLASS_SLASH
+#define QU CLASS_QUOTE
+#define AM CLASS_AMPERSAND
+#define MK CLASS_MARKUP
+static const uint8_t g_characterClass[256] =
+{
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, SP, SP, OT, OT, SP, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    SP, MK, QU, OT, OT, OT, AM, OT, OT, OT, OT, OT, OT, OT, OT, SL,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, LT, OT, GT, MK,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT,
+    OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT, OT
+};
+#undef OT
+#undef SP
+#undef LT
+#undef GT
+#undef SL
+#undef QU
+#undef AM
+#undef MK
+
+/* Each transition is an action in the upper byte, and the next state in the lower byte */
+#define T(action, state) (uint16_t) (((action) << 8) | (state))
+#define TRANSITION_ACTION(t) ((t) >> 8)
+#define TRANSITION_STATE(t) ((t) & 0xff)
+static const uint16_t g_transitions[STATE_COUNT][CLASS_COUNT] =
+{
+    /* STATE_BEGIN */
+    { T(ACTION_SEEK, STATE_BEGIN), T(ACTION_SEEK, STATE_BEGIN),
+      T(ACTION_ENTER, STATE_START_TAG), T(ACTION_SEEK, STATE_BEGIN),
+      T(ACTION_SEEK, STATE_BEGIN), T(ACTION_SEEK, STATE_BEGIN),
+      T(ACTION_SEEK, STATE_BEGIN), T(ACTION_SEEK, STATE_BEGIN) },
+    /* STATE_START_TAG */
+    { T(ACTION_TAG_NAME, STATE_TAG_NAME), T(ACTION_NONE, STATE_START_TAG),
+      T(ACTION_ERROR, STATE_START_TAG), T(ACTION_ERROR, STATE_START_TAG),
+      T(ACTION_ENTER, STATE_END_TAG), T(ACTION_TAG_NAME, STATE_TAG_NAME),
+      T(ACTION_TAG_NAME, STATE_TAG_NAME), T(ACTION_MARKUP, STATE_CONTENTS_LEADING) },
+    /* STATE_TAG_NAME */
+    { T(ACTION_ADD, STATE_TAG_NAME), T(ACTION_EMIT_TAG, STATE_ATTRIBUTE_LEADING),
+      T(ACTION_ADD, STATE_TAG_NAME), T(ACTION_EMIT_TAG, STATE_CONTENTS_LEADING),
+      T(ACTION_EMIT_TAG, STATE_EMPTY_TAG), T(ACTION_ADD, STATE_TAG_NAME),
+      T(ACTION_ADD, STATE_TAG_NAME), T(ACTION_ADD, STATE_TAG_NAME) },
+    /* STATE_EMPTY_TAG */
+    { T(ACTION_NONE, STATE_EMPTY_TAG), T(ACTION_NONE, STATE_EMPTY_TAG),
+      T(ACTION_NONE, STATE_EMPTY_TAG), T(ACTION_EMIT_TAG_END, STATE_CONTENTS_LEADING),
+      T(ACTION_NONE, STATE_EMPTY_TAG), T(ACTION_NONE, STATE_EMPTY_TAG),
+      T(ACTION_NONE, STATE_EMPTY_TAG), T(ACTION_NONE, STATE_EMPTY_TAG) },
+    /* STATE_CONTENTS_LEADING */
+    { T(ACTION_ADD, STATE_CONTENTS), T(ACTION_NONE, STATE_CONTENTS_LEADING),
+      T(ACTION_ENTER, STATE_START_TAG), T(ACTION_ADD, STATE_CONTENTS),
+      T(ACTION_ADD, STATE_CONTENTS), T(ACTION_ADD, STATE_CONTENTS_QUOTED),
+      T(ACTION_REFERENCE, STATE_CONTENTS), T(ACTION_ADD, STATE_CONTENTS) },
+    /* STATE_CONTENTS */
+    { T(ACTION_ADD, STATE_CONTENTS), T(ACTION_ADD, STATE_CONTENTS),
+      T(ACTION_EMIT_CONTENT, STATE_START_TAG), T(ACTION_ADD, STATE_CONTENTS),
+      T(ACTION_ADD, STATE_CONTENTS), T(ACTION_ADD, STATE_CONTENTS_QUOTED),
+      T(ACTION_REFERENCE, STATE_CONTENTS), T(ACTION_ADD, STATE_CONTENTS) },
+    /* STATE_CONTENTS_QUOTED */
+    { T(ACTION_ADD, STATE_CONTENTS_QUOTED), T(ACTION_ADD, STATE_CONTENTS_QUOTED),
+      T(ACTION_ADD, STATE_CONTENTS_QUOTED), T(ACTION_ADD, STATE_CONTENTS_QUOTED),
+      T(ACTION_ADD, STATE_CONTENTS_QUOTED), T(ACTION_ADD, STATE_CONTENTS),
+      T(ACTION_REFERENCE, STATE_CONTENTS_QUOTED), T(ACTION_ADD, STATE_CONTENTS_QUOTED) },
+    /* STATE_ATTRIBUTE_LEADING */
+    { T(ACTION_ADD, STATE_ATTRIBUTE), T(ACTION_NONE, STATE_ATTRIBUTE_LEADING),
+      T(ACTION_ADD, STATE_ATTRIBUTE), T(ACTION_ENTER, STATE_CONTENTS_LEADING),
+      T(ACTION_EMPTY_TAG, STATE_EMPTY_TAG), T(ACTION_ADD_UNCHECKED, STATE_ATTRIBUTE_QUOTED),
+      T(ACTION_REFERENCE, STATE_ATTRIBUTE), T(ACTION_ADD, STATE_ATTRIBUTE) },
+    /* STATE_ATTRIBUTE */
+    { T(ACTION_ADD, STATE_ATTRIBUTE), T(ACTION_EMIT_ATTRIBUTE, STATE_ATTRIBUTE_LEADING),
+      T(ACTION_ADD, STATE_ATTRIBUTE), T(ACTION_EMIT_ATTRIBUTE, STATE_CONTENTS_LEADING),
+      T(ACTION_EMPTY_TAG, STATE_EMPTY_TAG), T(ACTION_ADD_UNCHECKED, STATE_ATTRIBUTE_QUOTED),
+      T(ACTION_REFERENCE, STATE_ATTRIBUTE), T(ACTION_ADD, STATE_ATTRIBUTE) },
+    /* STATE_ATTRIBUTE_QUOTED */
+    { T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED), T(ACTION_ADD_UNCHECKED, STATE_ATTRIBUTE),
+      T(ACTION_REFERENCE, STATE_ATTRIBUTE_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTE_QUOTED) },
+    /* STATE_END_TAG */
+    { T(ACTION_ADD, STATE_END_TAG), T(ACTION_NONE, STATE_END_TAG),
+      T(ACTION_ERROR, STATE_END_TAG), T(ACTION_EMIT_TAG_END, STATE_CONTENTS_LEADING),
+      T(ACTION_ADD, STATE_END_TAG), T(ACTION_ADD, STATE_END_TAG),
+      T(ACTION_ADD, STATE_END_TAG), T(ACTION_ADD, STATE_END_TAG) },
+    /* STATE_ATTRIBUTES_LEADING */
+    { T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_NONE, STATE_ATTRIBUTES_LEADING),
+      T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_ENTER, STATE_CONTENTS_LEADING),
+      T(ACTION_EMPTY_TAG_ATTRIBUTES, STATE_EMPTY_TAG), T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_ADD, STATE_ATTRIBUTES) },
+    /* STATE_ATTRIBUTES */
+    { T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_ADD, STATE_ATTRIBUTES),
+      T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_EMIT_ATTRIBUTES, STATE_CONTENTS_LEADING),
+      T(ACTION_EMPTY_TAG_ATTRIBUTES, STATE_EMPTY_TAG), T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTES), T(ACTION_ADD, STATE_ATTRIBUTES) },
+    /* STATE_ATTRIBUTES_QUOTED */
+    { T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED),
+      T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTES),
+      T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED), T(ACTION_ADD, STATE_ATTRIBUTES_QUOTED) },
+    /* STATE_REFERENCE */
+    { T(ACTION_REFERENCE_NAME, STATE_REFERENCE), T(ACTION_REFERENCE_NAME, STATE_REFERENCE),
+      T(ACTION_REFERENCE_NAME, STATE_REFERENCE), T(ACTION_REFERENCE_NAME, STATE_REFERENCE),
+      T(ACTION_REFERENCE_NAME, STATE_REFERENCE), T(ACTION_REFERENCE_NAME, STATE_REFERENCE),
+      T(ACTION_REFERENCE_NAME, STATE_REFERENCE), T(ACTION_REFERENCE_NAME, STATE_REFERENCE) },
+    /* STATE_SKIP_OWN_TAG */
+    { T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG), T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG),
+      T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG), T(ACTION_ENTER, STATE_SKIP_CONTENT),
+      T(ACTION_SKIP_EMPTY_TAG, STATE_EMPTY_TAG), T(ACTION_ENTER, STATE_SKIP_OWN_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG), T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG) },
+    /* STATE_SKIP_OWN_TAG_QUOTED */
+    { T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED), T(ACTION_ENTER, STATE_SKIP_OWN_TAG),
+      T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_OWN_TAG_QUOTED) },
+    /* STATE_SKIP_CONTENT */
+    { T(ACTION_SEEK, STATE_SKIP_CONTENT), T(ACTION_SEEK, STATE_SKIP_CONTENT),
+      T(ACTION_ENTER, STATE_SKIP_TAG_OPEN), T(ACTION_SEEK, STATE_SKIP_CONTENT),
+      T(ACTION_SEEK, STATE_SKIP_CONTENT), T(ACTION_SEEK, STATE_SKIP_CONTENT),
+      T(ACTION_SEEK, STATE_SKIP_CONTENT), T(ACTION_SEEK, STATE_SKIP_CONTENT) },
+    /* STATE_SKIP_TAG_OPEN */
+    { T(ACTION_ENTER, STATE_SKIP_TAG), T(ACTION_ENTER, STATE_SKIP_TAG),
+      T(ACTION_NONE, STATE_SKIP_TAG_OPEN), T(ACTION_ENTER, STATE_SKIP_CONTENT),
+      T(ACTION_SKIP_END_TAG, STATE_SKIP_END_TAG), T(ACTION_ENTER, STATE_SKIP_TAG_QUOTED),
+      T(ACTION_ENTER, STATE_SKIP_TAG), T(ACTION_MARKUP, STATE_SKIP_CONTENT) },
+    /* STATE_SKIP_TAG */
+    { T(ACTION_SKIP_RUN, STATE_SKIP_TAG), T(ACTION_SKIP_RUN, STATE_SKIP_TAG),
+      T(ACTION_SKIP_RUN, STATE_SKIP_TAG), T(ACTION_SKIP_OPEN, STATE_SKIP_CONTENT),
+      T(ACTION_ENTER, STATE_SKIP_EMPTY_TAG), T(ACTION_ENTER, STATE_SKIP_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_TAG), T(ACTION_SKIP_RUN, STATE_SKIP_TAG) },
+    /* STATE_SKIP_TAG_QUOTED */
+    { T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED), T(ACTION_ENTER, STATE_SKIP_TAG),
+      T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED), T(ACTION_SKIP_RUN, STATE_SKIP_TAG_QUOTED) },
+    /* STATE_SKIP_EMPTY_TAG */
+    { T(ACTION_NONE, STATE_SKIP_EMPTY_TAG), T(ACTION_NONE, STATE_SKIP_EMPTY_TAG),
+      T(ACTION_NONE, STATE_SKIP_EMPTY_TAG), T(ACTION_ENTER, STATE_SKIP_CONTENT),
+      T(ACTION_NONE, STATE_SKIP_EMPTY_TAG), T(ACTION_ENTER, STATE_SKIP_TAG_QUOTED),
+      T(ACTION_NONE, STATE_SKIP_EMPTY_TAG), T(ACTION_NONE, STATE_SKIP_EMPTY_TAG) },
+    /* STATE_SKIP_END_TAG */
+    { T(ACTION_NONE, STATE_SKIP_END_TAG), T(ACTION_NONE, STATE_SKIP_END_TAG),
+      T(ACTION_NONE, STATE_SKIP_END_TAG), T(ACTION_SKIP_CLOSE, STATE_SKIP_CONTENT),
+      T(ACTION_NONE, STATE_SKIP_END_TAG), T(ACTION_NONE, STATE_SKIP_END_TAG),
+      T(ACTION_NONE, STATE_SKIP_END_TAG), T(ACTION_NONE, STATE_SKIP_END_TAG) },
+    /* STATE_DECLARATION */
+    { T(ACTION_MARKUP_OPEN, STATE_DECLARATION), T(ACTION_MARKUP_OPEN, STATE_DECLARATION),
+      T(ACTION_MARKUP_OPEN, STATE_DECLARATION), T(ACTION_MARKUP_OPEN, STATE_DECLARATION),
+      T(ACTION_MARKUP_OPEN, STATE_DECLARATION), T(ACTION_MARKUP_OPEN, STATE_DECLARATION),
+      T(ACTION_MARKUP_OPEN, STATE_DECLARATION), T(ACTION_MARKUP_OPEN, STATE_DECLARATION) },
+    /* STATE_COMMENT_OPEN */
+    { T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN), T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN), T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN), T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN), T(ACTION_MARKUP_OPEN, STATE_COMMENT_OPEN) },
+    /* STATE_CDATA_OPEN */
+    { T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN), T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN), T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN), T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN),
+      T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN), T(ACTION_MARKUP_OPEN, STATE_CDATA_OPEN) },
+    /* STATE_COMMENT */
+    { T(ACTION_MARKUP_TEXT, STATE_COMMENT), T(ACTION_MARKUP_TEXT, STATE_COMMENT),
+      T(ACTION_MARKUP_TEXT, STATE_COMMENT), T(ACTION_MARKUP_TEXT, STATE_COMMENT),
+      T(ACTION_MARKUP_TEXT, STATE_COMMENT), T(ACTION_MARKUP_TEXT, STATE_COMMENT),
+      T(ACTION_MARKUP_TEXT, STATE_COMMENT), T(ACTION_MARKUP_TEXT, STATE_COMMENT) },
+    /* STATE_PI */
+    { T(ACTION_MARKUP_TEXT, STATE_PI), T(ACTION_MARKUP_TEXT, STATE_PI),
+      T(ACTION_MARKUP_TEXT, STATE_PI), T(ACTION_MARKUP_TEXT, STATE_PI),
+      T(ACTION_MARKUP_TEXT, STATE_PI), T(ACTION_MARKUP_TEXT, STATE_PI),
+      T(ACTION_MARKUP_TEXT, STATE_PI), T(ACTION_MARKUP_TEXT, STATE_PI) },
+    /* STATE_CDATA */
+    { T(ACTION_MARKUP_TEXT, STATE_CDATA), T(ACTION_MARKUP_TEXT, STATE_CDATA),
+      T(ACTION_MARKUP_TEXT, STATE_CDATA), T(ACTION_MARKUP_TEXT, STATE_CDATA),
+      T(ACTION_MARKUP_TEXT, STATE_CDATA), T(ACTION_MARKUP_TEXT, STATE_CDATA),
+      T(ACTION_MARKUP_TEXT, STATE_CDATA), T(ACTION_MARKUP_TEXT, STATE_CDATA) },
+    /* STATE_DOCTYPE */
+    { T(ACTION_MARKUP_RUN, STATE_DOCTYPE), T(ACTION_MARKUP_RUN, STATE_DOCTYPE),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE), T(ACTION_MARKUP_END, STATE_DOCTYPE),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE), T(ACTION_ENTER, STATE_DOCTYPE_QUOTED),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE), T(ACTION_MARKUP_RUN, STATE_DOCTYPE) },
+    /* STATE_DOCTYPE_QUOTED */
+    { T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED), T(ACTION_ENTER, STATE_DOCTYPE),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_QUOTED) },
+    /* STATE_DOCTYPE_SUBSET */
+    { T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET), T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET), T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET), T(ACTION_ENTER, STATE_DOCTYPE_SUBSET_QUOTED),
+      T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET), T(ACTION_MARKUP_RUN, STATE_DOCTYPE_SUBSET) },
+    /* STATE_DOCTYPE_SUBSET_QUOTED */
+    { T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED), T(ACTION_ENTER, STATE_DOCTYPE_SUBSET),
+      T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED), T(ACTION_SKIP_RUN, STATE_DOCTYPE_SUBSET_QUOTED) }
+};
+#undef T
+
+/* Characters which end a run within tag contents (after any leading whitespace) */
+static const tScanSet g_scanContents = { 2, { '<', '"' },
+    { 0, 0, 0, 0, 0x04, 0, 0, 0x10 } };
+/* Characters which end a run within an attribute */
+static const tScanSet g_scanAttribute = { 7, { ' ', '\t', '\r', '\n', '/', '>', '"' },
+    { 0, 0x26, 0, 0, 0x05, 0x80, 0, 0x40 } };
+/* Characters which end a run of quoted text, within either tag contents or an attribute */
+static const tScanSet g_scanQuoted = { 1, { '"' },
+    { 0, 0, 0, 0, 0x04 } };
+/* Characters which end a run within a tag's attribute region */
+static const tScanSet g_scanAttributes = { 3, { '/', '>', '"' },
+    { 0, 0, 0, 0, 0x04, 0x80, 0, 0x40 } };
+/* Characters which end a run within a tag name */
+static const tScanSet g_scanTagName = { 6, { ' ', '\t', '\r', '\n', '/', '>' },
+    { 0, 0x26, 0, 0, 0x01, 0x80, 0, 0x40 } };
+/* Characters which end a run within an end tag */
+static const tScanSet g_scanEndTag = { 6, { ' ', '\t', '\r', '\n', '<', '>' },
+    { 0, 0x26, 0, 0, 0x01, 0, 0, 0x50 } };
+
+/* Keyword which follows '<![' to open a CDATA section */
+static const char g_cdataKeyword[] = "CDATA[";
+
+/* Characters which end a run within a declaration, and within its internal subset */
+static const tScanSet g_scanDeclaration = { 3, { '>', '"', '[' },
+    { 0, 0, 0, 0, 0x04, 0, 0, 0x40, 0, 0, 0, 0x08 } };
+static const tScanSet g_scanSubset = { 2, { ']', '"' },
+    { 0, 0, 0, 0, 0x04, 0, 0, 0, 0, 0, 0, 0x20 } };
+
+/* Delimiter set for states in which runs of characters are added to the token */
+static const tScanSet * const g_scanSets[STATE_COUNT] =
+{
+    NULL, NULL,
+    &g_scanTagName,    /* STATE_TAG_NAME */
+    NULL, NULL,
+    &g_scanContents,   /* STATE_CONTENTS */
+    &g_scanQuoted,     /* STATE_CONTENTS_QUOTED */
+    NULL,
+    &g_scanAttribute,  /* STATE_ATTRIBUTE */
+    &g_scanQuoted,     /* STATE_ATTRIBUTE_QUOTED */
+    &g_scanEndTag,     /* STATE_END_TAG */
+    NULL,
+    &g_scanAttributes, /* STATE_ATTRIBUTES */
+    &g_scanQuoted,     /* STATE_ATTRIBUTES_QUOTED */
+    NULL,
+    &g_scanAttributes,           /* STATE_SKIP_OWN_TAG */
+    &g_scanQuoted,               /* STATE_SKIP_OWN_TAG_QUOTED */
+    NULL, NULL,
+    &g_scanAttributes,           /* STATE_SKIP_TAG */
+    &g_scanQuoted,               /* STATE_SKIP_TAG_QUOTED */
+    NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL,
+    &g_scanDeclaration,          /* STATE_DOCTYPE */
+    &g_scanQuoted,               /* STATE_DOCTYPE_QUOTED */
+    &g_scanSubset,               /* STATE_DOCTYPE_SUBSET */
+    &g_scanQuoted                /* STATE_DOCTYPE_SUBSET_QUOTED */
+};
+
+/* When references are decoded, runs in contents and attributes also end at '&' */
+static const tScanSet g_scanContentsReferences = { 3, { '<', '"', '&' },
+    { 0, 0, 0, 0, 0x44, 0, 0, 0x10 } };
+static const tScanSet g_scanAttributeReferences = { 8, { ' ', '\t', '\r', '\n', '/', '>', '"', '&' },
+    { 0, 0x26, 0, 0, 0x45, 0x80, 0, 0x40 } };
+static const tScanSet g_scanQuotedReferences = { 2, { '"', '&' },
+    { 0, 0, 0, 0, 0x44 } };
+
+static const tScanSet * const g_scanSetsReferences[STATE_COUNT] =
+{
+    NULL, NULL,
+    &g_scanTagName,              /* STATE_TAG_NAME */
+    NULL, NULL,
+    &g_scanContentsReferences,   /* STATE_CONTENTS */
+    &g_scanQuotedReferences,     /* STATE_CONTENTS_QUOTED */
+    NULL,
+    &g_scanAttributeReferences,  /* STATE_ATTRIBUTE */
+    &g_scanQuotedReferences,     /* STATE_ATTRIBUTE_QUOTED */
+    &g_scanEndTag,               /* STATE_END_TAG */
+    NULL,
+    &g_scanAttributes,           /* STATE_ATTRIBUTES */
+    &g_scanQuoted,               /* STATE_ATTRIBUTES_QUOTED */
+    NULL,
+    &g_scanAttributes,           /* STATE_SKIP_OWN_TAG */
+    &g_scanQuoted,               /* STATE_SKIP_OWN_TAG_QUOTED */
+    NULL, NULL,
+    &g_scanAttributes,           /* STATE_SKIP_TAG */
+    &g_scanQuoted,               /* STATE_SKIP_TAG_QUOTED */
+    NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL,
+    &g_scanDeclaration,          /* STATE_DOCTYPE */
+    &g_scanQuoted,               /* STATE_DOCTYPE_QUOTED */
+    &g_scanSubset,               /* STATE_DOCTYPE_SUBSET */
+    &g_scanQuoted                /* STATE_DOCTYPE_SUBSET_QUOTED */
+};
+
+#define ContextBufferClear(ctxt) \
+    (ctxt)->length = 0;          \
+    (ctxt)->spanLength = 0;
+
+#define ContextTokenLength(ctxt) ((ctxt)->length + (ctxt)->spanLength)
+
+#define STATE_BIT(state) ((uint64_t) 1 << (state))
+
+/* True if a token in this state may be tracked in the caller's input */
+#define TRACKING(ctxt, state) ((ctxt)->bTrackSpans && 0 != ((ctxt)->trackStates & STATE_BIT(state)))
+
+/* Fragment handler for the token being built in ctxt->state, if there is one */
+static pfnFragmentHandler ContextFragmentHandler(const tParserContext *ctxt)
+{
+    uint8_t state = (STATE_REFERENCE == ctxt->state) ? ctxt->referenceState : ctxt->state;
 
-static int state_Begin(void *context, const char character);
-static int state_StartTag(void *context, const char character);
-static int state_TagName(void *context, const char character);
-static int state_TagContents(void *context, const char character);
-static int state_EndTag(void *context, const char character);
-static int state_EmptyTag(void *context, const char character);
-static int state_Attribute(void *context, const char character);
+    if(NULL == ctxt->fragments)
+        return NULL;
+    switch(state)
+    {
+        case STATE_CONTENTS: case STATE_CONTENTS_QUOTED: case STATE_CDATA:
+            return ctxt->fragments->contentHandler;
+        case STATE_ATTRIBUTE: case STATE_ATTRIBUTE_QUOTED:
+            return ctxt->fragments->attributeHandler;
+        default:
+            return NULL;
+    }
+}
 
-#define ChangeState(ctxt, state) \
-    (ctxt)->pfnHandler = state;  \
-    (ctxt)->bInitialize = 1;
+/* Deliver the current token to a fragment handler; the last fragment is delivered even if
+ *  it's empty, if any fragments came before it */
+static void ContextEmitFragment(tParserContext *ctxt, pfnFragmentHandler handler, const int bMore)
+{
+    STATS_HANDLER_BEGIN(ctxt)
+    if(ctxt->spanLength > 0)
+        handler(ctxt->user->cookie, ctxt->spanStart, ctxt->spanLength, bMore);
+    else if(ctxt->length > 0 || ctxt->bFragmented)
+        handler(ctxt->user->cookie, ctxt->buffer, ctxt->length, bMore);
+    STATS_HANDLER_END(ctxt)
+    ctxt->bFragmented = bMore;
+}
 
-static __inline int ContextBufferAddChar(tParserContext *ctxt, const char character)
+/* Copy a run of characters to the buffer. Returns the number of characters consumed, which
+ *  is less than length only if the buffer overflowed and truncation isn't allowed. With a
+ *  fragment handler for the token, a full buffer is delivered as a fragment instead. */
+static size_t ContextBufferCopy(tParserContext *ctxt, const char *run, const size_t length)
 {
-    if((ctxt)->length < ((ctxt)->maxStringSize) - 2)
+    pfnFragmentHandler handler;
+    size_t copied = 0, room;
+
+    for(;;)
     {
-        (ctxt)->buffer[(ctxt)->length] = character;
-        ++((ctxt)->length);
-        return 0;
+        room = 0;
+        if(ctxt->length < ctxt->maxStringSize - 2)
+            room = ctxt->maxStringSize - 2 - ctxt->length;
+        if(room > length - copied)
+            room = length - copied;
+
+        memcpy(&ctxt->buffer[ctxt->length], &run[copied], room);
+        ctxt->length += (uint32_t) room;
+        copied += room;
+        if(copied == length)
+            return length;
+
+        STATS_MAX(ctxt, maxStringLength, ctxt->length)
+        handler = ContextFragmentHandler(ctxt);
+        if(NULL == handler || 0 == ctxt->length)
+            break;
+        ContextEmitFragment(ctxt, handler, 1);
+        ctxt->length = 0;
     }
 
     /* string truncated */
     if(ctxt->bAllowTruncatedStrings)
-        return 0;
-    else
-        return SAXML_ERROR_BUFFER_OVERFLOW;
-}
-
-#define CallHandler(ctxt, handlerName)                                   \
-    if(NULL != (ctxt)->user->handlerName && (ctxt)->length > 0)          \
-    {                                                                    \
-        (ctxt)->buffer[(ctxt)->length] = '\0';                           \
-        ++((ctxt)->length);                                              \
-        (ctxt)->user->handlerName((ctxt)->user->cookie, (ctxt)->buffer); \
+    {
+        STATS_ADD(ctxt, truncatedCharacters, length - copied)
+        return length;
     }
+    return copied;
+}
 
-/* ---------------------------------------------------------------------------------------------
- * Exported Functions
- */
-
-tSaxmlParser saxml_Initialize(tSaxmlContext *context, const uint32_t maxStringSize)
+/* Move a token being tracked in the caller's input into the buffer. Returns the number of
+ *  characters of the span consumed, which is less than the span length on overflow. */
+static size_t ContextBufferMaterialize(tParserContext *ctxt)
 {
-    tParserContext *ctxt;
-
-    if(maxStringSize < SAXML_MIN_STRING_SIZE)
-        return NULL;
-    if(NULL == context)
-        return NULL;
-
-    #ifdef SAXML_NO_MALLOC
-    ctxt = &g_saxmlParserContext;
-    ctxt->buffer = g_saxmlBuffer;
-    if(NULL != ctxt->user)
-       return NULL; /* already in use */
-    #else
-    ctxt = (tParserContext *) malloc(sizeof(*ctxt));
-    if(NULL == ctxt)
-        return NULL;
+    size_t length = ctxt->spanLength;
+    pfnFragmentHandler handler;
 
-    ctxt->buffer = (char *) malloc(maxStringSize);
-    if(NULL == ctxt->buffer)
+    /* A fragment which doesn't fit is delivered from where it is, rather than being copied */
+    if(length > ctxt->maxStringSize - 2 && NULL != (handler = ContextFragmentHandler(ctxt)))
     {
-        free(ctxt);
-        return NULL;
+        ContextEmitFragment(ctxt, handler, 1);
+        ctxt->spanLength = 0;
+        return length;
     }
-    #endif
-
-    ctxt->user = context;
-    ctxt->length = 0;
-    ctxt->maxStringSize = maxStringSize;
-    ctxt->bAllowTruncatedStrings = 0;
-    ChangeState(ctxt, state_Begin);
-
-    return (tSaxmlParser) ctxt;
+    ctxt->spanLength = 0;
+    return ContextBufferCopy(ctxt, ctxt->spanStart, length);
 }
 
-void saxml_Deinitialize(tSaxmlParser parser)
+/* Add a run of characters from the caller's input to the token. Returns the number of
+ *  characters consumed, which is less than length only if the buffer overflowed. */
+static size_t ContextBufferAddRun(tParserContext *ctxt, const char *run, const size_t length)
 {
-    #ifndef SAXML_NO_MALLOC
-    tParserContext *ctxt = (tParserContext *) parser;
-    if(NULL != ctxt)
+    size_t spanLength = ctxt->spanLength;
+
+    if(TRACKING(ctxt, ctxt->state))
     {
-        if(NULL != ctxt->buffer)
-            free(ctxt->buffer);
-        free(ctxt);
+        if(spanLength > 0)
+        {
+            if(run == ctxt->spanStart + spanLength)
+            {
+                ctxt->spanLength += length;
+                return length;
+            }
+            if(ContextBufferMaterialize(ctxt) < spanLength)
+                return 0;
+        }
+        else if(0 == ctxt->length)
+        {
+            ctxt->spanStart = run;
+            ctxt->spanLength = length;
+            return length;
+        }
+    }
+    else if(1 == length && ctxt->length < ctxt->maxStringSize - 2)
+    {
+        ctxt->buffer[ctxt->length] = *run;
+        ++(ctxt->length);
+        return 1;
     }
-    #else
-    UNUSED(parser);
-    #endif
-}
 
-int saxml_HandleCharacter(tSaxmlParser parser, const char character)
-{
-    tParserContext *ctxt = (tParserContext *) parser;
-    return ctxt->pfnHandler(ctxt, character);
+    return ContextBufferCopy(ctxt, run, length);
 }
 
-void saxml_Reset(tSaxmlParser parser)
+/* Add characters which don't come from the caller's input (such as a decoded reference) to the
+ *  token, moving any token being tracked in place into the buffer first. Returns nonzero if
+ *  the characters were added, or truncation is allowed. */
+static int ContextBufferAddCopy(tParserContext *ctxt, const char *data, const size_t length)
 {
-    tParserContext *ctxt = (tParserContext *) parser;
-    ChangeState(ctxt, state_Begin);
-}
+    size_t spanLength = ctxt->spanLength;
 
-void saxml_AllowTruncatedStrings(tSaxmlParser parser, const int allow)
-{
-    tParserContext *ctxt = (tParserContext *) parser;
-    ctxt->bAllowTruncatedStrings = (allow) ? 1 : 0;
+    if(spanLength > 0 && ContextBufferMaterialize(ctxt) < spanLength)
+        return 0;
+    return ContextBufferCopy(ctxt, data, length) == length;
 }
 
-/* ---------------------------------------------------------------------------------------------
- * State Handlers
- */
-
-/* Wait for a tag start character */
-static int state_Begin(void *context, const char character)
+/* Find the terminator of a comment, processing instruction or CDATA section; some number of
+ *  repetitions of a character followed by '>' (e.g. "-->"). The repeated characters are held
+ *  back (counted in ctxt->markupMatched) until it's known whether they're part of the
+ *  terminator, since it may be split across buffers. With bText, the text of the section is
+ *  added to the token. Returns 0 with *terminator set to the '>', or to end if it wasn't found;
+ *  otherwise SAXML_ERROR_BUFFER_OVERFLOW with *terminator set to the character which didn't
+ *  fit. */
+static int ContextScanMarkup(tParserContext *ctxt, const char *position, const char * const end,
+    const char repeat, const uint8_t count, const int bText, const char **terminator)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
+    char held[2];
+    const char *run = position;
+    uint8_t matched = ctxt->markupMatched;
+    uint8_t previous = matched; /* held back from an earlier buffer */
+    size_t length, added;
 
-    DBG1("[state_Begin] %c\n", character);
+    held[0] = repeat;
+    held[1] = repeat;
 
-    if(ctxt->bInitialize)
+    while(position < end)
     {
-        DBG("[state_Begin] Initialize\n");
-        ctxt->length = 0;
-        ctxt->bInitialize = 0;
-    }
-
-    switch(character)
-    {
-        case '<':
-           nextState = state_StartTag;
-           break;
-        default:
+        if(0 == matched)
+        {
+            position = (const char *) memchr(position, repeat, (size_t) (end - position));
+            if(NULL == position)
+            {
+                position = end;
+                break;
+            }
+        }
+        if(repeat == *position)
+        {
+            if(matched < count)
+                ++matched;
+            else if(previous > 0)
+            {
+                /* The oldest of the held characters turns out to be text */
+                if(bText && !ContextBufferAddCopy(ctxt, held, 1))
+                {
+                    *terminator = run;
+                    return SAXML_ERROR_BUFFER_OVERFLOW;
+                }
+                --previous;
+            }
+        }
+        else if('>' == *position && count == matched)
             break;
+        else
+        {
+            if(bText && previous > 0 && !ContextBufferAddCopy(ctxt, held, previous))
+            {
+                *terminator = run;
+                return SAXML_ERROR_BUFFER_OVERFLOW;
+            }
+            previous = 0;
+            matched = 0;
+        }
+        ++position;
     }
 
-    if(NULL != nextState)
+    /* Text up to any held characters which are within this buffer */
+    length = (size_t) (position - run) - (size_t) (matched - previous);
+    if(bText && length > 0)
     {
-        ChangeState(ctxt, nextState);
+        added = ContextBufferAddRun(ctxt, run, length);
+        if(added != length)
+        {
+            *terminator = run + added;
+            return SAXML_ERROR_BUFFER_OVERFLOW;
+        }
     }
-
+    ctxt->markupMatched = (position < end) ? 0 : matched;
+    *terminator = position;
     return 0;
 }
 
-/* We've already found a tag start character, determine if this is start or end tag,
- *  and parse the tag name */
-static int state_StartTag(void *context, const char character)
+/* Deliver the current token to the span handler for an event if there is one, or to the
+ *  string handler otherwise */
+static int ContextEmit(tParserContext *ctxt, pfnStringHandler stringHandler,
+    pfnSpanHandler spanHandler)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-
-    DBG1("[state_StartTag] %c\n", character);
-
-    if(ctxt->bInitialize)
+    if(NULL != spanHandler)
     {
-        DBG("[state_StartTag] Initialize\n");
-        ctxt->bInitialize = 0;
+        STATS_HANDLER_BEGIN(ctxt)
+        if(ctxt->spanLength > 0)
+            spanHandler(ctxt->user->cookie, ctxt->spanStart, ctxt->spanLength);
+        else if(ctxt->length > 0)
+            spanHandler(ctxt->user->cookie, ctxt->buffer, ctxt->length);
+        STATS_HANDLER_END(ctxt)
     }
-
-    switch(character)
+    else if(NULL != stringHandler && ContextTokenLength(ctxt) > 0)
     {
-        case '<': case '>':
-            /* Syntax error! */
-            return SAXML_ERROR_SYNTAX;
-        case ' ': case '\r': case '\n': case '\t':
-            /* Ignore whitespace */
-            break;
-        case '/':
-            ChangeState(ctxt, state_EndTag);
-            break;
-        default:
-            ctxt->buffer[0] = character;
-            ctxt->length = 1;
-            ChangeState(ctxt, state_TagName);
-            break;
+        if(ctxt->spanLength > 0)
+        {
+            size_t length = ctxt->spanLength;
+            if(ContextBufferMaterialize(ctxt) < length)
+                return SAXML_ERROR_BUFFER_OVERFLOW;
+        }
+        ctxt->buffer[ctxt->length] = '\0';
+        STATS_HANDLER_BEGIN(ctxt)
+        stringHandler(ctxt->user->cookie, ctxt->buffer);
+        STATS_HANDLER_END(ctxt)
     }
 
     return 0;
 }
 
-static int state_TagName(void *context, const char character)
+/* Deliver the current token to the attributes handler, as an attribute region */
+static void ContextEmitAttributes(tParserContext *ctxt)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
+    tSaxmlAttributes attributes;
 
-    DBG1("[state_TagName] %c\n", character);
-
-    if(ctxt->bInitialize)
+    if(ctxt->spanLength > 0)
     {
-        /* Expect one character in the buffer; the start of the tag name from the previous state*/
-        DBG("[state_TagName] Initialize\n");
-        ctxt->bInitialize = 0;
+        attributes.data = ctxt->spanStart;
+        attributes.length = ctxt->spanLength;
     }
-
-    switch(character)
+    else
     {
-        case ' ': case '\r': case '\n': case '\t':
-            /* Tag name complete, whitespace indicates tag attribute */
-            nextState = state_Attribute;
-            break;
-        case '/':
-            nextState = state_EmptyTag;
-            break;
-        case '>':
-            nextState = state_TagContents; /* Done with tag, contents may follow */
-            break;
-        default:
-            if(ContextBufferAddChar(ctxt, character) != 0)
-               return SAXML_ERROR_BUFFER_OVERFLOW;
-            break;
+        attributes.data = ctxt->buffer;
+        attributes.length = ctxt->length;
     }
-
-    if(NULL != nextState)
+    if(attributes.length > 0)
     {
-        CallHandler(ctxt, tagHandler);
-        ChangeState(ctxt, nextState);
+        STATS_HANDLER_BEGIN(ctxt)
+        ctxt->pfnAttributes(ctxt->user->cookie, &attributes);
+        STATS_HANDLER_END(ctxt)
     }
-
-    return 0;
 }
 
-static int state_EmptyTag(void *context, const char character)
+/* Report the start or end of a document */
+static void ContextEmitDocument(tParserContext *ctxt, pfnDocumentHandler handler)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
-
-    DBG1("[state_EmptyTag] %c\n", character);
-
-    if(ctxt->bInitialize)
+    if(NULL != handler)
     {
-        /* We need to keep the buffer as-is, since it contains the tag name */
-        DBG("[state_EmptyTag] Initialize\n");
-        ctxt->bInitialize = 0;
+        STATS_HANDLER_BEGIN(ctxt)
+        handler(ctxt->user->cookie, ctxt->documentCount);
+        STATS_HANDLER_END(ctxt)
     }
+}
+
+/* Deliver the current token to an ID handler, along with the ID of the tag name, or the ID of
+ *  the attribute name for an attribute */
+static void ContextEmitId(tParserContext *ctxt, pfnIdHandler idHandler, const int bAttribute)
+{
+    const char *data = ctxt->buffer;
+    size_t length = ctxt->length;
+    size_t nameLength = 0;
 
-    switch(character)
+    if(ctxt->spanLength > 0)
     {
-        case '>':
-            nextState = state_TagContents;
-            break;
-        default:
-            break;
+        data = ctxt->spanStart;
+        length = ctxt->spanLength;
     }
+    if(0 == length)
+        return;
 
-    if(NULL != nextState)
+    if(!bAttribute)
+        nameLength = length;
+    else
     {
-        CallHandler(ctxt, tagEndHandler);
-        ChangeState(ctxt, nextState);
+        while(nameLength < length && '=' != data[nameLength] && ' ' != data[nameLength]
+            && '\t' != data[nameLength] && '\r' != data[nameLength] && '\n' != data[nameLength])
+        {
+            ++nameLength;
+        }
     }
 
-    return 0;
+    STATS_HANDLER_BEGIN(ctxt)
+    idHandler(ctxt->user->cookie, saxml_VocabularyLookup(ctxt->vocabulary, data, nameLength),
+        data, length);
+    STATS_HANDLER_END(ctxt)
 }
 
-static int state_TagContents(void *context, const char character)
+/* Match a path pattern (from a '/', or its end) against the names of open elements in
+ *  [path, pathEnd). '*' matches any one element, and '//' any number of elements. */
+static int PathMatches(const char *pattern, const char *path, const char * const pathEnd)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
+    const char *segment;
+    size_t segmentLength, nameLength;
 
-    DBG1("[state_TagContents] %c\n", character);
+    if('\0' == *pattern)
+        return path == pathEnd;
 
-    if(ctxt->bInitialize)
+    if('/' == pattern[1])
     {
-        DBG("[state_TagContents] Initialize\n");
-        ctxt->length = 0;
-        ctxt->bInitialize = 0;
-        ctxt->bInQuotedText = 0;
+        for(;;)
+        {
+            if(PathMatches(&pattern[1], path, pathEnd))
+                return 1;
+            if(path == pathEnd)
+                return 0;
+            path += strlen(path) + 1;
+        }
     }
 
-    switch(character)
+    if(path == pathEnd)
+        return 0;
+    segment = &pattern[1];
+    for(segmentLength = 0; '\0' != segment[segmentLength] && '/' != segment[segmentLength];
+        ++segmentLength)
+        ;
+    nameLength = strlen(path);
+    if(!(1 == segmentLength && '*' == *segment)
+        && (segmentLength != nameLength || memcmp(segment, path, nameLength) != 0))
     {
-        case '<':
-            if(0 == ctxt->bInQuotedText)
-                nextState = state_StartTag;
-            else
+        return 0;
+    }
+    return PathMatches(&segment[segmentLength], path + nameLength + 1, pathEnd);
+}
+
+/* Push the tag name in the current token onto the element stack, and start delivering events
+ *  if the new element is the root of a subscribed subtree */
+static int ContextPushElement(tParserContext *ctxt)
+{
+    const char *name = (ctxt->spanLength > 0) ? ctxt->spanStart : ctxt->buffer;
+    size_t length = ContextTokenLength(ctxt);
+    uint32_t i;
+
+    if(ctxt->stackUsed + length + 1 > ctxt->stackSize)
+        return SAXML_ERROR_STACK_OVERFLOW;
+    memcpy(&ctxt->stack[ctxt->stackUsed], name, length);
+    ctxt->stackUsed += length;
+    ctxt->stack[ctxt->stackUsed++] = '\0';
+    ++(ctxt->depth);
+
+    if(ctxt->bDiscard)
+    {
+        for(i = 0; i < ctxt->subscriptionCount; ++i)
+        {
+            if(PathMatches(ctxt->subscriptions[i], ctxt->stack, ctxt->stack + ctxt->stackUsed))
             {
-                if(ContextBufferAddChar(ctxt, character) != 0)
-                    return SAXML_ERROR_BUFFER_OVERFLOW;
+                ctxt->matchDepth = ctxt->depth;
+                ctxt->bDiscard = 0;
+                break;
             }
-            break;
-        case '"':
-            ctxt->bInQuotedText ^= 1;
-            if(ContextBufferAddChar(ctxt, character) != 0)
-                return SAXML_ERROR_BUFFER_OVERFLOW;
-            break;
-        case ' ': case '\r': case '\n': case '\t':
-            if(0 == ctxt->bInQuotedText && 0 == ctxt->length)
-                break; /* Ignore leading whitespace */
-            if(ContextBufferAddChar(ctxt, character) != 0)
-               return SAXML_ERROR_BUFFER_OVERFLOW;
-            break;
-        default:
-            if(ContextBufferAddChar(ctxt, character) != 0)
-               return SAXML_ERROR_BUFFER_OVERFLOW;
-            break;
+        }
     }
+    return 0;
+}
 
-    if(NULL != nextState)
+/* Pop the innermost element from the element stack */
+static void ContextPopElement(tParserContext *ctxt)
+{
+    if(0 == ctxt->depth)
+        return;
+    if(ctxt->matchDepth == ctxt->depth)
     {
-        CallHandler(ctxt, contentHandler);
-        ChangeState(ctxt, nextState);
+        ctxt->matchDepth = 0;
+        ctxt->bDiscard = 1;
     }
-
-    return 0;
+    --(ctxt->depth);
+    for(--(ctxt->stackUsed); ctxt->stackUsed > 0 && '\0' != ctxt->stack[ctxt->stackUsed - 1];
+        --(ctxt->stackUsed))
+        ;
 }
 
-static int state_Attribute(void *context, const char character)
+/* Name of the innermost element; there must be one */
+static const char *ContextTopElement(const tParserContext *ctxt, size_t *length)
 {
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
+    size_t start = ctxt->stackUsed - 1;
 
-    DBG1("[state_Attribute] %c\n", character);
+    while(start > 0 && '\0' != ctxt->stack[start - 1])
+        --start;
+    *length = ctxt->stackUsed - 1 - start;
+    return &ctxt->stack[start];
+}
 
-    if(ctxt->bInitialize)
-    {
-        DBG("[state_Attribute] Initialize\n");
-        ctxt->length = 0;
-        ctxt->bInitialize = 0;
-        ctxt->bInQuotedText = 0;
-    }
+/* Work out which events will be delivered, from the caller's mask and the registered handlers,
+ *  and so which states' tokens needn't be buffered, and which may be tracked in place */
+static void ContextUpdateEvents(tParserContext *ctxt)
+{
+    const tSaxmlContext *user = ctxt->user;
+    const tSaxmlSpanContext *spans = ctxt->spans;
+    const tSaxmlIdContext *ids = ctxt->ids;
+    const tSaxmlFragmentContext *fragments = ctxt->fragments;
+    uint8_t events = 0;
+    uint64_t discard = 0, track = 0;
+
+    if(NULL != user->tagHandler || (NULL != spans && NULL != spans->tagHandler)
+       || (NULL != ids && NULL != ids->tagHandler))
+        events |= SAXML_EVENT_TAG;
+    if(NULL != user->tagEndHandler || (NULL != spans && NULL != spans->tagEndHandler)
+       || (NULL != ids && NULL != ids->tagEndHandler))
+        events |= SAXML_EVENT_TAG_END;
+    if(NULL != user->contentHandler || (NULL != spans && NULL != spans->contentHandler)
+       || (NULL != fragments && NULL != fragments->contentHandler))
+        events |= SAXML_EVENT_CONTENT;
+    if(NULL != user->attributeHandler || (NULL != spans && NULL != spans->attributeHandler)
+       || (NULL != ids && NULL != ids->attributeHandler)
+       || (NULL != fragments && NULL != fragments->attributeHandler))
+        events |= SAXML_EVENT_ATTRIBUTE;
+    events &= ctxt->eventMask;
+
+    /* An empty tag's name is also its end tag's name */
+    if(NULL == ctxt->stack && 0 == (events & (SAXML_EVENT_TAG | SAXML_EVENT_TAG_END)))
+        discard |= STATE_BIT(STATE_TAG_NAME);
+    if(NULL == ctxt->stack && 0 == (events & SAXML_EVENT_TAG_END))
+        discard |= STATE_BIT(STATE_END_TAG);
+    if(0 == (events & SAXML_EVENT_CONTENT))
+        discard |= STATE_BIT(STATE_CONTENTS) | STATE_BIT(STATE_CONTENTS_QUOTED)
+            | STATE_BIT(STATE_CDATA);
+    if(0 == (events & SAXML_EVENT_ATTRIBUTE))
+        discard |= STATE_BIT(STATE_ATTRIBUTE) | STATE_BIT(STATE_ATTRIBUTE_QUOTED);
+
+    /* A token for a string handler is copied as it's parsed, rather than when it's delivered,
+       so that an overflow is found at the character which doesn't fit */
+    if((NULL != spans && (NULL != spans->tagHandler || NULL != spans->tagEndHandler))
+       || (NULL != ids && (NULL != ids->tagHandler || NULL != ids->tagEndHandler)))
+        track |= STATE_BIT(STATE_TAG_NAME);
+    if((NULL != spans && NULL != spans->tagEndHandler)
+       || (NULL != ids && NULL != ids->tagEndHandler))
+        track |= STATE_BIT(STATE_END_TAG);
+    if((NULL != spans && NULL != spans->contentHandler)
+       || (NULL != fragments && NULL != fragments->contentHandler))
+        track |= STATE_BIT(STATE_CONTENTS) | STATE_BIT(STATE_CONTENTS_QUOTED)
+            | STATE_BIT(STATE_CDATA);
+    if((NULL != spans && NULL != spans->attributeHandler)
+       || (NULL != ids && NULL != ids->attributeHandler)
+       || (NULL != fragments && NULL != fragments->attributeHandler))
+        track |= STATE_BIT(STATE_ATTRIBUTE) | STATE_BIT(STATE_ATTRIBUTE_QUOTED);
+    if(NULL != ctxt->pfnAttributes)
+        track |= STATE_BIT(STATE_ATTRIBUTES) | STATE_BIT(STATE_ATTRIBUTES_QUOTED);
+
+    ctxt->events = events;
+    ctxt->discardStates = discard;
+    ctxt->trackStates = track;
+}
 
-    switch(character)
-    {
-        case ' ': case '\r': case '\n': case '\t':
-            if(0 == ctxt->bInQuotedText)
-            {
-                if(0 != ctxt->length)
-                    nextState = state_Attribute;
-            }
-            else
-            {
-                if(ContextBufferAddChar(ctxt, character) != 0)
-                    return SAXML_ERROR_BUFFER_OVERFLOW;
-            }
-            break;
-        case '/':
-            if(0 == ctxt->bInQuotedText)
-            {
-                /* Handle the case where an attribute is included in an empty tag,
-                   and the attribute name/value has no trailing whitespace
-                   prior to the empty tag terminator. */
-                if (ctxt->length > 0)
-                {
-                    CallHandler(ctxt, attributeHandler);
-                    ctxt->length = 0;
-                }
+/* Apply the whitespace policy to contents about to be delivered. Trailing whitespace is
+ *  removed and, when collapsing, each run of whitespace within is replaced by a single space;
+ *  contents tracked in place are only copied if that changes them. Returns nonzero if they
+ *  didn't fit the buffer, and truncation isn't allowed. */
+static int ContextApplyWhitespace(tParserContext *ctxt)
+{
+    const char *data = (ctxt->spanLength > 0) ? ctxt->spanStart : ctxt->buffer;
+    size_t length = ContextTokenLength(ctxt);
+    size_t i, out = 0;
+    int bSpace = 0;
+    char c;
+
+    while(length > 0 && CLASS_SPACE == g_characterClass[(uint8_t) data[length - 1]])
+        --length;
+    if(ctxt->spanLength > 0)
+        ctxt->spanLength = length;
+    else
+        ctxt->length = (uint32_t) length;
+    if(SAXML_WHITESPACE_COLLAPSE != ctxt->whitespace)
+        return 0;
 
-                /* We've found an empty tag that contains at least one attribute.
-                   Since the buffer containing the tag name is long-gone (the attribute
-                   is now in the parser's string buffer), we don't have a way to get it
-                   back. In order to generate a "tagEnd" event, store a dummy string
-                   containing a single space character (which isn't a valid tag name),
-                   which will be provided to the tagEndHandler callback. */
-                if(ContextBufferAddChar(ctxt, ' ') != 0)
-                    return SAXML_ERROR_BUFFER_OVERFLOW;
-                nextState = state_EmptyTag;
-            }
-            else
-            {
-                if(ContextBufferAddChar(ctxt, character) != 0)
-                    return SAXML_ERROR_BUFFER_OVERFLOW;
-            }
-            break;
-        case '>':
-            if(0 == ctxt->bInQuotedText)
-                nextState = state_TagContents; /* Done with tag, contents may follow */
-            else
-            {
-                if(ContextBufferAddChar(ctxt, character) != 0)
-                    return SAXML_ERROR_BUFFER_OVERFLOW;
-            }
-            break;
-        case '"':
-            ctxt->bInQuotedText ^= 1;
-            ContextBufferAddChar(ctxt, character);
-            break;
-        default:
-            if(ContextBufferAddChar(ctxt, character) != 0)
-               return SAXML_ERROR_BUFFER_OVERFLOW;
+    for(i = 0; i < length; ++i)
+    {
+        if(CLASS_SPACE == g_characterClass[(uint8_t) data[i]]
+           && (' ' != data[i]
+               || (i + 1 < length && CLASS_SPACE == g_characterClass[(uint8_t) data[i + 1]])))
             break;
     }
+    if(i == length)
+        return 0;
 
-    if(NULL != nextState)
+    /* Within the buffer, the collapsed contents never overtake the original */
+    for(i = 0; i < length; ++i)
     {
-        if(nextState != state_EmptyTag)
+        c = data[i];
+        if(CLASS_SPACE == g_characterClass[(uint8_t) c])
         {
-            CallHandler(ctxt, attributeHandler);
+            if(bSpace)
+                continue;
+            c = ' ';
         }
-        ChangeState(ctxt, nextState);
+        bSpace = (' ' == c);
+        if(out >= ctxt->maxStringSize - 2)
+        {
+            if(!ctxt->bAllowTruncatedStrings)
+                return -1;
+            STATS_ADD(ctxt, truncatedCharacters, length - i)
+            break;
+        }
+        ctxt->buffer[out++] = c;
     }
-
+    ctxt->spanLength = 0;
+    ctxt->length = (uint32_t) out;
     return 0;
 }
 
-static int state_EndTag(void *context, const char character)
-{
-    tParserContext *ctxt = (tParserContext *) context;
-    pfnParserStateHandler nextState = NULL;
+#define CallHandler(ctxt, handlerName)                                     \
+    ContextEmit((ctxt), (ctxt)->user->handlerName,                         \
+        (NULL != (ctxt)->spans) ? (ctxt)->spans->handlerName : NULL)
 
-    DBG1("[state_EndTag] %c\n", character);
+/* ---------------------------------------------------------------------------------------------
+ * Parsing Engine
+ */
 
-    if(ctxt->bInitialize)
-    {
-        DBG("[state_EndTag] Initialize\n");
-        ctxt->length = 0;
-        ctxt->bInitialize = 0;
+#if defined(SAXML_COMPUTED_GOTO)
+   #pragma GCC diagnostic push
+   #pragma GCC diagnostic ignored "-Wpedantic"
+   #define ACTION(name) label_##name:
+   #define DISPATCH() goto *actions[TRANSITION_ACTION(transition)];
+#else
+   #define ACTION(name) case name:
+   #define DISPATCH() goto dispatch;
+#endif
+
+/* Fetch the transition for the character at position, and dispatch its action */
+#define NEXT_CHARACTER()                                                               \
+    if(++position >= end)                                                              \
+        goto done;                                                                     \
+    DBG1("[saxml] %c\n", *position);                                                   \
+    transition = g_transitions[state][g_characterClass[(uint8_t) *position]];          \
+    DISPATCH()
+
+/* Fetch the next character after an action which may have emitted an event. A pull parser
+ *  returns to the caller with the event's token first. */
+#define NEXT_CHARACTER_AFTER_EVENT()                                                   \
+    if(ctxt->bTokenReady)                                                              \
+    {                                                                                  \
+        ++position;                                                                    \
+        goto done;                                                                     \
+    }                                                                                  \
+    NEXT_CHARACTER();
+
+/* Enter a new state, discarding the token unless it's still needed for an empty tag */
+#define ENTER_STATE()                                                                  \
+    state = TRANSITION_STATE(transition);                                              \
+    if(STATE_EMPTY_TAG != state)                                                       \
+    {                                                                                  \
+        ContextBufferClear(ctxt);                                                      \
     }
 
-    switch(character)
-    {
-        case '<': /* syntax error */
-            return SAXML_ERROR_SYNTAX;
-        case ' ': case '\r': case '\n': case '\t':
-            /* Ignore whitespace */
-            break;
-        case '>':
-            nextState = state_TagContents;
-            break;
-        default:
-            if(ContextBufferAddChar(ctxt, character) != 0)
-               return SAXML_ERROR_BUFFER_OVERFLOW;
-            break;
+#define EMIT(handlerName)                                                              \
+    if(!ctxt->bDiscard && CallHandler(ctxt, handlerName) != 0)                         \
+    {                                                                                  \
+        result = SAXML_ERROR_BUFFER_OVERFLOW;                                          \
+        goto done;                                                                     \
+    }
+
+/* Emit the rest of a token through its fragment handler if there is one, or as usual */
+#define EMIT_FRAGMENT_OR(handlerName, emit)                                            \
+    if(NULL != ctxt->fragments && NULL != ctxt->fragments->handlerName)                \
+    {                                                                                  \
+        if(!ctxt->bDiscard)                                                            \
+            ContextEmitFragment(ctxt, ctxt->fragments->handlerName, 0);                \
+    }                                                                                  \
+    else                                                                               \
+    {                                                                                  \
+        emit                                                                           \
+    }
+
+/* While subscribed to paths, tokens outside of the subscribed subtrees aren't buffered; only
+ *  tag names are needed, for the element stack. Nor are tokens for events which won't be
+ *  delivered. */
+#define DISCARDING(ctxt, state)                                                        \
+    (((ctxt)->bDiscard && STATE_TAG_NAME != (state))                                   \
+     || 0 != (((ctxt)->discardStates >> (state)) & 1u))
+
+/* Emit an event which has a name, by ID if there's an ID handler for it */
+#define EMIT_NAMED(handlerName, bAttribute)                                            \
+    if(ctxt->bDiscard)                                                                 \
+        ;                                                                              \
+    else if(NULL != ctxt->ids && NULL != ctxt->ids->handlerName)                       \
+        ContextEmitId(ctxt, ctxt->ids->handlerName, (bAttribute));                     \
+    else if(CallHandler(ctxt, handlerName) != 0)                                       \
+    {                                                                                  \
+        result = SAXML_ERROR_BUFFER_OVERFLOW;                                          \
+        goto done;                                                                     \
+    }
+
+/* Count an event about to be emitted, as the handlers would see it */
+#if defined(SAXML_ENABLE_STATS)
+   #define STATS_EVENT(counter)                                                        \
+       STATS_MAX(ctxt, maxStringLength, ctxt->length)                                  \
+       if(!ctxt->bDiscard && (ContextTokenLength(ctxt) > 0 || ctxt->bFragmented))      \
+           ++(ctxt->stats.counter);
+   #define STATS_DEPTH(change)                                                         \
+       ctxt->statsDepth += (change);                                                   \
+       if(ctxt->statsDepth > 0 && (uint32_t) ctxt->statsDepth > ctxt->stats.maxDepth)   \
+           ctxt->stats.maxDepth = (uint32_t) ctxt->statsDepth;
+#else
+   #define STATS_EVENT(counter)
+   #define STATS_DEPTH(change)
+#endif
+
+/* Track the depth of elements within the current document, while framing documents. Once
+ *  one ends, nothing but the start of the next tag is looked for. */
+#define DOCUMENT_START()                                                               \
+    if(NULL != ctxt->documents && 0 == (ctxt->documentDepth)++)                        \
+        ContextEmitDocument(ctxt, ctxt->documents->startHandler);
+#define DOCUMENT_END()                                                                 \
+    if(NULL != ctxt->documents && ctxt->documentDepth > 0 && 0 == --(ctxt->documentDepth)) \
+    {                                                                                  \
+        ContextEmitDocument(ctxt, ctxt->documents->endHandler);                        \
+        ++(ctxt->documentCount);                                                       \
+        state = STATE_BEGIN;                                                           \
+    }
+
+/* Start skipping the innermost element, if a handler asked to. Where the element is already
+ *  ending (an empty tag, or its end tag), there's nothing to skip. */
+#define SKIP_IF_REQUESTED()                                                            \
+    if(ctxt->bSkipRequested)                                                           \
+    {                                                                                  \
+        ctxt->bSkipRequested = 0;                                                      \
+        ctxt->skipDepth = 1;                                                           \
+        if(STATE_CONTENTS_LEADING == state)                                            \
+            state = STATE_SKIP_CONTENT;                                                \
+        else if(STATE_START_TAG == state)                                              \
+            state = STATE_SKIP_TAG_OPEN;                                               \
+        else if(STATE_ATTRIBUTE_LEADING == state || STATE_ATTRIBUTES_LEADING == state) \
+            state = STATE_SKIP_OWN_TAG;                                                \
     }
 
-    if(NULL != nextState)
+/* How tokens are handled by Parse */
+#define PARSE_COPY      0  /* always copied into the parser's buffer */
+#define PARSE_IN_PLACE  1  /* tracked in place if span handlers are registered, until end */
+#define PARSE_PART      2  /* as PARSE_IN_PLACE, but the caller's buffer continues past end */
+
+/* Run the state machine over [position, end). Returns 0 on success or one of SAXML_ERROR_*,
+ *  in which case *stop is set to the character which caused the error. */
+static int RunEngine(tParserContext *ctxt, const char *position, const char * const end,
+    const int mode, const char **stop)
+{
+#if defined(SAXML_COMPUTED_GOTO)
+    static const void * const actions[ACTION_COUNT] =
+    {
+        &&label_ACTION_NONE, &&label_ACTION_SEEK, &&label_ACTION_ERROR, &&label_ACTION_ENTER,
+        &&label_ACTION_TAG_NAME, &&label_ACTION_ADD, &&label_ACTION_ADD_UNCHECKED,
+        &&label_ACTION_EMIT_TAG, &&label_ACTION_EMIT_TAG_END, &&label_ACTION_EMIT_CONTENT,
+        &&label_ACTION_EMIT_ATTRIBUTE, &&label_ACTION_EMPTY_TAG, &&label_ACTION_EMIT_ATTRIBUTES,
+        &&label_ACTION_EMPTY_TAG_ATTRIBUTES, &&label_ACTION_REFERENCE,
+        &&label_ACTION_REFERENCE_NAME, &&label_ACTION_SKIP_RUN, &&label_ACTION_SKIP_OPEN,
+        &&label_ACTION_SKIP_CLOSE, &&label_ACTION_SKIP_END_TAG, &&label_ACTION_SKIP_EMPTY_TAG,
+        &&label_ACTION_MARKUP, &&label_ACTION_MARKUP_OPEN, &&label_ACTION_MARKUP_TEXT,
+        &&label_ACTION_MARKUP_RUN, &&label_ACTION_MARKUP_END
+    };
+#endif
+    uint8_t state = ctxt->state;
+    uint16_t transition;
+    const char *run;
+    const char *found;
+    const tScanSet *set;
+    size_t length, added;
+    char decoded[REFERENCE_MAX_DECODED];
+    int result = 0;
+#if defined(SAXML_ENABLE_STATS)
+    const char * const start = position;
+#endif
+#if defined(SAXML_ENABLE_STATS_TIMING)
+    const uint64_t clockStart = SAXML_STATS_CLOCK();
+    const uint64_t handlerTicks = ctxt->stats.handlerTicks;
+#endif
+
+    ctxt->bTrackSpans = (PARSE_COPY != mode) && (NULL != ctxt->spans || NULL != ctxt->fragments);
+    ContextUpdateEvents(ctxt);
+    if((position < end || ctxt->spanLength > 0) && !parser_AcquireBuffer(ctxt))
     {
-        CallHandler(ctxt, tagEndHandler);
-        ChangeState(ctxt, nextState);
+        DBG("[saxml] No buffer free in pool\n");
+        STATS_ADD(ctxt, errors, 1)
+        if(NULL != stop)
+            *stop = position;
+        return SAXML_ERROR_POOL;
     }
+    if(position >= end)
+        goto done;
+    --position; /* NEXT_CHARACTER pre-increments */
+    NEXT_CHARACTER();
+
+#if !defined(SAXML_COMPUTED_GOTO)
+dispatch:
+    switch(TRANSITION_ACTION(transition))
+    {
+#endif
+    ACTION(ACTION_NONE)
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_SEEK)
+        /* Nothing but a tag start character is of interest here */
+        found = (const char *) memchr(position, '<', (size_t) (end - position));
+        position = (NULL == found) ? end : found;
+        --position;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_ERROR)
+        DBG1("[saxml] Syntax error at '%c'\n", *position);
+        result = SAXML_ERROR_SYNTAX;
+        goto done;
+
+    ACTION(ACTION_ENTER)
+        ENTER_STATE();
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_TAG_NAME)
+        state = STATE_TAG_NAME;
+        ctxt->state = state;
+        ContextBufferClear(ctxt);
+        if(TRACKING(ctxt, STATE_TAG_NAME))
+            ContextBufferAddRun(ctxt, position, 1);
+        else
+        {
+            ctxt->buffer[0] = *position;
+            ctxt->length = 1;
+        }
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_ADD_UNCHECKED)
+        state = TRANSITION_STATE(transition);
+        ctxt->state = state;
+        if(!DISCARDING(ctxt, state))
+            ContextBufferAddRun(ctxt, position, 1);
+        run = position + 1;
+        goto add_run;
+
+    ACTION(ACTION_ADD)
+    add:
+        state = TRANSITION_STATE(transition);
+        run = position;
+    add_run:
+        /* Every character up to the next delimiter is simply added to the token */
+        set = ctxt->scanSets[state];
+        if(NULL == set || position + 1 >= end)
+            found = position + 1;
+        else if(end - position > SCAN_MIN_VECTOR_LENGTH)
+            found = ctxt->pfnScan(position + 1, end, set);
+        else
+            found = scan_Scalar(position + 1, end, set);
+        length = (size_t) (found - run);
+        if(length > 0 && !DISCARDING(ctxt, state))
+        {
+            ctxt->state = state; /* for ContextFragmentHandler, should the buffer fill */
+            added = ContextBufferAddRun(ctxt, run, length);
+            if(added != length)
+            {
+                position = run + added;
+                result = SAXML_ERROR_BUFFER_OVERFLOW;
+                goto done;
+            }
+        }
+        position = found - 1;
+        NEXT_CHARACTER();
 
-    return 0;
+    ACTION(ACTION_EMIT_TAG)
+        if(NULL != ctxt->stack)
+        {
+            result = ContextPushElement(ctxt);
+            if(0 != result)
+                goto done;
+        }
+        DOCUMENT_START();
+        STATS_DEPTH(1)
+        if(ctxt->events & SAXML_EVENT_TAG)
+        {
+            STATS_EVENT(tags)
+            EMIT_NAMED(tagHandler, 0);
+        }
+        ENTER_STATE();
+        if(STATE_ATTRIBUTE_LEADING == state && NULL != ctxt->pfnAttributes)
+            state = STATE_ATTRIBUTES_LEADING;
+        SKIP_IF_REQUESTED();
+        NEXT_CHARACTER_AFTER_EVENT();
+
+    ACTION(ACTION_EMIT_TAG_END)
+        STATS_DEPTH(-1)
+        if(ctxt->events & SAXML_EVENT_TAG_END)
+        {
+            STATS_EVENT(tagEnds)
+            EMIT_NAMED(tagEndHandler, 0);
+        }
+        if(NULL != ctxt->stack)
+            ContextPopElement(ctxt);
+        ctxt->bSkipRequested = 0;
+        ENTER_STATE();
+        DOCUMENT_END();
+        NEXT_CHARACTER_AFTER_EVENT();
+
+    ACTION(ACTION_EMIT_CONTENT)
+        if(ctxt->events & SAXML_EVENT_CONTENT)
+        {
+            /* Contents delivered in fragments are passed through unchanged, whether or not
+               any have been delivered yet, so that they don't depend on the chunking */
+            if(SAXML_WHITESPACE_PRESERVE != ctxt->whitespace && !ctxt->bDiscard
+               && (NULL == ctxt->fragments || NULL == ctxt->fragments->contentHandler)
+               && 0 != ContextApplyWhitespace(ctxt))
+            {
+                result = SAXML_ERROR_BUFFER_OVERFLOW;
+                goto done;
+            }
+            STATS_EVENT(contents)
+            EMIT_FRAGMENT_OR(contentHandler, EMIT(contentHandler));
+        }
+        ENTER_STATE();
+        SKIP_IF_REQUESTED();
+        NEXT_CHARACTER_AFTER_EVENT();
+
+    ACTION(ACTION_EMIT_ATTRIBUTE)
+        if(ctxt->events & SAXML_EVENT_ATTRIBUTE)
+        {
+            STATS_EVENT(attributes)
+            EMIT_FRAGMENT_OR(attributeHandler, EMIT_NAMED(attributeHandler, 1));
+        }
+        ENTER_STATE();
+        SKIP_IF_REQUESTED();
+        NEXT_CHARACTER_AFTER_EVENT();
+
+    ACTION(ACTION_EMPTY_TAG)
+        /* Handle the case where an attribute is included in an empty tag, and the attribute
+           name/value has no trailing whitespace prior to the empty tag terminator. */
+        if(ctxt->events & SAXML_EVENT_ATTRIBUTE)
+        {
+            STATS_EVENT(attributes)
+            EMIT_FRAGMENT_OR(attributeHandler, EMIT_NAMED(attributeHandler, 1));
+        }
+        if(ctxt->bTokenReady)
+        {
+            /* The attribute may be in the buffer, which is about to be reused; return it to
+               the caller now, and handle the '/' again afterwards with nothing buffered */
+            ContextBufferClear(ctxt);
+            state = STATE_ATTRIBUTE_LEADING;
+            goto done;
+        }
+
+        /* We've found an empty tag that contains at least one attribute. Since the buffer
+           containing the tag name is long-gone (the attribute is now in the parser's string
+           buffer), we don't have a way to get it back. In order to generate a "tagEnd" event,
+           store a dummy string containing a single space character (which isn't a valid tag
+           name), which will be provided to the tagEndHandler callback. With an element stack,
+           the name is still available there. */
+    empty_tag:
+        state = STATE_EMPTY_TAG;
+        ctxt->state = state;
+        ContextBufferClear(ctxt);
+        if(NULL != ctxt->stack && ctxt->depth > 0)
+        {
+            run = ContextTopElement(ctxt, &length);
+            if(ContextBufferCopy(ctxt, run, length) != length)
+            {
+                result = SAXML_ERROR_BUFFER_OVERFLOW;
+                goto done;
+            }
+        }
+        else if(ContextBufferCopy(ctxt, " ", 1) != 1)
+        {
+            result = SAXML_ERROR_BUFFER_OVERFLOW;
+            goto done;
+        }
+        ctxt->bSkipRequested = 0;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_EMIT_ATTRIBUTES)
+        STATS_EVENT(attributeRegions)
+        if(!ctxt->bDiscard)
+            ContextEmitAttributes(ctxt);
+        ENTER_STATE();
+        SKIP_IF_REQUESTED();
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_EMPTY_TAG_ATTRIBUTES)
+        STATS_EVENT(attributeRegions)
+        if(!ctxt->bDiscard)
+            ContextEmitAttributes(ctxt);
+        goto empty_tag;
+
+    ACTION(ACTION_REFERENCE)
+        if(!ctxt->bDecodeReferences || DISCARDING(ctxt, TRANSITION_STATE(transition)))
+            goto add;
+        ctxt->referenceState = TRANSITION_STATE(transition);
+        ctxt->reference[0] = '&';
+        ctxt->referenceLength = 1;
+        state = STATE_REFERENCE;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_REFERENCE_NAME)
+        /* The reference may be split across buffers, so it's accumulated in the context */
+        while(REFERENCE_IS_NAME(*position) && ctxt->referenceLength < REFERENCE_MAX_LENGTH)
+        {
+            ctxt->reference[ctxt->referenceLength] = *position;
+            ++(ctxt->referenceLength);
+            if(++position >= end)
+                goto done;
+        }
+        state = ctxt->referenceState;
+        ctxt->state = state;
+        if(';' == *position)
+        {
+            length = reference_Decode(&ctxt->reference[1], ctxt->referenceLength - 1u, decoded);
+            if(length > 0)
+            {
+                if(!ContextBufferAddCopy(ctxt, decoded, length))
+                {
+                    result = SAXML_ERROR_BUFFER_OVERFLOW;
+                    goto done;
+                }
+                NEXT_CHARACTER();
+            }
+        }
+
+        /* Not a reference which can be decoded; keep it as it is, and handle this character
+           in the state the reference interrupted */
+        if(!ContextBufferAddCopy(ctxt, ctxt->reference, ctxt->referenceLength))
+        {
+            result = SAXML_ERROR_BUFFER_OVERFLOW;
+            goto done;
+        }
+        transition = g_transitions[state][g_characterClass[(uint8_t) *position]];
+        DISPATCH();
+
+    ACTION(ACTION_SKIP_RUN)
+        /* Nothing is buffered while skipping, so runs are simply passed over */
+    skip_run:
+        set = ctxt->scanSets[state];
+        if(position + 1 >= end)
+            found = position + 1;
+        else if(end - position > SCAN_MIN_VECTOR_LENGTH)
+            found = ctxt->pfnScan(position + 1, end, set);
+        else
+            found = scan_Scalar(position + 1, end, set);
+        position = found - 1;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_SKIP_OPEN)
+        ++(ctxt->skipDepth);
+        state = TRANSITION_STATE(transition);
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_SKIP_CLOSE)
+        --(ctxt->skipDepth);
+        state = TRANSITION_STATE(transition);
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_SKIP_END_TAG)
+        /* The end tag of the skipped element itself is parsed as usual, so that it's
+           reported (and popped from the element stack) */
+        if(1 == ctxt->skipDepth)
+            state = STATE_END_TAG;
+        else
+            state = TRANSITION_STATE(transition);
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_SKIP_EMPTY_TAG)
+        goto empty_tag;
+
+    ACTION(ACTION_MARKUP)
+        /* '<!' or '<?'; the transition's state is the one to return to once the markup ends */
+        ctxt->markupState = TRANSITION_STATE(transition);
+        ctxt->markupMatched = 0;
+        state = ('?' == *position) ? STATE_PI : STATE_DECLARATION;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_MARKUP_OPEN)
+        /* The keyword may be split across buffers, so progress through it is kept in the
+           context */
+        if(STATE_DECLARATION == state)
+        {
+            if('-' == *position)
+                state = STATE_COMMENT_OPEN;
+            else if('[' == *position)
+                state = STATE_CDATA_OPEN;
+            else
+            {
+                /* Any other declaration (e.g. DOCTYPE) is skipped, from this character */
+                state = STATE_DOCTYPE;
+                transition = g_transitions[state][g_characterClass[(uint8_t) *position]];
+                DISPATCH();
+            }
+        }
+        else if(STATE_COMMENT_OPEN == state && '-' == *position)
+            state = STATE_COMMENT;
+        else if(STATE_CDATA_OPEN == state && g_cdataKeyword[ctxt->markupMatched] == *position)
+        {
+            if(++(ctxt->markupMatched) == sizeof(g_cdataKeyword) - 1)
+            {
+                ctxt->markupMatched = 0;
+                ContextBufferClear(ctxt);
+                state = STATE_CDATA;
+            }
+        }
+        else
+        {
+            DBG1("[saxml] Syntax error at '%c'\n", *position);
+            result = SAXML_ERROR_SYNTAX;
+            goto done;
+        }
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_MARKUP_TEXT)
+        /* Comments and processing instructions are passed over, and CDATA sections are
+           delivered as contents, exactly as they appear; either way, nothing but the
+           terminator is looked for */
+        ctxt->state = state; /* for ContextFragmentHandler, should the buffer fill */
+        if(STATE_COMMENT == state)
+            result = ContextScanMarkup(ctxt, position, end, '-', 2, 0, &found);
+        else if(STATE_PI == state)
+            result = ContextScanMarkup(ctxt, position, end, '?', 1, 0, &found);
+        else
+        {
+            result = ContextScanMarkup(ctxt, position, end, ']', 2,
+                !DISCARDING(ctxt, STATE_CDATA) && STATE_SKIP_CONTENT != ctxt->markupState,
+                &found);
+        }
+        position = found;
+        if(0 != result || found == end)
+            goto done;
+        if(STATE_CDATA == state)
+        {
+            state = ctxt->markupState;
+            if(ctxt->events & SAXML_EVENT_CONTENT)
+            {
+                STATS_EVENT(contents)
+                EMIT_FRAGMENT_OR(contentHandler, EMIT(contentHandler));
+            }
+            ContextBufferClear(ctxt);
+            NEXT_CHARACTER_AFTER_EVENT();
+        }
+        state = ctxt->markupState;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_MARKUP_RUN)
+        /* A declaration's internal subset may contain '>'s of its own */
+        if('[' == *position && STATE_DOCTYPE == state)
+            state = STATE_DOCTYPE_SUBSET;
+        else if(']' == *position && STATE_DOCTYPE_SUBSET == state)
+            state = STATE_DOCTYPE;
+        else
+            goto skip_run;
+        NEXT_CHARACTER();
+
+    ACTION(ACTION_MARKUP_END)
+        state = ctxt->markupState;
+        NEXT_CHARACTER();
+
+#if !defined(SAXML_COMPUTED_GOTO)
+    default:
+        break;
+    }
+#endif
+
+done:
+    ctxt->state = state;
+    STATS_ADD(ctxt, bytes, (uint64_t) (position - start))
+
+    /* A token tracked in place must be copied before the caller's buffer goes away */
+    if(ctxt->spanLength > 0 && PARSE_PART != mode)
+    {
+        length = ctxt->spanLength;
+        run = ctxt->spanStart;
+        found = run + ContextBufferMaterialize(ctxt);
+        if(0 == result && found < run + length)
+        {
+            position = found;
+            result = SAXML_ERROR_BUFFER_OVERFLOW;
+        }
+    }
+
+    parser_ReleaseBuffer(ctxt);
+
+    STATS_ADD(ctxt, errors, (0 != result))
+#if defined(SAXML_ENABLE_STATS_TIMING)
+    ctxt->stats.parserTicks += (SAXML_STATS_CLOCK() - clockStart)
+        - (ctxt->stats.handlerTicks - handlerTicks);
+#endif
+    if(NULL != stop)
+        *stop = position;
+    return result;
+}
+
+#if defined(SAXML_COMPUTED_GOTO)
+   #pragma GCC diagnostic pop
+#endif
+
+/* Input validated ahead of the engine at a time; small enough to stay in cache */
+#define UTF8_BLOCK_SIZE (16 * 1024)
+
+/* Run the state machine over [position, end), validating UTF-8 first if requested. Everything
+ *  before an invalid character is parsed, then SAXML_ERROR_ENCODING is returned with *stop set
+ *  to it. */
+static int Parse(tParserContext *ctxt, const char *position, const char * const end,
+    const int mode, const char **stop)
+{
+    const char *validated = position;
+    const char *blockEnd;
+    const char *partStop = position;
+    int bInvalid = 0;
+    int result = 0;
+
+    if(!ctxt->bValidateUtf8 || position >= end)
+        return RunEngine(ctxt, position, end, mode, stop);
+
+    /* A pull parser may have stopped early within a block which was already validated */
+    if(NULL != ctxt->utf8Validated && ctxt->utf8Validated > position
+       && ctxt->utf8Validated <= end)
+    {
+        validated = ctxt->utf8Validated;
+    }
+    ctxt->utf8Validated = NULL;
+
+    while(position < end)
+    {
+        if(validated <= position)
+        {
+            blockEnd = (end - position > UTF8_BLOCK_SIZE) ? position + UTF8_BLOCK_SIZE : end;
+            validated = encoding_ValidateUtf8(&ctxt->utf8, ctxt->pfnAscii, position, blockEnd);
+            bInvalid = (validated < blockEnd);
+        }
+
+        result = RunEngine(ctxt, position, validated,
+            (validated == end || bInvalid) ? mode : PARSE_PART, &partStop);
+        if(0 != result)
+            break;
+        if(partStop < validated || ctxt->bTokenReady)
+        {
+            /* A pull parser's token is returned first, even where it ends at an invalid
+               character, which is then reported by the next call */
+            if(partStop < validated)
+                ctxt->utf8Validated = validated;
+            break;
+        }
+        position = validated;
+        if(bInvalid)
+        {
+            DBG1("[saxml] Invalid UTF-8 0x%02x\n", (uint8_t) *position);
+            STATS_ADD(ctxt, errors, 1)
+            result = SAXML_ERROR_ENCODING;
+            break;
+        }
+    }
+
+    if(NULL != stop)
+        *stop = partStop;
+    return result;
+}
+
+int parser_ParsePart(tParserContext *ctxt, const char *position, const char *end,
+    const char **stop)
+{
+    return Parse(ctxt, position, end, PARSE_PART, stop);
+}
+
+int parser_EndParts(tParserContext *ctxt, const char **stop)
+{
+    size_t length = ctxt->spanLength;
+    size_t copied;
+
+    if(0 == length)
+        return 0;
+    if(!parser_AcquireBuffer(ctxt))
+    {
+        *stop = ctxt->spanStart;
+        STATS_ADD(ctxt, errors, 1)
+        return SAXML_ERROR_POOL;
+    }
+    copied = ContextBufferMaterialize(ctxt);
+    if(copied < length)
+    {
+        *stop = ctxt->spanStart + copied;
+        STATS_ADD(ctxt, errors, 1)
+        return SAXML_ERROR_BUFFER_OVERFLOW;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+int parser_AcquireBuffer(tParserContext *ctxt)
+{
+    if(NULL == ctxt->buffer)
+        ctxt->buffer = pool_Borrow(ctxt->pool);
+    return (NULL != ctxt->buffer);
+}
+
+void parser_ReleaseBuffer(tParserContext *ctxt)
+{
+    if(NULL != ctxt->pool && NULL != ctxt->buffer && 0 == ctxt->length)
+    {
+        pool_Return(ctxt->pool, ctxt->buffer);
+        ctxt->buffer = NULL;
+    }
+}
+
+size_t saxml_StorageSize(const uint32_t maxStringSize)
+{
+    return (STORAGE_ALIGNMENT - 1) + sizeof(tParserContext) + maxStringSize;
+}
+
+#if defined(SAXML_ENABLE_STATS)
+void parser_MergeStats(tParserContext *ctxt, const tParserContext *part)
+{
+    const tSaxmlStats *stats = &part->stats;
+    int32_t depth;
+
+    ctxt->stats.bytes += stats->bytes;
+    ctxt->stats.tags += stats->tags;
+    ctxt->stats.tagEnds += stats->tagEnds;
+    ctxt->stats.contents += stats->contents;
+    ctxt->stats.attributes += stats->attributes;
+    ctxt->stats.attributeRegions += stats->attributeRegions;
+    ctxt->stats.truncatedCharacters += stats->truncatedCharacters;
+    ctxt->stats.errors += stats->errors;
+    if(stats->maxStringLength > ctxt->stats.maxStringLength)
+        ctxt->stats.maxStringLength = stats->maxStringLength;
+
+    /* The part's depths are relative to where it started, which is where ctxt is now */
+    depth = ctxt->statsDepth + (int32_t) stats->maxDepth;
+    if(depth > 0 && (uint32_t) depth > ctxt->stats.maxDepth)
+        ctxt->stats.maxDepth = (uint32_t) depth;
+    ctxt->statsDepth += part->statsDepth;
+}
+#endif
+
+#if defined(SAXML_ENABLE_STATS_TIMING)
+uint64_t parser_Clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+#endif
+
+void parser_ApplySkipRequest(tParserContext *ctxt)
+{
+    uint8_t state = ctxt->state;
+    SKIP_IF_REQUESTED();
+    ctxt->state = state;
+}
+
+/* Initialize everything but the buffer, in storage at least saxml_PooledStorageSize bytes long.
+ *  Returns the context, within storage. */
+static tParserContext *ContextInitialize(void *storage, tSaxmlContext *context,
+    const uint32_t maxStringSize)
+{
+    tParserContext *ctxt;
+    size_t padding;
+
+    padding = (STORAGE_ALIGNMENT - ((size_t) storage % STORAGE_ALIGNMENT)) % STORAGE_ALIGNMENT;
+    ctxt = (tParserContext *) ((char *) storage + padding);
+
+    ctxt->user = context;
+    ctxt->spans = NULL;
+    ctxt->pfnAttributes = NULL;
+    ctxt->ids = NULL;
+    ctxt->fragments = NULL;
+    ctxt->bFragmented = 0;
+    ctxt->vocabulary = NULL;
+    ctxt->bTrackSpans = 0;
+    ctxt->maxStringSize = maxStringSize;
+    ctxt->bAllowTruncatedStrings = 0;
+    ctxt->bOwnsStorage = 0;
+    ctxt->pfnScan = scan_SelectHandler();
+    ctxt->scanSets = g_scanSets;
+    ctxt->bDecodeReferences = 0;
+    ctxt->referenceState = STATE_CONTENTS;
+    ctxt->referenceLength = 0;
+    ctxt->stack = NULL;
+    ctxt->stackSize = 0;
+    ctxt->stackUsed = 0;
+    ctxt->depth = 0;
+    ctxt->subscriptionCount = 0;
+    ctxt->matchDepth = 0;
+    ctxt->bDiscard = 0;
+    ctxt->bSkipRequested = 0;
+    ctxt->skipDepth = 0;
+    ctxt->markupState = STATE_CONTENTS_LEADING;
+    ctxt->markupMatched = 0;
+    ctxt->documents = NULL;
+    ctxt->documentDepth = 0;
+    ctxt->documentCount = 0;
+    ctxt->eventMask = SAXML_EVENT_ALL;
+    ctxt->whitespace = SAXML_WHITESPACE_PRESERVE;
+    ctxt->bValidateUtf8 = 0;
+    ctxt->pfnAscii = scan_SelectAsciiHandler();
+    ctxt->utf8Validated = NULL;
+    encoding_Utf8Reset(&ctxt->utf8);
+    encoding_Utf16Reset(&ctxt->utf16);
+    ctxt->token = NULL;
+    ctxt->bTokenReady = 0;
+    ctxt->lastTokenType = SAXML_TOKEN_NONE;
+    ctxt->inputStart = NULL;
+    ctxt->input = NULL;
+    ctxt->inputEnd = NULL;
+    #if defined(SAXML_ENABLE_STATS)
+    memset(&ctxt->stats, 0, sizeof(ctxt->stats));
+    ctxt->statsDepth = 0;
+    #endif
+    ctxt->state = STATE_BEGIN;
+    ContextBufferClear(ctxt);
+    ContextUpdateEvents(ctxt);
+
+    return ctxt;
+}
+
+tSaxmlParser saxml_InitializeInPlace(void *storage, const size_t storageSize,
+    tSaxmlContext *context, const uint32_t maxStringSize)
+{
+    tParserContext *ctxt;
+
+    if(maxStringSize < SAXML_MIN_STRING_SIZE)
+        return NULL;
+    if(NULL == context || NULL == storage)
+        return NULL;
+    if(storageSize < saxml_StorageSize(maxStringSize))
+        return NULL;
+
+    ctxt = ContextInitialize(storage, context, maxStringSize);
+    ctxt->buffer = (char *) (ctxt + 1);
+    ctxt->pool = NULL;
+    return (tSaxmlParser) ctxt;
+}
+
+tSaxmlParser saxml_Initialize(tSaxmlContext *context, const uint32_t maxStringSize)
+{
+    #ifdef SAXML_NO_MALLOC
+    UNUSED(context);
+    UNUSED(maxStringSize);
+    return NULL; /* saxml_InitializeInPlace must be used */
+    #else
+    tParserContext *ctxt;
+    void *storage;
+    size_t storageSize = saxml_StorageSize(maxStringSize);
+
+    /* malloc'd memory is always suitably aligned, so there will be no padding */
+    storage = malloc(storageSize);
+    if(NULL == storage)
+        return NULL;
+
+    ctxt = (tParserContext *) saxml_InitializeInPlace(storage, storageSize, context, maxStringSize);
+    if(NULL == ctxt)
+    {
+        free(storage);
+        return NULL;
+    }
+    ctxt->bOwnsStorage = 1;
+
+    return (tSaxmlParser) ctxt;
+    #endif
+}
+
+size_t saxml_PooledStorageSize(void)
+{
+    return (STORAGE_ALIGNMENT - 1) + sizeof(tParserContext);
+}
+
+tSaxmlParser saxml_InitializePooledInPlace(void *storage, const size_t storageSize,
+    tSaxmlContext *context, tSaxmlPool pool)
+{
+    tParserContext *ctxt;
+
+    if(NULL == context || NULL == storage || NULL == pool)
+        return NULL;
+    if(storageSize < saxml_PooledStorageSize())
+        return NULL;
+
+    ctxt = ContextInitialize(storage, context, pool_BufferSize(pool));
+    ctxt->buffer = NULL; /* borrowed once needed */
+    ctxt->pool = pool;
+    return (tSaxmlParser) ctxt;
+}
+
+tSaxmlParser saxml_InitializePooled(tSaxmlContext *context, tSaxmlPool pool)
+{
+    #ifdef SAXML_NO_MALLOC
+    UNUSED(context);
+    UNUSED(pool);
+    return NULL; /* saxml_InitializePooledInPlace must be used */
+    #else
+    tParserContext *ctxt;
+    void *storage;
+    size_t storageSize = saxml_PooledStorageSize();
+
+    storage = malloc(storageSize);
+    if(NULL == storage)
+        return NULL;
+
+    ctxt = (tParserContext *) saxml_InitializePooledInPlace(storage, storageSize, context, pool);
+    if(NULL == ctxt)
+    {
+        free(storage);
+        return NULL;
+    }
+    ctxt->bOwnsStorage = 1;
+
+    return (tSaxmlParser) ctxt;
+    #endif
+}
+
+void saxml_Deinitialize(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    if(NULL == ctxt)
+        return;
+
+    /* A pooled parser may be part-way through a token */
+    if(NULL != ctxt->pool && NULL != ctxt->buffer)
+        pool_Return(ctxt->pool, ctxt->buffer);
+    #ifndef SAXML_NO_MALLOC
+    if(ctxt->bOwnsStorage)
+        free(ctxt);
+    #endif
+}
+
+int saxml_HandleCharacter(tSaxmlParser parser, const char character)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    uint16_t transition = g_transitions[ctxt->state][g_characterClass[(uint8_t) character]];
+
+    /* Handle the most common actions here, rather than setting up a call to the engine. When
+       time within the parser is measured, every character goes through the engine instead, as
+       does any which may be part of a multi-byte sequence when validating UTF-8. */
+    #if defined(SAXML_ENABLE_STATS_TIMING)
+    UNUSED(transition);
+    #else
+    if(!ctxt->bValidateUtf8 || ((uint8_t) character < 0x80 && 0 == ctxt->utf8.needed))
+    {
+        switch(TRANSITION_ACTION(transition))
+        {
+            case ACTION_NONE: case ACTION_SEEK:
+                STATS_ADD(ctxt, bytes, 1)
+                return 0;
+            case ACTION_ADD:
+                if(DISCARDING(ctxt, TRANSITION_STATE(transition)))
+                {
+                    ctxt->state = TRANSITION_STATE(transition);
+                    STATS_ADD(ctxt, bytes, 1)
+                    return 0;
+                }
+                if(ctxt->length < ctxt->maxStringSize - 2 && NULL != ctxt->buffer)
+                {
+                    ctxt->state = TRANSITION_STATE(transition);
+                    ctxt->buffer[ctxt->length] = character;
+                    ++(ctxt->length);
+                    STATS_ADD(ctxt, bytes, 1)
+                    return 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    #endif
+
+    return Parse(ctxt, &character, &character + 1, PARSE_COPY, NULL);
+}
+
+int saxml_HandleBuffer(tSaxmlParser parser, const char *buffer, const size_t length, size_t *offset)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *stop;
+    int result;
+
+    result = Parse(ctxt, buffer, buffer + length, PARSE_IN_PLACE, &stop);
+    if(NULL != offset)
+        *offset = (size_t) (stop - buffer);
+    return result;
+}
+
+/* UTF-16 is transcoded into a block on the stack at a time */
+#define UTF16_BLOCK_SIZE 512
+
+/* Offset within UTF-16 input of the character which was transcoded to the given offset within
+ *  its UTF-8 output, by transcoding it again from the same state */
+static size_t Utf16Offset(tUtf16State state, const int bBigEndian, const char *input,
+    const char *inputEnd, const size_t utf8Offset)
+{
+    const char * const start = input;
+    char scratch[ENCODING_MAX_UTF8];
+    char *out;
+    size_t transcoded = 0;
+
+    while(transcoded < utf8Offset && input < inputEnd)
+    {
+        out = scratch;
+        if(0 != encoding_Utf16ToUtf8(&state, bBigEndian, &input, inputEnd, &out,
+                    scratch + sizeof(scratch)))
+            break;
+        transcoded += (size_t) (out - scratch);
+    }
+    return (size_t) (input - start);
+}
+
+int saxml_HandleBufferUtf16(tSaxmlParser parser, const char *buffer, const size_t length,
+    const int byteOrder, size_t *offset)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const int bBigEndian = (SAXML_UTF16_BE == byteOrder);
+    char block[UTF16_BLOCK_SIZE];
+    const char *input = buffer;
+    const char *end = buffer + length;
+    const char *blockInput;
+    const char *stop;
+    char *out;
+    tUtf16State blockState;
+    int result = 0, encodingResult = 0;
+
+    while(0 == result && 0 == encodingResult && input < end)
+    {
+        blockInput = input;
+        blockState = ctxt->utf16;
+        out = block;
+        encodingResult = encoding_Utf16ToUtf8(&ctxt->utf16, bBigEndian, &input, end, &out,
+            block + sizeof(block));
+
+        /* The transcoded input is valid UTF-8, so isn't validated again */
+        result = RunEngine(ctxt, block, out, PARSE_IN_PLACE, &stop);
+        if(0 != result)
+        {
+            input = blockInput + Utf16Offset(blockState, bBigEndian, blockInput, end,
+                (size_t) (stop - block));
+        }
+    }
+    if(0 == result && 0 != encodingResult)
+    {
+        DBG1("[saxml] Unpaired surrogate at %lu\n", (unsigned long) (input - buffer));
+        STATS_ADD(ctxt, errors, 1)
+        result = encodingResult;
+    }
+
+    if(NULL != offset)
+        *offset = (size_t) (input - buffer);
+    return result;
+}
+
+void saxml_Reset(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->state = STATE_BEGIN;
+    ContextBufferClear(ctxt);
+    parser_ReleaseBuffer(ctxt);
+    ctxt->stackUsed = 0;
+    ctxt->depth = 0;
+    ctxt->matchDepth = 0;
+    ctxt->bDiscard = (ctxt->subscriptionCount > 0);
+    ctxt->bSkipRequested = 0;
+    ctxt->bFragmented = 0;
+    ctxt->markupMatched = 0;
+    ctxt->documentDepth = 0;
+    ctxt->utf8Validated = NULL;
+    encoding_Utf8Reset(&ctxt->utf8);
+    encoding_Utf16Reset(&ctxt->utf16);
+    #if defined(SAXML_ENABLE_STATS)
+    ctxt->statsDepth = 0;
+    #endif
+}
+
+void saxml_SetSpanHandlers(tSaxmlParser parser, const tSaxmlSpanContext *handlers)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->spans = handlers;
+}
+
+void saxml_SetAttributesHandler(tSaxmlParser parser, pfnAttributesHandler handler)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->pfnAttributes = handler;
+}
+
+void saxml_SetFragmentHandlers(tSaxmlParser parser, const tSaxmlFragmentContext *handlers)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->fragments = handlers;
+}
+
+void saxml_SetDocumentHandlers(tSaxmlParser parser, const tSaxmlDocumentContext *handlers)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    if(ctxt->user != &ctxt->pullContext)
+        ctxt->documents = handlers;
+}
+
+void saxml_SetIdHandlers(tSaxmlParser parser, const tSaxmlVocabulary vocabulary,
+    const tSaxmlIdContext *handlers)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->vocabulary = vocabulary;
+    ctxt->ids = handlers;
+}
+
+void saxml_SetElementStack(tSaxmlParser parser, void *storage, const size_t storageSize)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->stack = (0 == storageSize) ? NULL : (char *) storage;
+    ctxt->stackSize = storageSize;
+    ctxt->stackUsed = 0;
+    ctxt->depth = 0;
+    ctxt->matchDepth = 0;
+    ctxt->bDiscard = (ctxt->subscriptionCount > 0);
+}
+
+uint32_t saxml_GetDepth(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    return ctxt->depth;
+}
+
+int saxml_Subscribe(tSaxmlParser parser, const char *pattern)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *c;
+
+    if(NULL == pattern)
+    {
+        ctxt->subscriptionCount = 0;
+        ctxt->matchDepth = 0;
+        ctxt->bDiscard = 0;
+        return 0;
+    }
+
+    /* A pattern is one or more '/'- or '//'-separated names, which may be '*' */
+    if('/' != pattern[0])
+        return SAXML_ERROR_SYNTAX;
+    for(c = pattern; '\0' != *c; ++c)
+    {
+        if('/' != *c)
+            continue;
+        if('/' == c[1])
+            ++c;
+        if('\0' == c[1] || '/' == c[1])
+            return SAXML_ERROR_SYNTAX;
+    }
+    if(NULL == ctxt->stack || ctxt->subscriptionCount >= SAXML_MAX_SUBSCRIPTIONS)
+        return SAXML_ERROR_BUFFER_OVERFLOW;
+
+    ctxt->subscriptions[ctxt->subscriptionCount++] = pattern;
+    ctxt->bDiscard = (0 == ctxt->matchDepth);
+    return 0;
+}
+
+void saxml_SkipCurrentElement(tSaxmlParser parser)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->bSkipRequested = 1;
+}
+
+int saxml_GetStats(tSaxmlParser parser, tSaxmlStats *stats)
+{
+    #if defined(SAXML_ENABLE_STATS)
+    tParserContext *ctxt = (tParserContext *) parser;
+    *stats = ctxt->stats;
+    stats->maxStringSize = ctxt->maxStringSize;
+    return 1;
+    #else
+    UNUSED(parser);
+    memset(stats, 0, sizeof(*stats));
+    return 0;
+    #endif
+}
+
+void saxml_AllowTruncatedStrings(tSaxmlParser parser, const int allow)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->bAllowTruncatedStrings = (allow) ? 1 : 0;
+}
+
+void saxml_EnableUtf8Validation(tSaxmlParser parser, const int enable)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->bValidateUtf8 = (enable) ? 1 : 0;
+    ctxt->utf8Validated = NULL;
+    encoding_Utf8Reset(&ctxt->utf8);
+}
+
+void saxml_SetEventMask(tSaxmlParser parser, const uint32_t mask)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->eventMask = (uint8_t) (mask & SAXML_EVENT_ALL);
+    ContextUpdateEvents(ctxt);
+}
+
+void saxml_SetWhitespacePolicy(tSaxmlParser parser, const int policy)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->whitespace = (uint8_t) policy;
+}
+
+void saxml_EnableReferenceDecoding(tSaxmlParser parser, const int enable)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    ctxt->bDecodeReferences = (enable) ? 1 : 0;
+    ctxt->scanSets = (enable) ? g_scanSetsReferences : g_scanSets;
 }
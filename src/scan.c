@@ -0,0 +1,138 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Delimiter scanning kernels
+ */
+#include "scan.h"
+
+#if !defined(SAXML_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   #define SCAN_X86
+   #include <immintrin.h>
+#endif
+
+#define SCAN_IS_DELIMITER(set, c) \
+    ((set)->bitmap[((uint8_t) (c)) >> 3] & (1 << (((uint8_t) (c)) & 7)))
+
+const char *scan_Scalar(const char *position, const char *end, const tScanSet *set)
+{
+    while(position < end && !SCAN_IS_DELIMITER(set, *position))
+        ++position;
+    return position;
+}
+
+static const char *scan_AsciiScalar(const char *position, const char *end)
+{
+    while(position < end && 0 == (*position & 0x80))
+        ++position;
+    return position;
+}
+
+#if defined(SCAN_X86)
+
+__attribute__((target("sse2")))
+static const char *scan_SSE2(const char *position, const char *end, const tScanSet *set)
+{
+    __m128i needles[SCAN_MAX_DELIMITERS];
+    __m128i block, matches;
+    uint32_t i, mask;
+
+    for(i = 0; i < set->count; ++i)
+        needles[i] = _mm_set1_epi8(set->delimiters[i]);
+
+    while(end - position >= 16)
+    {
+        block = _mm_loadu_si128((const __m128i *) position);
+        matches = _mm_cmpeq_epi8(block, needles[0]);
+        for(i = 1; i < set->count; ++i)
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, needles[i]));
+        mask = (uint32_t) _mm_movemask_epi8(matches);
+        if(0 != mask)
+            return position + __builtin_ctz(mask);
+        position += 16;
+    }
+
+    return scan_Scalar(position, end, set);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_AVX2(const char *position, const char *end, const tScanSet *set)
+{
+    __m256i needles[SCAN_MAX_DELIMITERS];
+    __m256i block, matches;
+    uint32_t i, mask;
+
+    for(i = 0; i < set->count; ++i)
+        needles[i] = _mm256_set1_epi8(set->delimiters[i]);
+
+    while(end - position >= 32)
+    {
+        block = _mm256_loadu_si256((const __m256i *) position);
+        matches = _mm256_cmpeq_epi8(block, needles[0]);
+        for(i = 1; i < set->count; ++i)
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, needles[i]));
+        mask = (uint32_t) _mm256_movemask_epi8(matches);
+        if(0 != mask)
+            return position + __builtin_ctz(mask);
+        position += 32;
+    }
+
+    return scan_SSE2(position, end, set);
+}
+
+/* The high bit of each character is all that's needed, and movemask extracts exactly that */
+__attribute__((target("sse2")))
+static const char *scan_AsciiSSE2(const char *position, const char *end)
+{
+    uint32_t mask;
+
+    while(end - position >= 16)
+    {
+        mask = (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) position));
+        if(0 != mask)
+            return position + __builtin_ctz(mask);
+        position += 16;
+    }
+
+    return scan_AsciiScalar(position, end);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_AsciiAVX2(const char *position, const char *end)
+{
+    uint32_t mask;
+
+    while(end - position >= 32)
+    {
+        mask = (uint32_t) _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *) position));
+        if(0 != mask)
+            return position + __builtin_ctz(mask);
+        position += 32;
+    }
+
+    return scan_AsciiSSE2(position, end);
+}
+
+#endif /* SCAN_X86 */
+
+pfnScanHandler scan_SelectHandler(void)
+{
+#if defined(SCAN_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return scan_AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return scan_SSE2;
+#endif
+    return scan_Scalar;
+}
+
+pfnAsciiHandler scan_SelectAsciiHandler(void)
+{
+#if defined(SCAN_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return scan_AsciiAVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return scan_AsciiSSE2;
+#endif
+    return scan_AsciiScalar;
+}
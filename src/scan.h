@@ -0,0 +1,42 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Delimiter scanning kernels
+ */
+#ifndef SAXML_SCAN_H
+#define SAXML_SCAN_H
+
+#include <stdint.h>
+
+#define SCAN_MAX_DELIMITERS 8
+
+/* Shorter runs than this aren't worth the setup cost of a vector kernel */
+#define SCAN_MIN_VECTOR_LENGTH 16
+
+/* A set of characters which end a run of otherwise uninteresting characters. The
+ *  delimiter list is used by the vector kernels, the bitmap (bit (c & 7) of byte (c >> 3))
+ *  by the scalar kernel. */
+typedef struct
+{
+    uint32_t count;
+    char delimiters[SCAN_MAX_DELIMITERS];
+    uint8_t bitmap[32];
+} tScanSet;
+
+/* Returns a pointer to the first character in [position, end) which is a member of set,
+ *  or end if there is none */
+typedef const char *(*pfnScanHandler)(const char *position, const char *end, const tScanSet *set);
+
+/* Select the fastest scanning kernel supported by the processor we're running on */
+pfnScanHandler scan_SelectHandler(void);
+
+/* Portable kernel, also used to finish the tail of a buffer in the vector kernels */
+const char *scan_Scalar(const char *position, const char *end, const tScanSet *set);
+
+/* Returns a pointer to the first character in [position, end) which isn't ASCII (with its
+ *  high bit set), or end if there is none */
+typedef const char *(*pfnAsciiHandler)(const char *position, const char *end);
+
+/* Select the fastest ASCII scanning kernel supported by the processor we're running on */
+pfnAsciiHandler scan_SelectAsciiHandler(void);
+
+#endif /* SAXML_SCAN_H */
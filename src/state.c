@@ -0,0 +1,230 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Saving and restoring a parser's state, so that parsing of a stream can be resumed
+ */
+#include "saxml/saxml.h"
+#include "parser.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* memcpy */
+
+/* The saved state is a header, followed by the partial reference, the partial token and the
+ *  element stack. Integers are little-endian, so that a state may be restored on a different
+ *  platform. Any change to the layout (or to the parser states) needs a new version. */
+#define STATE_MAGIC_0   'S'
+#define STATE_MAGIC_1   'X'
+#define STATE_VERSION   3
+#define STATE_HEADER_SIZE 44
+
+/* Flags */
+#define STATE_FRAGMENTED     0x01
+#define STATE_DISCARD        0x02
+#define STATE_SKIP_REQUESTED 0x04
+#define STATE_UTF16_PENDING  0x08
+
+static uint8_t *PutUint32(uint8_t *p, const uint32_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+    return p + 4;
+}
+
+static const uint8_t *GetUint32(const uint8_t *p, uint32_t *value)
+{
+    *value = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+        | ((uint32_t) p[3] << 24);
+    return p + 4;
+}
+
+/* Most characters of a markup keyword or terminator which can have been matched in a state */
+static uint8_t MarkupLimit(const uint8_t state)
+{
+    switch(state)
+    {
+        case STATE_CDATA_OPEN: return 5; /* of "CDATA[", which once matched is reset */
+        case STATE_COMMENT: return 2;    /* "--" */
+        case STATE_CDATA: return 2;      /* "]]" */
+        case STATE_PI: return 1;         /* "?" */
+        default: return 0;
+    }
+}
+
+/* True if a state is within an element being skipped; markup returns to markupState */
+static int Skipping(const uint8_t state, const uint8_t markupState)
+{
+    if(state >= STATE_DECLARATION)
+        return markupState >= STATE_SKIP_OWN_TAG && markupState <= STATE_SKIP_END_TAG;
+    return state >= STATE_SKIP_OWN_TAG && state <= STATE_SKIP_END_TAG;
+}
+
+/* True if a saved element stack holds depth names, each NUL-terminated */
+static int StackConsistent(const uint8_t *stack, const uint32_t stackUsed, const uint32_t depth)
+{
+    uint32_t i, names = 0;
+
+    if(stackUsed > 0 && '\0' != stack[stackUsed - 1])
+        return 0;
+    for(i = 0; i < stackUsed; ++i)
+    {
+        if('\0' == stack[i])
+            ++names;
+    }
+    return names == depth;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+size_t saxml_SaveState(tSaxmlParser parser, void *state, const size_t stateSize)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const char *token = ctxt->buffer;
+    size_t tokenLength = ctxt->length;
+    uint8_t referenceLength = 0;
+    size_t size;
+    uint8_t *p = (uint8_t *) state;
+
+    /* A pull parser's token may still be tracked within the fed buffer */
+    if(ctxt->spanLength > 0)
+    {
+        token = ctxt->spanStart;
+        tokenLength = ctxt->spanLength;
+    }
+
+    /* The partial reference is only meaningful while one is being decoded */
+    if(STATE_REFERENCE == ctxt->state)
+        referenceLength = ctxt->referenceLength;
+
+    size = STATE_HEADER_SIZE + referenceLength + tokenLength + ctxt->stackUsed;
+    if(NULL == state || stateSize < size)
+        return size;
+
+    *p++ = STATE_MAGIC_0;
+    *p++ = STATE_MAGIC_1;
+    *p++ = STATE_VERSION;
+    *p++ = (uint8_t) ((ctxt->bFragmented ? STATE_FRAGMENTED : 0)
+        | (ctxt->bDiscard ? STATE_DISCARD : 0)
+        | (ctxt->bSkipRequested ? STATE_SKIP_REQUESTED : 0)
+        | (ctxt->utf16.bPending ? STATE_UTF16_PENDING : 0));
+    *p++ = ctxt->state;
+    *p++ = ctxt->referenceState;
+    *p++ = referenceLength;
+    *p++ = ctxt->markupState;
+    *p++ = ctxt->markupMatched;
+    *p++ = (uint8_t) ctxt->lastTokenType;
+    p = PutUint32(p, (uint32_t) tokenLength);
+    p = PutUint32(p, (uint32_t) ctxt->stackUsed);
+    p = PutUint32(p, ctxt->depth);
+    p = PutUint32(p, ctxt->matchDepth);
+    p = PutUint32(p, ctxt->skipDepth);
+    p = PutUint32(p, ctxt->documentDepth);
+    p = PutUint32(p, ctxt->documentCount);
+    *p++ = ctxt->utf8.needed;
+    *p++ = ctxt->utf8.lower;
+    *p++ = ctxt->utf8.upper;
+    *p++ = ctxt->utf16.pending;
+    *p++ = (uint8_t) ctxt->utf16.surrogate;
+    *p++ = (uint8_t) (ctxt->utf16.surrogate >> 8);
+
+    memcpy(p, ctxt->reference, referenceLength);
+    p += referenceLength;
+    if(tokenLength > 0)
+        memcpy(p, token, tokenLength);
+    p += tokenLength;
+    if(ctxt->stackUsed > 0)
+        memcpy(p, ctxt->stack, ctxt->stackUsed);
+
+    return size;
+}
+
+int saxml_RestoreState(tSaxmlParser parser, const void *state, const size_t stateSize)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const uint8_t *p = (const uint8_t *) state;
+    uint32_t tokenLength, stackUsed, depth, matchDepth, skipDepth, documentDepth, documentCount;
+    uint8_t flags;
+
+    if(NULL == state || stateSize < STATE_HEADER_SIZE || STATE_MAGIC_0 != p[0]
+       || STATE_MAGIC_1 != p[1] || STATE_VERSION != p[2])
+    {
+        return SAXML_ERROR_STATE;
+    }
+    GetUint32(&p[10], &tokenLength);
+    GetUint32(&p[14], &stackUsed);
+    GetUint32(&p[18], &depth);
+    GetUint32(&p[22], &matchDepth);
+    GetUint32(&p[26], &skipDepth);
+    GetUint32(&p[30], &documentDepth);
+    GetUint32(&p[34], &documentCount);
+
+    /* Everything must be consistent, and fit within this parser */
+    if(p[4] >= STATE_COUNT || p[5] >= STATE_COUNT || p[7] >= STATE_COUNT
+       || p[6] > REFERENCE_MAX_LENGTH || p[9] > SAXML_TOKEN_ATTRIBUTE
+       || tokenLength > ctxt->maxStringSize - 2
+       || stateSize != STATE_HEADER_SIZE + (size_t) p[6] + tokenLength + stackUsed
+       || stackUsed > ctxt->stackSize || (stackUsed > 0 && NULL == ctxt->stack)
+       || matchDepth > depth || p[38] > 3 || p[8] > MarkupLimit(p[4]))
+    {
+        return SAXML_ERROR_STATE;
+    }
+
+    /* The element stack holds depth names. While skipping, the element being skipped is open
+       (and with a stack, it's on it; nested ones aren't pushed). A document's elements are
+       all on the stack. */
+    if(!StackConsistent(&p[STATE_HEADER_SIZE + p[6] + tokenLength], stackUsed, depth)
+       || (Skipping(p[4], p[7]) && (0 == skipDepth || (NULL != ctxt->stack && 0 == depth)))
+       || (NULL != ctxt->stack && NULL != ctxt->documents && documentDepth != depth))
+    {
+        return SAXML_ERROR_STATE;
+    }
+
+    /* A pooled parser needs a buffer for the partial token */
+    if(tokenLength > 0 && !parser_AcquireBuffer(ctxt))
+        return SAXML_ERROR_POOL;
+
+    flags = p[3];
+    ctxt->bFragmented = (flags & STATE_FRAGMENTED) ? 1 : 0;
+    ctxt->bDiscard = (flags & STATE_DISCARD) ? 1 : 0;
+    ctxt->bSkipRequested = (flags & STATE_SKIP_REQUESTED) ? 1 : 0;
+    ctxt->state = p[4];
+    ctxt->referenceState = p[5];
+    ctxt->referenceLength = p[6];
+    ctxt->markupState = p[7];
+    ctxt->markupMatched = p[8];
+    ctxt->lastTokenType = p[9];
+    ctxt->depth = depth;
+    ctxt->matchDepth = matchDepth;
+    ctxt->skipDepth = skipDepth;
+    ctxt->documentDepth = documentDepth;
+    ctxt->documentCount = documentCount;
+    ctxt->utf8.needed = p[38];
+    ctxt->utf8.lower = p[39];
+    ctxt->utf8.upper = p[40];
+    ctxt->utf16.bPending = (flags & STATE_UTF16_PENDING) ? 1 : 0;
+    ctxt->utf16.pending = p[41];
+    ctxt->utf16.surrogate = (uint16_t) (p[42] | (p[43] << 8));
+    ctxt->utf8Validated = NULL;
+    p += STATE_HEADER_SIZE;
+
+    memcpy(ctxt->reference, p, ctxt->referenceLength);
+    p += ctxt->referenceLength;
+    if(tokenLength > 0)
+        memcpy(ctxt->buffer, p, tokenLength);
+    ctxt->length = tokenLength;
+    parser_ReleaseBuffer(ctxt);
+    ctxt->spanStart = NULL;
+    ctxt->spanLength = 0;
+    p += tokenLength;
+    if(stackUsed > 0)
+        memcpy(ctxt->stack, p, stackUsed);
+    ctxt->stackUsed = stackUsed;
+
+    /* Anything left of a previously fed buffer belongs to the old stream position */
+    ctxt->inputStart = NULL;
+    ctxt->input = NULL;
+    ctxt->inputEnd = NULL;
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Tapes: an index of every token in a document, built once and then replayed or walked
+ */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include "parser.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* memcpy */
+
+/* The tape is built by the parsing engine, with span handlers which record each token's
+ *  position in the document; the engine's vectorized delimiter scans do the work of finding
+ *  the structure. Entries are stored from the start of the caller's storage, and any strings
+ *  which aren't contiguous within the document (e.g. contents interrupted by a CDATA section)
+ *  from its end. While building, a tag's match is the index of the enclosing open tag, so
+ *  that the open tags form a list without any further storage. */
+
+#define TAPE_ALIGNMENT sizeof(uint32_t)
+
+typedef struct
+{
+    const char *document;
+    const char *documentEnd;
+    tSaxmlTapeEntry *entries;
+    size_t room;          /* bytes of storage */
+    uint32_t count;
+    size_t stringsLength; /* at the end of storage */
+    uint32_t open;        /* innermost open tag */
+    int bFull;
+} tTapeBuilder;
+
+static void TapeRecord(tTapeBuilder *builder, const uint8_t type, const char *data,
+    const size_t length)
+{
+    tSaxmlTapeEntry *entry;
+    uint32_t open = builder->open;
+    int bInPlace = (data >= builder->document && data + length <= builder->documentEnd);
+    size_t copied = 0;
+
+    /* An empty tag's end tag token is a placeholder (or a copy from the element stack), so
+       it's given the name from its tag instead. Once the storage is full, the open tags are
+       no longer known, so the size needed is an upper bound. */
+    if(!bInPlace && (SAXML_TOKEN_TAG_END != type || SAXML_TAPE_NONE == open || builder->bFull))
+        copied = length;
+
+    if(!builder->bFull && (builder->count + 1) * sizeof(tSaxmlTapeEntry)
+       + builder->stringsLength + copied > builder->room)
+    {
+        builder->bFull = 1;
+    }
+    builder->stringsLength += copied;
+    if(builder->bFull)
+    {
+        ++(builder->count);
+        return;
+    }
+
+    entry = &builder->entries[builder->count];
+    entry->type = type;
+    entry->flags = 0;
+    entry->offset = (uint32_t) (data - builder->document);
+    entry->length = (uint32_t) length;
+    entry->match = open;
+    if(copied > 0)
+    {
+        /* Offsets within the strings are from the end of storage until building is done */
+        memcpy((char *) builder->entries + builder->room - builder->stringsLength, data, copied);
+        entry->flags = SAXML_TAPE_COPIED;
+        entry->offset = (uint32_t) builder->stringsLength;
+    }
+
+    if(SAXML_TOKEN_TAG == type)
+        builder->open = builder->count;
+    else if(SAXML_TOKEN_TAG_END == type && SAXML_TAPE_NONE != open)
+    {
+        if(!bInPlace)
+        {
+            entry->flags = builder->entries[open].flags;
+            entry->offset = builder->entries[open].offset;
+            entry->length = builder->entries[open].length;
+        }
+        builder->open = builder->entries[open].match;
+        builder->entries[open].match = builder->count;
+    }
+    ++(builder->count);
+}
+
+static void TapeTag(void *cookie, const char *data, size_t length)
+    { TapeRecord((tTapeBuilder *) cookie, SAXML_TOKEN_TAG, data, length); }
+static void TapeTagEnd(void *cookie, const char *data, size_t length)
+    { TapeRecord((tTapeBuilder *) cookie, SAXML_TOKEN_TAG_END, data, length); }
+static void TapeContent(void *cookie, const char *data, size_t length)
+    { TapeRecord((tTapeBuilder *) cookie, SAXML_TOKEN_CONTENT, data, length); }
+static void TapeAttribute(void *cookie, const char *data, size_t length)
+    { TapeRecord((tTapeBuilder *) cookie, SAXML_TOKEN_ATTRIBUTE, data, length); }
+
+static const tSaxmlSpanContext g_tapeSpans = { TapeTag, TapeTagEnd, TapeContent, TapeAttribute };
+
+/* Deliver one entry's data to the span handler for its event if there is one, or to the
+ *  string handler otherwise */
+static int TapeEmit(tParserContext *ctxt, pfnStringHandler stringHandler,
+    pfnSpanHandler spanHandler, const char *data, size_t length)
+{
+    if(NULL != spanHandler)
+    {
+        STATS_HANDLER_BEGIN(ctxt)
+        spanHandler(ctxt->user->cookie, data, length);
+        STATS_HANDLER_END(ctxt)
+    }
+    else if(NULL != stringHandler)
+    {
+        if(length > ctxt->maxStringSize - 2)
+        {
+            if(!ctxt->bAllowTruncatedStrings)
+                return SAXML_ERROR_BUFFER_OVERFLOW;
+            STATS_ADD(ctxt, truncatedCharacters, length - (ctxt->maxStringSize - 2))
+            length = ctxt->maxStringSize - 2;
+        }
+        memcpy(ctxt->buffer, data, length);
+        ctxt->buffer[length] = '\0';
+        STATS_HANDLER_BEGIN(ctxt)
+        stringHandler(ctxt->user->cookie, ctxt->buffer);
+        STATS_HANDLER_END(ctxt)
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Exported Functions
+ */
+
+int saxml_BuildTape(tSaxmlParser parser, const char *buffer, const size_t length,
+    void *storage, const size_t storageSize, tSaxmlTape *tape, size_t *offset)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    tParserContext saved = *ctxt;
+    tSaxmlContext context;
+    tTapeBuilder builder;
+    size_t padding;
+    const char *stop = buffer + length;
+    char *strings;
+    uint32_t i;
+    int result;
+
+    padding = (TAPE_ALIGNMENT - ((size_t) storage % TAPE_ALIGNMENT)) % TAPE_ALIGNMENT;
+    builder.document = buffer;
+    builder.documentEnd = buffer + length;
+    builder.entries = (tSaxmlTapeEntry *) ((char *) storage + padding);
+    builder.room = (NULL == storage || storageSize < padding) ? 0 : storageSize - padding;
+    builder.count = 0;
+    builder.stringsLength = 0;
+    builder.open = SAXML_TAPE_NONE;
+    builder.bFull = 0;
+
+    /* Only the engine itself, and the truncation setting, are used; every token is recorded */
+    context.cookie = &builder;
+    context.tagHandler = NULL;
+    context.tagEndHandler = NULL;
+    context.parameterHandler = NULL;
+    context.contentHandler = NULL;
+    context.attributeHandler = NULL;
+    ctxt->user = &context;
+    ctxt->spans = &g_tapeSpans;
+    ctxt->pfnAttributes = NULL;
+    ctxt->ids = NULL;
+    ctxt->fragments = NULL;
+    ctxt->documents = NULL;
+    ctxt->stack = NULL;
+    ctxt->subscriptionCount = 0;
+    ctxt->bDecodeReferences = 0;
+    ctxt->eventMask = SAXML_EVENT_ALL;
+    ctxt->whitespace = SAXML_WHITESPACE_PRESERVE;
+    saxml_Reset(parser);
+
+    if(length > (size_t) SAXML_TAPE_NONE)
+    {
+        stop = buffer;
+        result = SAXML_ERROR_BUFFER_OVERFLOW;
+    }
+    else
+    {
+        result = parser_ParsePart(ctxt, buffer, buffer + length, &stop);
+        if(0 == result)
+            result = parser_EndParts(ctxt, &stop);
+        if(0 == result)
+            stop = buffer + length;
+        if(0 == result && ctxt->bValidateUtf8 && ctxt->utf8.needed > 0)
+            result = SAXML_ERROR_ENCODING; /* the document ends within a UTF-8 sequence */
+    }
+
+    ctxt->user = saved.user;
+    ctxt->spans = saved.spans;
+    ctxt->pfnAttributes = saved.pfnAttributes;
+    ctxt->ids = saved.ids;
+    ctxt->fragments = saved.fragments;
+    ctxt->documents = saved.documents;
+    ctxt->stack = saved.stack;
+    ctxt->subscriptionCount = saved.subscriptionCount;
+    ctxt->bDecodeReferences = saved.bDecodeReferences;
+    ctxt->eventMask = saved.eventMask;
+    ctxt->whitespace = saved.whitespace;
+    saxml_Reset(parser);
+
+    /* Tags which are still open have no end tag, rather than an enclosing tag */
+    while(!builder.bFull && SAXML_TAPE_NONE != builder.open)
+    {
+        i = builder.open;
+        builder.open = builder.entries[i].match;
+        builder.entries[i].match = SAXML_TAPE_NONE;
+    }
+
+    strings = (char *) builder.entries + builder.room - builder.stringsLength;
+    for(i = 0; !builder.bFull && i < builder.count; ++i)
+    {
+        if(builder.entries[i].flags & SAXML_TAPE_COPIED)
+            builder.entries[i].offset =
+                (uint32_t) (builder.stringsLength - builder.entries[i].offset);
+    }
+
+    tape->document = buffer;
+    tape->entries = builder.entries;
+    tape->count = builder.count;
+    tape->strings = strings;
+    tape->size = (TAPE_ALIGNMENT - 1) + builder.count * sizeof(tSaxmlTapeEntry)
+        + builder.stringsLength;
+    if(0 == result && builder.bFull)
+    {
+        tape->count = 0;
+        result = SAXML_ERROR_BUFFER_OVERFLOW;
+    }
+
+    if(NULL != offset)
+        *offset = (size_t) (stop - buffer);
+    return result;
+}
+
+int saxml_ReplayTape(tSaxmlParser parser, const tSaxmlTape *tape, const uint32_t first,
+    const uint32_t count)
+{
+    tParserContext *ctxt = (tParserContext *) parser;
+    const tSaxmlContext *user = ctxt->user;
+    const tSaxmlSpanContext *spans = ctxt->spans;
+    const tSaxmlTapeEntry *entry;
+    uint32_t i, last, tag;
+    int result = 0;
+
+    last = (first < tape->count && count < tape->count - first) ? first + count : tape->count;
+    if(first < last && !parser_AcquireBuffer(ctxt))
+        return SAXML_ERROR_POOL;
+    ctxt->bSkipRequested = 0;
+    for(i = first; i < last && 0 == result; ++i)
+    {
+        entry = &tape->entries[i];
+        switch(entry->type)
+        {
+            case SAXML_TOKEN_TAG:
+                result = TapeEmit(ctxt, user->tagHandler,
+                    (NULL == spans) ? NULL : spans->tagHandler,
+                    saxml_TapeData(tape, entry), entry->length);
+                break;
+            case SAXML_TOKEN_TAG_END:
+                result = TapeEmit(ctxt, user->tagEndHandler,
+                    (NULL == spans) ? NULL : spans->tagEndHandler,
+                    saxml_TapeData(tape, entry), entry->length);
+                ctxt->bSkipRequested = 0; /* the element has already ended */
+                break;
+            case SAXML_TOKEN_CONTENT:
+                result = TapeEmit(ctxt, user->contentHandler,
+                    (NULL == spans) ? NULL : spans->contentHandler,
+                    saxml_TapeData(tape, entry), entry->length);
+                break;
+            default:
+                result = TapeEmit(ctxt, user->attributeHandler,
+                    (NULL == spans) ? NULL : spans->attributeHandler,
+                    saxml_TapeData(tape, entry), entry->length);
+                break;
+        }
+
+        /* Continue from the end tag of the innermost element */
+        if(ctxt->bSkipRequested)
+        {
+            ctxt->bSkipRequested = 0;
+            tag = (SAXML_TOKEN_TAG == entry->type) ? i : entry->match;
+            if(SAXML_TAPE_NONE == tag)
+                continue;
+            if(SAXML_TAPE_NONE == tape->entries[tag].match)
+                break; /* the element doesn't end within the tape */
+            if(tape->entries[tag].match > i)
+                i = tape->entries[tag].match - 1;
+        }
+    }
+
+    parser_ReleaseBuffer(ctxt);
+    return result;
+}
+
+const char *saxml_TapeData(const tSaxmlTape *tape, const tSaxmlTapeEntry *entry)
+{
+    return ((entry->flags & SAXML_TAPE_COPIED) ? tape->strings : tape->document) + entry->offset;
+}
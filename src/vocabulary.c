@@ -0,0 +1,249 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Perfect hash of a fixed vocabulary of element and attribute names
+ */
+#include "saxml/saxml.h"
+#include "helpers.h"
+#include <stddef.h> /* for NULL */
+#include <string.h> /* strlen, memcmp */
+#ifndef SAXML_NO_MALLOC
+#include <stdlib.h> /* malloc and free */
+#endif
+
+/* The hash is built by hash-and-displace: names are first hashed into buckets of a few names
+ *  each, then each bucket (largest first) is assigned the displacement which places all of its
+ *  names in free slots. A lookup is a single hash of the name, two table reads, and one
+ *  comparison to reject names which aren't in the vocabulary. */
+#define VOCABULARY_MAX_BUCKET        8      /* names per bucket; more means a bad seed */
+#define VOCABULARY_MAX_DISPLACEMENT  0xFFFF
+#define VOCABULARY_MAX_SEEDS         32
+
+typedef struct
+{
+    const char * const *names;
+    uint32_t count;
+    uint32_t seed;
+    uint32_t bucketCount;
+    uint32_t slotMask;
+    int32_t *slots;            /* id of the name in each slot, or SAXML_UNKNOWN_ID */
+    uint32_t *lengths;         /* length of each name (its hash while building) */
+    uint16_t *displacements;   /* for each bucket */
+    uint8_t *bucketSizes;      /* only used while building */
+    int bOwnsStorage;          /* true if allocated by saxml_CreateVocabulary */
+} tVocabulary;
+
+typedef union
+{
+    void *p;
+    size_t s;
+    long l;
+    double d;
+} tStorageAlignment;
+#define STORAGE_ALIGNMENT sizeof(tStorageAlignment)
+
+/* Seeded FNV-1a */
+static uint32_t VocabularyHash(const uint32_t seed, const char *name, const size_t length)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    size_t i;
+
+    for(i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t) name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Slot for a name with the given hash, within a bucket with the given displacement */
+static uint32_t VocabularySlot(const tVocabulary *v, uint32_t hash, const uint32_t displacement)
+{
+    hash += displacement * 0x9E3779B9u;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash & v->slotMask;
+}
+
+static uint32_t VocabularySlotCount(const uint32_t count)
+{
+    uint32_t slots = 2;
+    while(slots < 2 * count)
+        slots <<= 1;
+    return slots;
+}
+
+#define VocabularyBucketCount(count) (((count) + 1) / 2 + 1)
+
+/* Attempt to build the hash with the current seed. Returns nonzero on success. */
+static int VocabularyBuild(tVocabulary *v)
+{
+    uint32_t ids[VOCABULARY_MAX_BUCKET];
+    uint32_t slots[VOCABULARY_MAX_BUCKET];
+    uint32_t i, j, k, bucket, size, maxSize = 0, displacement, found;
+
+    for(i = 0; i <= v->slotMask; ++i)
+        v->slots[i] = SAXML_UNKNOWN_ID;
+    for(i = 0; i < v->bucketCount; ++i)
+        v->bucketSizes[i] = 0;
+
+    for(i = 0; i < v->count; ++i)
+    {
+        v->lengths[i] = VocabularyHash(v->seed, v->names[i], strlen(v->names[i]));
+        bucket = v->lengths[i] % v->bucketCount;
+        if(v->bucketSizes[bucket] >= VOCABULARY_MAX_BUCKET)
+            return 0;
+        ++(v->bucketSizes[bucket]);
+        if(v->bucketSizes[bucket] > maxSize)
+            maxSize = v->bucketSizes[bucket];
+    }
+
+    for(size = maxSize; size > 0; --size)
+    {
+        for(bucket = 0; bucket < v->bucketCount; ++bucket)
+        {
+            if(v->bucketSizes[bucket] != size)
+                continue;
+
+            for(i = 0, found = 0; found < size; ++i)
+            {
+                if(v->lengths[i] % v->bucketCount != bucket)
+                    continue;
+                /* Names with the same hash (such as duplicates) can never be separated */
+                for(j = 0; j < found; ++j)
+                {
+                    if(v->lengths[ids[j]] == v->lengths[i])
+                        return 0;
+                }
+                ids[found++] = i;
+            }
+
+            for(displacement = 0; displacement <= VOCABULARY_MAX_DISPLACEMENT; ++displacement)
+            {
+                for(j = 0; j < size; ++j)
+                {
+                    slots[j] = VocabularySlot(v, v->lengths[ids[j]], displacement);
+                    if(SAXML_UNKNOWN_ID != v->slots[slots[j]])
+                        break;
+                    for(k = 0; k < j && slots[k] != slots[j]; ++k)
+                        ;
+                    if(k < j)
+                        break;
+                }
+                if(j == size)
+                    break;
+            }
+            if(displacement > VOCABULARY_MAX_DISPLACEMENT)
+                return 0;
+
+            v->displacements[bucket] = (uint16_t) displacement;
+            for(j = 0; j < size; ++j)
+                v->slots[slots[j]] = (int32_t) ids[j];
+        }
+    }
+
+    for(i = 0; i < v->count; ++i)
+        v->lengths[i] = (uint32_t) strlen(v->names[i]);
+    return 1;
+}
+
+size_t saxml_VocabularyStorageSize(const uint32_t count)
+{
+    return (STORAGE_ALIGNMENT - 1) + sizeof(tVocabulary)
+        + VocabularySlotCount(count) * sizeof(int32_t)
+        + count * sizeof(uint32_t)
+        + VocabularyBucketCount(count) * (sizeof(uint16_t) + sizeof(uint8_t));
+}
+
+tSaxmlVocabulary saxml_CreateVocabularyInPlace(void *storage, const size_t storageSize,
+    const char * const *names, const uint32_t count)
+{
+    tVocabulary *v;
+    size_t padding;
+
+    if(NULL == storage || (NULL == names && count > 0))
+        return NULL;
+    if(count > INT32_MAX || storageSize < saxml_VocabularyStorageSize(count))
+        return NULL;
+
+    padding = (STORAGE_ALIGNMENT - ((size_t) storage % STORAGE_ALIGNMENT)) % STORAGE_ALIGNMENT;
+    v = (tVocabulary *) ((char *) storage + padding);
+    v->names = names;
+    v->count = count;
+    v->bucketCount = VocabularyBucketCount(count);
+    v->slotMask = VocabularySlotCount(count) - 1;
+    v->slots = (int32_t *) (v + 1);
+    v->lengths = (uint32_t *) (v->slots + v->slotMask + 1);
+    v->displacements = (uint16_t *) (v->lengths + count);
+    v->bucketSizes = (uint8_t *) (v->displacements + v->bucketCount);
+    v->bOwnsStorage = 0;
+
+    for(v->seed = 0; v->seed < VOCABULARY_MAX_SEEDS; ++(v->seed))
+    {
+        if(VocabularyBuild(v))
+            return (tSaxmlVocabulary) v;
+    }
+
+    DBG("[saxml] Failed to build vocabulary (duplicate names?)\n");
+    return NULL;
+}
+
+tSaxmlVocabulary saxml_CreateVocabulary(const char * const *names, const uint32_t count)
+{
+    #ifdef SAXML_NO_MALLOC
+    UNUSED(names);
+    UNUSED(count);
+    return NULL; /* saxml_CreateVocabularyInPlace must be used */
+    #else
+    tVocabulary *v;
+    void *storage;
+    size_t storageSize = saxml_VocabularyStorageSize(count);
+
+    storage = malloc(storageSize);
+    if(NULL == storage)
+        return NULL;
+
+    v = (tVocabulary *) saxml_CreateVocabularyInPlace(storage, storageSize, names, count);
+    if(NULL == v)
+    {
+        free(storage);
+        return NULL;
+    }
+    v->bOwnsStorage = 1;
+
+    return (tSaxmlVocabulary) v;
+    #endif
+}
+
+void saxml_DestroyVocabulary(tSaxmlVocabulary vocabulary)
+{
+    #ifndef SAXML_NO_MALLOC
+    tVocabulary *v = (tVocabulary *) vocabulary;
+    if(NULL != v && v->bOwnsStorage)
+        free(v);
+    #else
+    UNUSED(vocabulary);
+    #endif
+}
+
+int32_t saxml_VocabularyLookup(const tSaxmlVocabulary vocabulary, const char *name,
+    const size_t length)
+{
+    const tVocabulary *v = (const tVocabulary *) vocabulary;
+    uint32_t hash;
+    int32_t id;
+
+    if(NULL == v || 0 == v->count)
+        return SAXML_UNKNOWN_ID;
+
+    hash = VocabularyHash(v->seed, name, length);
+    id = v->slots[VocabularySlot(v, hash, v->displacements[hash % v->bucketCount])];
+    if(SAXML_UNKNOWN_ID != id && v->lengths[id] == length
+        && memcmp(v->names[id], name, length) == 0)
+    {
+        return id;
+    }
+    return SAXML_UNKNOWN_ID;
+}
@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 
 #define UNUSED(x) (void)x;
@@ -16,18 +17,47 @@
 static char *resultBuffer = NULL;
 static uint32_t resultLength = 0;
 
-typedef void (*pfnPrintHandler)(const char *event, const char *param);
-static void print_console(const char *event, const char *param)
+/* Events as printed, to check the parser's statistics against */
+static tSaxmlStats printed;
+
+static void CountEvent(const char *event)
+{
+   if(strcmp(event, "tagHandler") == 0)
+      ++printed.tags;
+   else if(strcmp(event, "tagEndHandler") == 0)
+      ++printed.tagEnds;
+   else if(strcmp(event, "contentHandler") == 0)
+      ++printed.contents;
+   else if(strcmp(event, "attributeHandler") == 0)
+      ++printed.attributes;
+}
+
+typedef void (*pfnPrintHandler)(const char *event, const char *param, size_t paramLength);
+static void print_console(const char *event, const char *param, size_t paramLength)
 {
-   printf("%s: '%s'\n", event, param);
+   CountEvent(event);
+   printf("%s: '%.*s'\n", event, (int) paramLength, param);
 }
-static void print_buffer(const char *event, const char *param)
+static void print_buffer(const char *event, const char *param, size_t paramLength)
 {
-   uint32_t length = resultLength + strlen(event) + strlen(param) + 6;
+   uint32_t length = resultLength + strlen(event) + paramLength + 6;
+   CountEvent(event);
    resultBuffer = realloc(resultBuffer, length);
-   resultLength += sprintf(&resultBuffer[resultLength], "%s: '%s'\n", event, param);
+   resultLength += sprintf(&resultBuffer[resultLength], "%s: '%.*s'\n", event, (int) paramLength, param);
 }
 static pfnPrintHandler PRINT = print_console;
+static int decode_references = 0;
+static tSaxmlParser parser = NULL;
+static const char *skip_name = NULL;
+static int checkpoint = 0;
+static size_t error_offset = (size_t) -1; /* of an error, where the parsing method reports it */
+
+/* Skip the rest of each element with the given name */
+static void CheckSkip(const char *name, size_t length)
+{
+    if(NULL != skip_name && strlen(skip_name) == length && memcmp(skip_name, name, length) == 0)
+        saxml_SkipCurrentElement(parser);
+}
 
 static char *LoadFile(const char *filename)
 {
@@ -61,31 +91,202 @@ static char *LoadFile(const char *filename)
 static void HandleTag(void *cookie, const char *szString)
 {
     UNUSED(cookie);
-    PRINT("tagHandler", szString);
+    PRINT("tagHandler", szString, strlen(szString));
+    CheckSkip(szString, strlen(szString));
 }
 
 static void HandleTagEnd(void *cookie, const char *szString)
 {
     UNUSED(cookie);
-    PRINT("tagEndHandler", szString);
+    PRINT("tagEndHandler", szString, strlen(szString));
 }
 
 static void HandleParameter(void *cookie, const char *szString)
 {
     UNUSED(cookie);
-    PRINT("parameterHandler", szString);
+    PRINT("parameterHandler", szString, strlen(szString));
 }
 
 static void HandleContent(void *cookie, const char *szString)
 {
     UNUSED(cookie);
-    PRINT("contentHandler", szString);
+    PRINT("contentHandler", szString, strlen(szString));
 }
 
 static void HandleAttribute(void *cookie, const char *szString)
 {
     UNUSED(cookie);
-    PRINT("attributeHandler", szString);
+    PRINT("attributeHandler", szString, strlen(szString));
+}
+
+static void HandleTagSpan(void *cookie, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    PRINT("tagHandler", data, length);
+    CheckSkip(data, length);
+}
+
+static void HandleTagEndSpan(void *cookie, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    PRINT("tagEndHandler", data, length);
+}
+
+static void HandleContentSpan(void *cookie, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    PRINT("contentHandler", data, length);
+}
+
+static void HandleAttributeSpan(void *cookie, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    PRINT("attributeHandler", data, length);
+}
+
+static void HandleDocumentStart(void *cookie, uint32_t index)
+{
+    char text[16];
+    UNUSED(cookie);
+    PRINT("documentStart", text, sprintf(text, "%lu", (unsigned long) index));
+}
+
+static void HandleDocumentEnd(void *cookie, uint32_t index)
+{
+    char text[16];
+    UNUSED(cookie);
+    PRINT("documentEnd", text, sprintf(text, "%lu", (unsigned long) index));
+}
+
+/* Fragments are reassembled, so that the output matches that of the other handlers */
+static char fragment[4096];
+static size_t fragment_length = 0;
+
+static void AddFragment(const char *event, const char *data, size_t length, int more)
+{
+    if(length > sizeof(fragment) - fragment_length)
+        length = sizeof(fragment) - fragment_length;
+    memcpy(&fragment[fragment_length], data, length);
+    fragment_length += length;
+    if(!more)
+    {
+        PRINT(event, fragment, fragment_length);
+        fragment_length = 0;
+    }
+}
+
+static void HandleContentFragment(void *cookie, const char *data, size_t length, int more)
+{
+    UNUSED(cookie);
+    AddFragment("contentHandler", data, length, more);
+}
+
+static void HandleAttributeFragment(void *cookie, const char *data, size_t length, int more)
+{
+    UNUSED(cookie);
+    AddFragment("attributeHandler", data, length, more);
+}
+
+static void HandleAttributes(void *cookie, const tSaxmlAttributes *attributes)
+{
+    tSaxmlAttribute attribute, found;
+    size_t iterator = 0;
+    char name[64];
+    char value[256];
+
+    UNUSED(cookie);
+    ++printed.attributeRegions;
+    while(saxml_NextAttribute(attributes, &iterator, &attribute))
+    {
+        PRINT("attributeName", attribute.name, attribute.nameLength);
+        if(NULL != attribute.value && decode_references && attribute.valueLength <= sizeof(value))
+            PRINT("attributeValue", value,
+                saxml_DecodeReferences(value, attribute.value, attribute.valueLength));
+        else if(NULL != attribute.value)
+            PRINT("attributeValue", attribute.value, attribute.valueLength);
+
+        /* Looking the attribute up by name must find it (or an earlier one of the same name) */
+        if(attribute.nameLength < sizeof(name))
+        {
+            memcpy(name, attribute.name, attribute.nameLength);
+            name[attribute.nameLength] = '\0';
+            if(!saxml_FindAttribute(attributes, name, &found) || found.name > attribute.name)
+                PRINT("findFailed", attribute.name, attribute.nameLength);
+        }
+    }
+}
+
+/* Vocabulary for the ID handlers; the names from the test vectors, with some deliberately
+ *  left out, padded with enough other names to exercise building a large perfect hash */
+static const char *g_knownNames[] =
+{
+    "catalog", "entry", "id", "description", "region", "note", "empty", "flag", "spaced",
+    "menu", "item", "title", "price", "name"
+};
+#define KNOWN_NAME_COUNT (sizeof(g_knownNames) / sizeof(g_knownNames[0]))
+#define FILLER_NAME_COUNT 500
+static const char *g_vocabulary[KNOWN_NAME_COUNT + FILLER_NAME_COUNT];
+static char g_fillerNames[FILLER_NAME_COUNT][16];
+
+static void CheckId(int32_t id, const char *data, size_t length, int bAttribute)
+{
+    size_t nameLength = 0;
+    uint32_t i;
+
+    while(nameLength < length && !(bAttribute && ('=' == data[nameLength] || ' ' == data[nameLength])))
+        ++nameLength;
+    for(i = 0; i < KNOWN_NAME_COUNT + FILLER_NAME_COUNT; ++i)
+    {
+        if(strlen(g_vocabulary[i]) == nameLength && memcmp(g_vocabulary[i], data, nameLength) == 0)
+            break;
+    }
+    if((i == KNOWN_NAME_COUNT + FILLER_NAME_COUNT) ? (SAXML_UNKNOWN_ID != id) : ((int32_t) i != id))
+        PRINT("idMismatch", data, length);
+}
+
+static void HandleTagId(void *cookie, int32_t id, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    CheckId(id, data, length, 0);
+    PRINT("tagHandler", data, length);
+    CheckSkip(data, length);
+}
+
+static void HandleTagEndId(void *cookie, int32_t id, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    CheckId(id, data, length, 0);
+    PRINT("tagEndHandler", data, length);
+}
+
+static void HandleAttributeId(void *cookie, int32_t id, const char *data, size_t length)
+{
+    UNUSED(cookie);
+    CheckId(id, data, length, 1);
+    PRINT("attributeHandler", data, length);
+}
+
+static tSaxmlVocabulary CreateVocabulary(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < KNOWN_NAME_COUNT; ++i)
+        g_vocabulary[i] = g_knownNames[i];
+    for(i = 0; i < FILLER_NAME_COUNT; ++i)
+    {
+        sprintf(g_fillerNames[i], "filler%u", (unsigned) i);
+        g_vocabulary[KNOWN_NAME_COUNT + i] = g_fillerNames[i];
+    }
+
+    #ifdef SAXML_NO_MALLOC
+    {
+        static char storage[16384];
+        return saxml_CreateVocabularyInPlace(storage, sizeof(storage), g_vocabulary,
+            KNOWN_NAME_COUNT + FILLER_NAME_COUNT);
+    }
+    #else
+    return saxml_CreateVocabulary(g_vocabulary, KNOWN_NAME_COUNT + FILLER_NAME_COUNT);
+    #endif
 }
 
 /* -----------------------------------------------------------------------------------------------
@@ -93,16 +294,580 @@ static void HandleAttribute(void *cookie, const char *szString)
  */
 
  #define DEFAULT_MAX_STRING_LENGTH 256 /* characters */
- #define PROGRAM_OPTIONS "c:s:?"
+ #define STACK_SIZE 256 /* bytes */
+ #define MAX_SUBSCRIPTIONS 8
+ #define STATE_SIZE 1024 /* bytes */
+ #define SKIP_RESULT 77 /* ctest's SKIP_RETURN_CODE */
+ #define PROGRAM_OPTIONS "ab:B:c:CDeE:fiI:km:M:o:OpP:Rs:S:tTuvw:W:x:yzZ?"
  #define STR(x) #x
 
+static char stack[STACK_SIZE];
+
  void DisplayHelp(const char* prog)
  {
     fprintf(stderr, "%s [xml file] <" PROGRAM_OPTIONS ">\n", prog);
+    fprintf(stderr, "   a                  Use the attribute region handler, rather than per-attribute events\n");
+    fprintf(stderr, "   b [chunk size]     Parse using saxml_HandleBuffer, reading chunks of this many characters\n");
+    fprintf(stderr, "   B [buffers]        Borrow the parser's string buffer from a shared pool of this many buffers\n");
     fprintf(stderr, "   c [compare file]   File to compare against test result\n");
+    fprintf(stderr, "   C                  Parse one character at a time using saxml_HandleCharacter\n");
+    fprintf(stderr, "   D                  Frame concatenated documents, reporting the start and end of each\n");
+    fprintf(stderr, "   e                  Decode entity and character references\n");
+    fprintf(stderr, "   E [error]          Expect parsing to fail with this SAXML_ERROR_* code\n");
+    fprintf(stderr, "   f                  Deliver contents and attributes in fragments, for any length\n");
+    fprintf(stderr, "   i                  Report tag and attribute names by vocabulary ID\n");
+    fprintf(stderr, "   I [mode]           Read the file's descriptor using saxml_ParseDescriptor (auto, serial, thread or uring)\n");
+    fprintf(stderr, "   k                  Keep an element stack (reports the names of empty tags)\n");
+    fprintf(stderr, "   m [threads]        Parse records using saxml_ParseRecords, reading chunks of the -b size\n");
+    fprintf(stderr, "   M [mask]           Deliver only the events in this mask of SAXML_EVENT_* bits\n");
+    fprintf(stderr, "   o [offset]         With -E, expect the error at this offset (with -b, -C or by default)\n");
+    fprintf(stderr, "   O                  With -I, read through a pipe left open after the file (for malformed files)\n");
+    fprintf(stderr, "   p                  Place the parser in caller-provided (unaligned) storage\n");
+    fprintf(stderr, "   P [threads]        Parse the whole file using saxml_ParseParallel, in chunks of the -b size\n");
+    fprintf(stderr, "   R                  Save, reset and restore the parser's state after each character or chunk\n");
     fprintf(stderr, "   s [length]         Maximum string length, in characters (default: " STR(DEFAULT_MAX_STRING_LENGTH) ")\n");
+    fprintf(stderr, "   S [pattern]        Subscribe to elements matching a path pattern (may be repeated)\n");
+    fprintf(stderr, "   t                  Allow truncated strings\n");
+    fprintf(stderr, "   T                  Check the parser's statistics against the events (if collected)\n");
+    fprintf(stderr, "   u                  Pull tokens using saxml_NextToken, feeding chunks of the -b size (default: 4096)\n");
+    fprintf(stderr, "   v                  Validate UTF-8\n");
+    fprintf(stderr, "   w [le|be]          Transcode the file to UTF-16, and parse it using saxml_HandleBufferUtf16 in chunks of the -b size\n");
+    fprintf(stderr, "   W [trim|collapse]  Trim or collapse whitespace in contents\n");
+    fprintf(stderr, "   x [name]           Skip the contents of elements with this tag name\n");
+    fprintf(stderr, "   y                  Build a tape of the whole file and replay it (or with -z, walk it)\n");
+    fprintf(stderr, "   z                  Use zero-copy span handlers\n");
+    fprintf(stderr, "   Z                  Use a zero-copy span handler for contents only\n");
  }
 
+/* States which have been tampered with must be rejected, leaving the parser unchanged. The
+ *  layout is saxml's own (see src/state.c): the number of characters matched of a markup
+ *  keyword or terminator at byte 8, the size of the element stack and the depth as 32-bit
+ *  little-endian integers at bytes 14 and 18, and the element stack at the end. */
+static int CheckTamperedState(void *saxml, const char *state, const size_t size)
+{
+    char tampered[STATE_SIZE];
+    size_t stackUsed = (size_t) (uint8_t) state[14] | ((size_t) (uint8_t) state[15] << 8);
+
+    memcpy(tampered, state, size);
+    tampered[8] = 7; /* more than any keyword or terminator */
+    if(saxml_RestoreState(saxml, tampered, size) != SAXML_ERROR_STATE)
+        return -1;
+
+    memcpy(tampered, state, size);
+    tampered[18] = (char) (state[18] + 1); /* one more element than there are names */
+    if(saxml_RestoreState(saxml, tampered, size) != SAXML_ERROR_STATE)
+        return -1;
+
+    if(stackUsed > 0)
+    {
+        /* Open elements, but without their names */
+        memcpy(tampered, state, size - stackUsed);
+        memset(&tampered[14], 0, 4);
+        if(saxml_RestoreState(saxml, tampered, size - stackUsed) != SAXML_ERROR_STATE)
+            return -1;
+    }
+    return 0;
+}
+
+/* Save the parser's state, reset it (and scribble over its element stack), and restore the
+ *  state again, as a process resuming a stream would */
+static int Checkpoint(void *saxml)
+{
+    char state[STATE_SIZE], again[STATE_SIZE];
+    size_t size;
+
+    if(!checkpoint)
+        return 0;
+    size = saxml_SaveState(saxml, state, sizeof(state));
+    if(size > sizeof(state))
+    {
+        fprintf(stderr, "Saved state too large (%lu bytes)\n", (unsigned long) size);
+        return -1;
+    }
+    saxml_Reset(saxml);
+    memset(stack, '#', sizeof(stack));
+    if(CheckTamperedState(saxml, state, size) != 0)
+    {
+        fprintf(stderr, "Tampered state was restored\n");
+        return -1;
+    }
+    if(saxml_RestoreState(saxml, state, size) != 0
+       || saxml_SaveState(saxml, again, sizeof(again)) != size || memcmp(state, again, size) != 0)
+    {
+        fprintf(stderr, "Failed to restore saved state\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Have a parser for each of a pool's buffers borrow one, by leaving a tag name unfinished, and
+ *  check that one more parser then can't parse anything, and that resetting the parsers returns
+ *  all of the buffers */
+static int CheckPool(tSaxmlPool pool, uint32_t count, tSaxmlContext *context)
+{
+    size_t size = saxml_PooledStorageSize();
+    char *storage;
+    tSaxmlParser *parsers;
+    size_t offset;
+    uint32_t i;
+    int result = 0, expected;
+
+    storage = (char *) malloc(size * (count + 1));
+    parsers = (tSaxmlParser *) malloc(sizeof(*parsers) * (count + 1));
+    if(NULL == storage || NULL == parsers)
+        result = -1;
+    for(i = 0; 0 == result && i <= count; ++i)
+    {
+        parsers[i] = saxml_InitializePooledInPlace(storage + i * size, size, context, pool);
+        expected = (i < count) ? 0 : SAXML_ERROR_POOL;
+        if(NULL == parsers[i] || saxml_HandleBuffer(parsers[i], "<a", 2, &offset) != expected
+           || offset != ((i < count) ? 2 : 0))
+        {
+            fprintf(stderr, "Pooled parser %lu failed\n", (unsigned long) i);
+            result = -1;
+        }
+    }
+    if(0 == result && saxml_PoolAvailable(pool) != 0)
+        result = -1;
+    for(i = 0; 0 == result && i <= count; ++i)
+        saxml_Reset(parsers[i]);
+    if(0 == result && saxml_PoolAvailable(pool) != count)
+    {
+        fprintf(stderr, "Pool buffers weren't returned\n");
+        result = -1;
+    }
+
+    free(parsers);
+    free(storage);
+    return result;
+}
+
+static int ParseCharacters(void *saxml, FILE *xml)
+{
+    size_t offset = 0;
+    int c, result;
+    while((c = fgetc(xml)) != EOF)
+    {
+        /* Parse one character at a time */
+        result = saxml_HandleCharacter(saxml, (char) c);
+        if(0 != result)
+        {
+            fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) offset);
+            error_offset = offset;
+            return result;
+        }
+        if(Checkpoint(saxml) != 0)
+            return -1;
+        ++offset;
+    }
+    return 0;
+}
+
+static int ParseFile(void *saxml, const char *filename)
+{
+    size_t offset;
+    int result;
+
+    result = saxml_ParseFile(saxml, filename, &offset);
+    if(SAXML_ERROR_FILE == result)
+        fprintf(stderr, "Error reading XML file '%s' (%d, %s)\n", filename, errno, strerror(errno));
+    else if(0 != result)
+    {
+        fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) offset);
+        error_offset = offset;
+    }
+    return result;
+}
+
+/* Copy a file into a pipe, returning the pipe's read end, with its write end in *writer. The
+ *  file must fit in the pipe, as nothing reads it until parsing starts. */
+static int OpenPipe(const int fd, int *writer)
+{
+    char buffer[512];
+    ssize_t length;
+    int fds[2];
+
+    if(0 != pipe(fds))
+        return -1;
+    fcntl(fds[1], F_SETFL, O_NONBLOCK); /* fail, rather than block, if it doesn't fit */
+    while((length = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        if(write(fds[1], buffer, (size_t) length) != length)
+        {
+            length = -1;
+            break;
+        }
+    }
+    if(length < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    *writer = fds[1];
+    return fds[0];
+}
+
+/* Returns SKIP_RESULT if the mode isn't available in this build, or on this system. With
+ *  holdOpen, the file is read through a pipe whose writer stays open until parsing ends, as a
+ *  stream which stalls after a malformed document would; it should only be used for documents
+ *  expected to fail. */
+static int ParseDescriptor(void *saxml, const char *filename, const int mode, const int holdOpen)
+{
+    size_t offset;
+    int fd, file, writer = -1, result;
+
+    fd = file = open(filename, O_RDONLY);
+    if(holdOpen && file >= 0)
+        fd = OpenPipe(file, &writer);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Error opening XML file '%s' (%d, %s)\n", filename, errno, strerror(errno));
+        if(file >= 0)
+            close(file);
+        return SAXML_ERROR_FILE;
+    }
+    result = saxml_ParseDescriptor(saxml, fd, mode, &offset);
+    if(SAXML_ERROR_FILE == result && ENOSYS == errno)
+    {
+        printf("Ingest mode %d isn't available\n", mode);
+        result = SKIP_RESULT;
+    }
+    else if(SAXML_ERROR_FILE == result)
+        fprintf(stderr, "Error reading XML file '%s' (%d, %s)\n", filename, errno, strerror(errno));
+    else if(0 != result)
+        fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) offset);
+    if(holdOpen)
+    {
+        close(writer);
+        close(fd);
+    }
+    close(file);
+    return result;
+}
+
+static int ParseChunks(void *saxml, FILE *xml, size_t chunkSize)
+{
+    char *chunk;
+    size_t length;
+    size_t offset;
+    size_t total = 0;
+    int result = 0;
+
+    chunk = (char *) malloc(chunkSize);
+    if(NULL == chunk)
+        return -1;
+
+    while(0 == result && (length = fread(chunk, 1, chunkSize, xml)) > 0)
+    {
+        result = saxml_HandleBuffer(saxml, chunk, length, &offset);
+        if(0 != result)
+        {
+            fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) (total + offset));
+            error_offset = total + offset;
+        }
+        else
+            result = Checkpoint(saxml);
+        total += length;
+    }
+
+    free(chunk);
+    return result;
+}
+
+static int ParsePull(void *saxml, FILE *xml, size_t chunkSize)
+{
+    static const char * const events[] =
+        { NULL, "tagHandler", "tagEndHandler", "contentHandler", "attributeHandler" };
+    tSaxmlToken token;
+    char *chunk;
+    size_t length;
+    size_t total = 0;
+    int type = 0;
+
+    chunk = (char *) malloc(chunkSize);
+    if(NULL == chunk)
+        return -1;
+
+    while(0 == type && (length = fread(chunk, 1, chunkSize, xml)) > 0)
+    {
+        saxml_Feed(saxml, chunk, length);
+        while((type = saxml_NextToken(saxml, &token)) > 0)
+        {
+            PRINT(events[type], token.data, token.length);
+            if(SAXML_TOKEN_TAG == type)
+                CheckSkip(token.data, token.length);
+        }
+        if(0 != type)
+        {
+            fprintf(stderr, "Error %d at offset %lu\n", type,
+                (unsigned long) (total + saxml_GetFeedOffset(saxml)));
+        }
+        else
+            type = Checkpoint(saxml);
+        total += length;
+    }
+
+    free(chunk);
+    return type;
+}
+
+/* Check the parser's statistics, if it collects them, against the events printed */
+static int CheckStats(void *saxml, const char *filename, int allowTruncated)
+{
+    tSaxmlStats stats;
+    FILE *xml;
+    long length = -1;
+
+    if(!saxml_GetStats(saxml, &stats))
+    {
+        printf("Statistics not collected\n");
+        return 0;
+    }
+    xml = fopen(filename, "rb");
+    if(NULL != xml)
+    {
+        fseek(xml, 0, SEEK_END);
+        length = ftell(xml);
+        fclose(xml);
+    }
+
+    printf("Statistics: %lu bytes, %lu tags, %lu tag ends, %lu contents, %lu attributes, "
+        "%lu attribute regions, depth %lu, longest string %lu of %lu, %lu truncated, "
+        "%lu errors\n", (unsigned long) stats.bytes, (unsigned long) stats.tags,
+        (unsigned long) stats.tagEnds, (unsigned long) stats.contents,
+        (unsigned long) stats.attributes, (unsigned long) stats.attributeRegions,
+        (unsigned long) stats.maxDepth, (unsigned long) stats.maxStringLength,
+        (unsigned long) stats.maxStringSize, (unsigned long) stats.truncatedCharacters,
+        (unsigned long) stats.errors);
+    printf("Time: %lu in handlers, %lu in the parser\n", (unsigned long) stats.handlerTicks,
+        (unsigned long) stats.parserTicks);
+
+    if(stats.bytes != (uint64_t) length || stats.tags != printed.tags
+       || stats.tagEnds != printed.tagEnds || stats.contents != printed.contents
+       || stats.attributes != printed.attributes
+       || stats.attributeRegions != printed.attributeRegions
+       || 0 == stats.maxDepth || stats.maxStringLength > stats.maxStringSize - 2
+       || (!allowTruncated && 0 != stats.truncatedCharacters) || 0 != stats.errors)
+    {
+        printf("Statistics mismatch: printed %lu tags, %lu tag ends, %lu contents, "
+            "%lu attributes, %lu attribute regions, of %ld bytes\n",
+            (unsigned long) printed.tags, (unsigned long) printed.tagEnds,
+            (unsigned long) printed.contents, (unsigned long) printed.attributes,
+            (unsigned long) printed.attributeRegions, length);
+        return -1;
+    }
+    return 0;
+}
+
+static int ParseParallel(void *saxml, FILE *xml, uint32_t threads, size_t chunkSize)
+{
+    char *document;
+    long length;
+    size_t offset;
+    int result = -1;
+
+    fseek(xml, 0, SEEK_END);
+    length = ftell(xml);
+    fseek(xml, 0, SEEK_SET);
+    document = (char *) malloc(length + 1);
+    if(NULL == document)
+        return -1;
+
+    if(fread(document, 1, length, xml) == (size_t) length)
+    {
+        result = saxml_ParseParallel(saxml, document, length, threads, chunkSize, &offset);
+        if(0 != result)
+            fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) offset);
+    }
+
+    free(document);
+    return result;
+}
+
+/* Parse each complete record read so far, carrying the rest over to the next chunk */
+static int ParseRecords(void *saxml, FILE *xml, uint32_t threads, size_t chunkSize)
+{
+    char *buffer = NULL;
+    size_t length = 0, read, offset;
+    size_t total = 0;
+    int result = 0;
+
+    do
+    {
+        buffer = (char *) realloc(buffer, length + chunkSize);
+        if(NULL == buffer)
+            return -1;
+        read = fread(&buffer[length], 1, chunkSize, xml);
+        length += read;
+
+        result = saxml_ParseRecords(saxml, buffer, length, threads, SAXML_RECORDS_ORDERED,
+            &offset);
+        if(0 != result)
+            fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) (total + offset));
+        memmove(buffer, &buffer[offset], length - offset);
+        length -= offset;
+        total += offset;
+    } while(0 == result && read > 0);
+
+    free(buffer);
+    return result;
+}
+
+/* Store a UTF-16 code unit in the given byte order */
+static char *PutUtf16(char *out, unsigned unit, int byteOrder)
+{
+    out[SAXML_UTF16_BE == byteOrder ? 1 : 0] = (char) (unit & 0xFF);
+    out[SAXML_UTF16_BE == byteOrder ? 0 : 1] = (char) (unit >> 8);
+    return out + 2;
+}
+
+/* Transcode the whole (UTF-8) file to UTF-16, and parse it in chunks */
+static int ParseUtf16(void *saxml, FILE *xml, int byteOrder, size_t chunkSize)
+{
+    const unsigned char *in, *end;
+    char *document, *utf16, *out;
+    unsigned long codePoint;
+    long length;
+    size_t total, offset, n;
+    int result = -1;
+
+    fseek(xml, 0, SEEK_END);
+    length = ftell(xml);
+    fseek(xml, 0, SEEK_SET);
+    document = (char *) malloc(length + 1);
+    utf16 = (char *) malloc(2 * length + 2);
+    if(NULL == document || NULL == utf16 || fread(document, 1, length, xml) != (size_t) length)
+    {
+        free(document);
+        free(utf16);
+        return -1;
+    }
+
+    in = (const unsigned char *) document;
+    end = in + length;
+    out = utf16;
+    while(in < end)
+    {
+        if(*in < 0x80)
+            codePoint = *in++;
+        else if(*in < 0xE0 && in + 1 < end)
+        {
+            codePoint = ((in[0] & 0x1FUL) << 6) | (in[1] & 0x3F);
+            in += 2;
+        }
+        else if(*in < 0xF0 && in + 2 < end)
+        {
+            codePoint = ((in[0] & 0x0FUL) << 12) | ((in[1] & 0x3FUL) << 6) | (in[2] & 0x3F);
+            in += 3;
+        }
+        else if(in + 3 < end)
+        {
+            codePoint = ((in[0] & 0x07UL) << 18) | ((in[1] & 0x3FUL) << 12)
+                | ((in[2] & 0x3FUL) << 6) | (in[3] & 0x3F);
+            in += 4;
+        }
+        else
+            break;
+        if(codePoint >= 0x10000)
+        {
+            out = PutUtf16(out, 0xD800 | (unsigned) ((codePoint - 0x10000) >> 10), byteOrder);
+            out = PutUtf16(out, 0xDC00 | (unsigned) (codePoint & 0x3FF), byteOrder);
+        }
+        else
+            out = PutUtf16(out, (unsigned) codePoint, byteOrder);
+    }
+
+    result = 0;
+    for(total = 0; 0 == result && total < (size_t) (out - utf16); total += n)
+    {
+        n = (size_t) (out - utf16) - total;
+        if(n > chunkSize)
+            n = chunkSize;
+        result = saxml_HandleBufferUtf16(saxml, &utf16[total], n, byteOrder, &offset);
+        if(0 != result)
+            fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) (total + offset));
+        else
+            result = Checkpoint(saxml);
+    }
+
+    free(utf16);
+    free(document);
+    return result;
+}
+
+/* Walk a tape directly, passing over the subtrees of skipped elements */
+static void WalkTape(const tSaxmlTape *tape)
+{
+    static const char * const events[] =
+        { NULL, "tagHandler", "tagEndHandler", "contentHandler", "attributeHandler" };
+    const tSaxmlTapeEntry *entry;
+    const char *data;
+    uint32_t i;
+
+    for(i = 0; i < tape->count; ++i)
+    {
+        entry = &tape->entries[i];
+        data = saxml_TapeData(tape, entry);
+        PRINT(events[entry->type], data, entry->length);
+        if(SAXML_TOKEN_TAG == entry->type && NULL != skip_name && strlen(skip_name) == entry->length
+           && memcmp(skip_name, data, entry->length) == 0)
+        {
+            if(SAXML_TAPE_NONE == entry->match)
+                break;
+            i = entry->match - 1;
+        }
+    }
+}
+
+/* Build a tape of the whole file, in storage of the size it reports it needs */
+static int ParseTape(void *saxml, FILE *xml, int walk)
+{
+    char *document, *storage;
+    char small[64];
+    long length;
+    size_t offset;
+    tSaxmlTape tape;
+    int result;
+
+    fseek(xml, 0, SEEK_END);
+    length = ftell(xml);
+    fseek(xml, 0, SEEK_SET);
+    document = (char *) malloc(length + 1);
+    if(NULL == document)
+        return -1;
+    if(fread(document, 1, length, xml) != (size_t) length)
+    {
+        free(document);
+        return -1;
+    }
+
+    result = saxml_BuildTape(saxml, document, length, small, sizeof(small), &tape, &offset);
+    if(SAXML_ERROR_BUFFER_OVERFLOW == result && tape.size > sizeof(small))
+    {
+        storage = (char *) malloc(tape.size);
+        result = (NULL == storage) ? -1
+            : saxml_BuildTape(saxml, document, length, storage, tape.size, &tape, &offset);
+    }
+    else
+        storage = NULL;
+
+    if(0 != result)
+        fprintf(stderr, "Error %d at offset %lu\n", result, (unsigned long) offset);
+    else if(walk)
+        WalkTape(&tape);
+    else
+    {
+        result = saxml_ReplayTape(saxml, &tape, 0, tape.count);
+        if(0 != result)
+            fprintf(stderr, "Error %d replaying tape\n", result);
+    }
+
+    free(storage);
+    free(document);
+    return result;
+}
+
 int main(int argc, char *argv[])
 {
     const char *filename;
@@ -112,6 +877,48 @@ int main(int argc, char *argv[])
     void *saxml;
     tSaxmlContext saxml_context;
     uint32_t max_string_size = DEFAULT_MAX_STRING_LENGTH;
+    size_t chunk_size = 0;
+    uint32_t threads = 0;
+    uint32_t record_threads = 0;
+    uint32_t pool_buffers = 0;
+    tSaxmlPool pool = NULL;
+    char *pool_storage = NULL;
+    size_t pool_size;
+    int use_characters = 0;
+    int use_pull = 0;
+    int use_file;
+    int ingest_mode = -1;
+    int hold_open = 0;
+    int allow_truncated = 0;
+    int use_spans = 0;
+    int use_content_span = 0;
+    int use_attributes = 0;
+    int use_ids = 0;
+    int use_fragments = 0;
+    int use_stack = 0;
+    int check_stats = 0;
+    int use_documents = 0;
+    int use_tape = 0;
+    int validate_utf8 = 0;
+    int utf16_order = -1;
+    int expected_error = 0;
+    size_t expected_offset = (size_t) -1;
+    uint32_t event_mask = SAXML_EVENT_ALL;
+    int whitespace = SAXML_WHITESPACE_PRESERVE;
+    const char *subscriptions[MAX_SUBSCRIPTIONS];
+    int subscription_count = 0;
+    int i;
+    tSaxmlVocabulary vocabulary = NULL;
+    tSaxmlIdContext saxml_ids;
+    #ifdef SAXML_NO_MALLOC
+    int in_place = 1; /* saxml_Initialize isn't available */
+    #else
+    int in_place = 0;
+    #endif
+    char *storage = NULL;
+    tSaxmlSpanContext saxml_spans;
+    tSaxmlFragmentContext saxml_fragments;
+    tSaxmlDocumentContext saxml_documents;
     int result = -1;
     char arg;
 
@@ -124,17 +931,99 @@ int main(int argc, char *argv[])
         {
             switch(arg)
             {
+                case 'a': use_attributes = 1; break;
+                case 'b':
+                    chunk_size = strtoul(optarg, NULL, 10);
+                    if(0 == chunk_size)
+                        showHelp = 1;
+                    break;
+                case 'B':
+                    pool_buffers = strtoul(optarg, NULL, 10);
+                    if(0 == pool_buffers)
+                        showHelp = 1;
+                    break;
                 case 'c':
                     compareBuffer = LoadFile(optarg);
                     if(NULL == compareBuffer)
                         showHelp = 1;
                     break;
+                case 'C': use_characters = 1; break;
+                case 'D': use_documents = 1; break;
+                case 'e': decode_references = 1; break;
+                case 'E':
+                    expected_error = (int) strtol(optarg, NULL, 10);
+                    if(expected_error >= 0)
+                        showHelp = 1;
+                    break;
+                case 'f': use_fragments = 1; break;
+                case 'i': use_ids = 1; break;
+                case 'I':
+                    if(strcmp(optarg, "auto") == 0)
+                        ingest_mode = SAXML_INGEST_AUTO;
+                    else if(strcmp(optarg, "serial") == 0)
+                        ingest_mode = SAXML_INGEST_SERIAL;
+                    else if(strcmp(optarg, "thread") == 0)
+                        ingest_mode = SAXML_INGEST_THREAD;
+                    else if(strcmp(optarg, "uring") == 0)
+                        ingest_mode = SAXML_INGEST_IO_URING;
+                    else
+                        showHelp = 1;
+                    break;
+                case 'k': use_stack = 1; break;
+                case 'm':
+                    record_threads = strtoul(optarg, NULL, 10);
+                    if(0 == record_threads)
+                        showHelp = 1;
+                    break;
+                case 'M': event_mask = strtoul(optarg, NULL, 0); break;
+                case 'o': expected_offset = strtoul(optarg, NULL, 10); break;
+                case 'O': hold_open = 1; break;
+                case 'p': in_place = 1; break;
+                case 'P':
+                    threads = strtoul(optarg, NULL, 10);
+                    if(0 == threads)
+                        showHelp = 1;
+                    break;
+                case 'R': checkpoint = 1; break;
                 case 's': max_string_size = strtoul(optarg, NULL, 10); break;
+                case 'S':
+                    if(subscription_count < MAX_SUBSCRIPTIONS)
+                        subscriptions[subscription_count++] = optarg;
+                    use_stack = 1;
+                    break;
+                case 't': allow_truncated = 1; break;
+                case 'T': check_stats = 1; break;
+                case 'u': use_pull = 1; break;
+                case 'v': validate_utf8 = 1; break;
+                case 'w':
+                    if(strcmp(optarg, "le") == 0)
+                        utf16_order = SAXML_UTF16_LE;
+                    else if(strcmp(optarg, "be") == 0)
+                        utf16_order = SAXML_UTF16_BE;
+                    else
+                        showHelp = 1;
+                    break;
+                case 'W':
+                    if(strcmp(optarg, "trim") == 0)
+                        whitespace = SAXML_WHITESPACE_TRIM;
+                    else if(strcmp(optarg, "collapse") == 0)
+                        whitespace = SAXML_WHITESPACE_COLLAPSE;
+                    else
+                        showHelp = 1;
+                    break;
+                case 'x': skip_name = optarg; break;
+                case 'y': use_tape = 1; break;
+                case 'z': use_spans = 1; break;
+                case 'Z': use_content_span = 1; break;
                 default: showHelp = 1; break;
             }
         }
     }
 
+    if(use_pull && pool_buffers > 0)
+        showHelp = 1; /* pull parsers can't be pooled */
+    if(hold_open && ingest_mode < 0)
+        showHelp = 1;
     if(showHelp)
     {
         DisplayHelp(argv[0]);
@@ -144,8 +1033,11 @@ int main(int argc, char *argv[])
     if(NULL != compareBuffer)
        PRINT = print_buffer;
 
-    xml = fopen(filename, "rb");
-    if(NULL == xml)
+    /* By default the file is parsed with saxml_ParseFile, which opens it itself (as does -I) */
+    use_file = ingest_mode >= 0 || (!use_characters && !use_pull && 0 == chunk_size
+        && 0 == threads && 0 == record_threads && !use_tape && utf16_order < 0);
+    xml = use_file ? NULL : fopen(filename, "rb");
+    if(NULL == xml && !use_file)
     {
         fprintf(stderr, "Error opening XML file '%s' (%d, %s)\n",
             filename, errno, strerror(errno));
@@ -158,23 +1050,156 @@ int main(int argc, char *argv[])
     saxml_context.parameterHandler = HandleParameter;
     saxml_context.contentHandler = HandleContent;
     saxml_context.attributeHandler = HandleAttribute;
-    saxml = saxml_Initialize(&saxml_context, max_string_size);
+    if(pool_buffers > 0)
+    {
+        if(in_place)
+        {
+            pool_size = saxml_PoolStorageSize(pool_buffers, max_string_size);
+            pool_storage = (char *) malloc(pool_size + 1);
+            pool = saxml_CreatePoolInPlace(pool_storage + 1, pool_size, pool_buffers,
+                max_string_size);
+        }
+        else
+            pool = saxml_CreatePool(pool_buffers, max_string_size);
+        if(NULL == pool || 0 != CheckPool(pool, pool_buffers, &saxml_context))
+        {
+            fprintf(stderr, "Failed to create pool\n");
+            return -1;
+        }
+        if(in_place)
+        {
+            storage = (char *) malloc(saxml_PooledStorageSize() + 1);
+            saxml = saxml_InitializePooledInPlace(storage + 1, saxml_PooledStorageSize(),
+                &saxml_context, pool);
+        }
+        else
+            saxml = saxml_InitializePooled(&saxml_context, pool);
+    }
+    else if(in_place)
+    {
+        /* Deliberately misalign the storage */
+        storage = (char *) malloc(saxml_StorageSize(max_string_size) + 1);
+        if(use_pull)
+            saxml = saxml_InitializePullInPlace(storage + 1, saxml_StorageSize(max_string_size),
+                max_string_size);
+        else
+            saxml = saxml_InitializeInPlace(storage + 1, saxml_StorageSize(max_string_size),
+                &saxml_context, max_string_size);
+    }
+    else if(use_pull)
+        saxml = saxml_InitializePull(max_string_size);
+    else
+        saxml = saxml_Initialize(&saxml_context, max_string_size);
     if(NULL == saxml)
     {
         fprintf(stderr, "Failed to initialize saxml\n");
         return -1;
     }
+    parser = saxml;
+    saxml_AllowTruncatedStrings(saxml, allow_truncated);
+    saxml_EnableReferenceDecoding(saxml, decode_references);
+    saxml_EnableUtf8Validation(saxml, validate_utf8);
+    saxml_SetEventMask(saxml, event_mask);
+    saxml_SetWhitespacePolicy(saxml, whitespace);
+    if(use_attributes)
+        saxml_SetAttributesHandler(saxml, HandleAttributes);
+    if(use_spans || use_content_span)
+    {
+        /* With -Z, the other events are delivered to the string handlers */
+        saxml_spans.tagHandler = use_spans ? HandleTagSpan : NULL;
+        saxml_spans.tagEndHandler = use_spans ? HandleTagEndSpan : NULL;
+        saxml_spans.contentHandler = HandleContentSpan;
+        saxml_spans.attributeHandler = use_spans ? HandleAttributeSpan : NULL;
+        saxml_SetSpanHandlers(saxml, &saxml_spans);
+    }
 
-    while(!feof(xml))
+    if(use_fragments)
     {
-        /* Parse one character at a time */
-        if(saxml_HandleCharacter(saxml, (const uint8_t) fgetc(xml)) != 0)
+        saxml_fragments.contentHandler = HandleContentFragment;
+        saxml_fragments.attributeHandler = HandleAttributeFragment;
+        saxml_SetFragmentHandlers(saxml, &saxml_fragments);
+    }
+
+    if(use_documents)
+    {
+        saxml_documents.startHandler = HandleDocumentStart;
+        saxml_documents.endHandler = HandleDocumentEnd;
+        saxml_SetDocumentHandlers(saxml, &saxml_documents);
+    }
+
+    if(use_stack)
+        saxml_SetElementStack(saxml, stack, sizeof(stack));
+    for(i = 0; i < subscription_count; ++i)
+    {
+        if(saxml_Subscribe(saxml, subscriptions[i]) != 0)
+        {
+            fprintf(stderr, "Invalid subscription '%s'\n", subscriptions[i]);
+            return -1;
+        }
+    }
+    if(use_ids)
+    {
+        vocabulary = CreateVocabulary();
+        if(NULL == vocabulary)
+        {
+            fprintf(stderr, "Failed to create vocabulary\n");
+            return -1;
+        }
+        saxml_ids.tagHandler = HandleTagId;
+        saxml_ids.tagEndHandler = HandleTagEndId;
+        saxml_ids.attributeHandler = HandleAttributeId;
+        saxml_SetIdHandlers(saxml, vocabulary, &saxml_ids);
+    }
+
+    if(ingest_mode >= 0)
+        result = ParseDescriptor(saxml, filename, ingest_mode, hold_open);
+    else if(use_pull)
+        result = ParsePull(saxml, xml, (chunk_size > 0) ? chunk_size : 4096);
+    else if(use_tape)
+        result = ParseTape(saxml, xml, use_spans);
+    else if(record_threads > 0)
+        result = ParseRecords(saxml, xml, record_threads, (chunk_size > 0) ? chunk_size : 4096);
+    else if(threads > 0)
+        result = ParseParallel(saxml, xml, threads, chunk_size);
+    else if(utf16_order >= 0)
+        result = ParseUtf16(saxml, xml, utf16_order, (chunk_size > 0) ? chunk_size : 4096);
+    else if(chunk_size > 0)
+        result = ParseChunks(saxml, xml, chunk_size);
+    else if(use_characters)
+        result = ParseCharacters(saxml, xml);
+    else
+        result = ParseFile(saxml, filename);
+    if(SKIP_RESULT == result)
+        return SKIP_RESULT;
+    if(result != expected_error)
+    {
+        printf("Parsing failed\n");
+        return -1;
+    }
+    if(0 != result && expected_offset != (size_t) -1 && error_offset != expected_offset)
+    {
+        printf("Error at offset %lu, rather than %lu\n", (unsigned long) error_offset,
+            (unsigned long) expected_offset);
+        return -1;
+    }
+    if(NULL != xml)
+        fclose(xml);
+    if(check_stats && 0 != CheckStats(saxml, filename, allow_truncated))
+        return -1;
+    saxml_Deinitialize(saxml);
+    saxml_DestroyVocabulary(vocabulary);
+    free(storage);
+    if(NULL != pool)
+    {
+        if(saxml_PoolAvailable(pool) != pool_buffers)
         {
-            printf("Parsing failed\n");
+            fprintf(stderr, "Pool buffer wasn't returned\n");
             return -1;
         }
+        saxml_DestroyPool(pool);
+        free(pool_storage);
     }
-    fclose(xml);
+    result = -1;
     printf("Parse successful\n");
 
     if(compareBuffer == NULL)
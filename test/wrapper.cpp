@@ -0,0 +1,135 @@
+/*! \copyright 2025 Zorxx Software. All rights reserved.
+ *  \license This file is released under the MIT License. See the LICENSE file for details.
+ *  \brief Test of the C++ interface; parses a file in chunks with saxml::Parser, and compares
+ *         the events against a test result
+ */
+#include "saxml/saxml.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#define CHUNK_SIZE 5 /* small, so that strings cross chunks */
+#define STACK_SIZE 256
+
+/* Records every event, in the same format as the C test application */
+struct Printer
+{
+    std::string result;
+
+    void Print(const char *event, std::string_view s)
+    {
+        result += event;
+        result += ": '";
+        result += s;
+        result += "'\n";
+    }
+    void onTag(std::string_view s) { Print("tagHandler", s); }
+    void onTagEnd(std::string_view s) { Print("tagEndHandler", s); }
+    void onContent(std::string_view s) { Print("contentHandler", s); }
+    void onAttribute(std::string_view s) { Print("attributeHandler", s); }
+};
+
+/* Handles start tags only; no other events are registered */
+struct TagCounter
+{
+    unsigned long tags = 0;
+    void onTag(std::string_view) { ++tags; }
+};
+
+static bool LoadFile(const char *path, std::string &contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream stream;
+    if(!file)
+    {
+        std::fprintf(stderr, "Error opening file '%s'\n", path);
+        return false;
+    }
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+template <typename Handler>
+static bool Parse(saxml::Parser<Handler> &parser, const std::string &document)
+{
+    std::size_t position, offset;
+    int result;
+
+    if(!parser.valid())
+    {
+        std::fprintf(stderr, "Failed to initialize saxml\n");
+        return false;
+    }
+    for(position = 0; position < document.size(); position += CHUNK_SIZE)
+    {
+        result = parser.parse(std::string_view(document).substr(position, CHUNK_SIZE), &offset);
+        if(0 != result)
+        {
+            std::fprintf(stderr, "Error %d at offset %lu\n", result,
+                (unsigned long) (position + offset));
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string document, expected;
+    Printer printer;
+    TagCounter counter;
+    char stack[STACK_SIZE];
+    std::size_t found;
+    unsigned long tags = 0;
+
+    static_assert(nullptr == saxml::detail::Dispatch<TagCounter>::spans.contentHandler,
+        "missing handlers aren't registered");
+
+    if(argc < 3)
+    {
+        std::fprintf(stderr, "%s [xml file] [compare file]\n", argv[0]);
+        return -1;
+    }
+    if(!LoadFile(argv[1], document) || !LoadFile(argv[2], expected))
+        return -1;
+
+    #ifdef SAXML_NO_MALLOC
+    static char storage[2][4096];
+    saxml::Parser<Printer> parser(printer, storage[0], sizeof(storage[0]), 256);
+    saxml::Parser<TagCounter> tagParser(counter, storage[1], sizeof(storage[1]), 256);
+    #else
+    saxml::Parser<Printer> parser(printer);
+    saxml::Parser<TagCounter> tagParser(counter);
+    #endif
+
+    if(parser.valid())
+        parser.setElementStack(stack, sizeof(stack));
+    if(!Parse(parser, document) || !Parse(tagParser, document))
+    {
+        std::printf("Parsing failed\n");
+        return -1;
+    }
+
+    for(found = expected.find("tagHandler:"); std::string::npos != found;
+        found = expected.find("tagHandler:", found + 1))
+    {
+        if(0 == found || '\n' == expected[found - 1])
+            ++tags;
+    }
+
+    if(printer.result != expected)
+    {
+        std::printf("Failed, mismatch\n----- Expected:\n%s\n----- Received:\n%s\n",
+            expected.c_str(), printer.result.c_str());
+        return -1;
+    }
+    if(counter.tags != tags)
+    {
+        std::printf("Failed, %lu tags rather than %lu\n", counter.tags, tags);
+        return -1;
+    }
+    std::printf("Success\n");
+    return 0;
+}